@@ -0,0 +1,74 @@
+/*
+ * grml-plus UEFI tools - ACPI table lookup
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "acpi.h"
+
+ACPI_TABLE_HEADER *acpiFindTable(UINT32 Signature) {
+    EFI_GUID acpi20TableGuid = ACPI_20_TABLE_GUID, acpiTableGuid = ACPI_TABLE_GUID;
+    ACPI_RSDP *rsdp = NULL, *rsdp10 = NULL;
+    ACPI_TABLE_HEADER *sdt, *table;
+    UINTN i, entries, entrySize;
+    UINT64 address;
+
+    for (i = 0; i < ST->NumberOfTableEntries; i++) {
+        if (CompareMem(&ST->ConfigurationTable[i].VendorGuid, &acpi20TableGuid, sizeof(EFI_GUID)) == 0)
+            rsdp = ST->ConfigurationTable[i].VendorTable;
+        else if (CompareMem(&ST->ConfigurationTable[i].VendorGuid, &acpiTableGuid, sizeof(EFI_GUID)) == 0)
+            rsdp10 = ST->ConfigurationTable[i].VendorTable;
+    }
+    if (rsdp == NULL)
+        rsdp = rsdp10;
+    if (rsdp == NULL || CompareMem(&rsdp->Signature, "RSD PTR ", 8) != 0)
+        return NULL;
+
+    /* the XSDT has 64 bit entries, the RSDT of ACPI 1.0 32 bit ones */
+    if (rsdp->Revision >= 2 && rsdp->XsdtAddress != 0) {
+        sdt = (ACPI_TABLE_HEADER *) (UINTN) rsdp->XsdtAddress;
+        entrySize = 8;
+    } else {
+        sdt = (ACPI_TABLE_HEADER *) (UINTN) rsdp->RsdtAddress;
+        entrySize = 4;
+    }
+    if (sdt == NULL || sdt->Length < sizeof(ACPI_TABLE_HEADER))
+        return NULL;
+    entries = (sdt->Length - sizeof(ACPI_TABLE_HEADER)) / entrySize;
+    for (i = 0; i < entries; i++) {
+        address = 0;
+        CopyMem(&address, (UINT8 *) (sdt + 1) + i * entrySize, entrySize);
+        table = (ACPI_TABLE_HEADER *) (UINTN) address;
+        if (table != NULL && table->Signature == Signature)
+            return table;
+    }
+    return NULL;
+}
@@ -0,0 +1,95 @@
+/*
+ * grml-plus UEFI tools - ACPI table lookup
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ACPI_H
+#define ACPI_H
+
+/*
+ * The firmware publishes the ACPI tables through the system configuration
+ * table; they stay in (identity mapped) ACPI memory, so they are read in
+ * place.
+ */
+
+#define ACPI_SRAT_SIGNATURE 0x54415253 /* "SRAT" */
+#define SRAT_MEMORY_AFFINITY_TYPE 1
+#define SRAT_MEMORY_ENABLED 0x00000001
+
+typedef struct {
+    UINT64 Signature;
+    UINT8 Checksum;
+    UINT8 OemId[6];
+    UINT8 Revision;
+    UINT32 RsdtAddress;
+    UINT32 Length;
+    UINT64 XsdtAddress;
+    UINT8 ExtendedChecksum;
+    UINT8 Reserved[3];
+} __attribute__((packed)) ACPI_RSDP;
+
+typedef struct {
+    UINT32 Signature;
+    UINT32 Length;
+    UINT8 Revision;
+    UINT8 Checksum;
+    UINT8 OemId[6];
+    UINT64 OemTableId;
+    UINT32 OemRevision;
+    UINT32 CreatorId;
+    UINT32 CreatorRevision;
+} __attribute__((packed)) ACPI_TABLE_HEADER;
+
+/* the static resource affinity table: a header, then variable length structures */
+typedef struct {
+    ACPI_TABLE_HEADER Header;
+    UINT32 Reserved1;
+    UINT64 Reserved2;
+} __attribute__((packed)) ACPI_SRAT;
+
+typedef struct {
+    UINT8 Type;
+    UINT8 Length;
+} __attribute__((packed)) SRAT_STRUCTURE_HEADER;
+
+typedef struct {
+    SRAT_STRUCTURE_HEADER Header;
+    UINT32 ProximityDomain;
+    UINT16 Reserved1;
+    UINT64 BaseAddress;
+    UINT64 Length;
+    UINT32 Reserved2;
+    UINT32 Flags;
+    UINT64 Reserved3;
+} __attribute__((packed)) SRAT_MEMORY_AFFINITY;
+
+/* from the XSDT, or the RSDT of ACPI 1.0; NULL if there is none */
+ACPI_TABLE_HEADER *acpiFindTable(UINT32 Signature);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * grml-plus UEFI protector - allocation high-water tracking for child images
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "alloctrack.h"
+#include "efiabi.h"
+
+typedef struct {
+    EFI_PHYSICAL_ADDRESS Address;
+    UINT64 Bytes;
+    UINT32 Type;
+    BOOLEAN Pool;
+} TRACKED_ALLOCATION;
+
+/* an empty slot has Address 0; deleting shifts the rest of the probe run back, so there are no tombstones */
+static TRACKED_ALLOCATION tracked[ALLOCTRACK_TABLE_SIZE];
+static UINT64 baselinePages[EfiMaxMemoryType], pagesInUse[EfiMaxMemoryType], poolBytes[EfiMaxMemoryType], peakPages[EfiMaxMemoryType];
+static UINTN untracked = 0;
+static BOOLEAN active = FALSE;
+
+/* loader memory that earlier tracked runs did not free */
+static TRACKED_ALLOCATION leftovers[ALLOCTRACK_MAX_LEFTOVERS];
+static UINTN leftoverCount = 0;
+
+static EFI_ALLOCATE_PAGES origAllocatePages;
+static EFI_FREE_PAGES origFreePages;
+static EFI_ALLOCATE_POOL origAllocatePool;
+static EFI_FREE_POOL origFreePool;
+
+#ifdef NEED_THUNKS
+static EFI_STATUS thunk_trackAllocatePages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN NoPages, EFI_PHYSICAL_ADDRESS *Memory)
+__attribute__((unused));
+static EFI_STATUS thunk_trackFreePages(EFI_PHYSICAL_ADDRESS Memory, UINTN NoPages)
+__attribute__((unused));
+static EFI_STATUS thunk_trackAllocatePool(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID **Buffer)
+__attribute__((unused));
+static EFI_STATUS thunk_trackFreePool(VOID *Buffer)
+__attribute__((unused));
+#endif
+
+static UINTN slotOf(EFI_PHYSICAL_ADDRESS Address) {
+    return (UINTN) ((Address >> 4) * 0x9e3779b97f4a7c15ULL >> 32) % ALLOCTRACK_TABLE_SIZE;
+}
+
+static VOID updatePeak(UINT32 Type) {
+    UINT64 pages = pagesInUse[Type] + EFI_SIZE_TO_PAGES(poolBytes[Type]);
+
+    if (pages > peakPages[Type])
+        peakPages[Type] = pages;
+}
+
+/* the table is also updated from callbacks that allocate, so it is only touched at TPL_HIGH_LEVEL */
+static VOID remember(EFI_PHYSICAL_ADDRESS Address, UINT64 Bytes, UINT32 Type, BOOLEAN Pool) {
+    UINTN i, slot = slotOf(Address);
+    EFI_TPL tpl;
+
+    if (Type >= EfiMaxMemoryType) {
+        untracked++;
+        return;
+    }
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_HIGH_LEVEL);
+    for (i = 0; i < ALLOCTRACK_TABLE_SIZE; i++, slot = (slot + 1) % ALLOCTRACK_TABLE_SIZE) {
+        if (tracked[slot].Address == 0) {
+            tracked[slot].Address = Address;
+            tracked[slot].Bytes = Bytes;
+            tracked[slot].Type = Type;
+            tracked[slot].Pool = Pool;
+            break;
+        }
+    }
+    if (i == ALLOCTRACK_TABLE_SIZE)
+        untracked++;
+    /* account even if the table is full, so the peak is never too low */
+    if (Pool)
+        poolBytes[Type] += Bytes;
+    else
+        pagesInUse[Type] += EFI_SIZE_TO_PAGES(Bytes);
+    updatePeak(Type);
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+}
+
+/* empties Slot and moves entries of the same probe run back into the gap, so lookups can stop at the first empty slot */
+static VOID removeSlot(UINTN Slot) {
+    UINTN next = Slot, home;
+
+    while (TRUE) {
+        next = (next + 1) % ALLOCTRACK_TABLE_SIZE;
+        if (tracked[next].Address == 0)
+            break;
+        home = slotOf(tracked[next].Address);
+        /* stays if its home lies cyclically in (Slot, next] */
+        if (Slot <= next ? (Slot < home && home <= next) : (Slot < home || home <= next))
+            continue;
+        tracked[Slot] = tracked[next];
+        Slot = next;
+    }
+    tracked[Slot].Address = 0;
+}
+
+static VOID forget(EFI_PHYSICAL_ADDRESS Address, BOOLEAN Pool) {
+    UINTN i, slot = slotOf(Address);
+    EFI_TPL tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_HIGH_LEVEL);
+
+    for (i = 0; i < ALLOCTRACK_TABLE_SIZE && tracked[slot].Address != 0; i++, slot = (slot + 1) % ALLOCTRACK_TABLE_SIZE) {
+        if (tracked[slot].Address == Address && tracked[slot].Pool == Pool) {
+            if (Pool)
+                poolBytes[tracked[slot].Type] -= tracked[slot].Bytes;
+            else
+                pagesInUse[tracked[slot].Type] -= EFI_SIZE_TO_PAGES(tracked[slot].Bytes);
+            removeSlot(slot);
+            uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+            return;
+        }
+    }
+    /* a later image may free what an earlier one left behind */
+    for (i = 0; i < leftoverCount; i++) {
+        if (leftovers[i].Address == Address && leftovers[i].Pool == Pool) {
+            leftovers[i] = leftovers[--leftoverCount];
+            break;
+        }
+    }
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+}
+
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK trackAllocatePages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN NoPages, EFI_PHYSICAL_ADDRESS *Memory) {
+    EFI_STATUS status = uefi_call_wrapper(origAllocatePages, 4, Type, MemoryType, NoPages, Memory);
+
+    if (status == EFI_SUCCESS)
+        remember(*Memory, (UINT64) NoPages << EFI_PAGE_SHIFT, MemoryType, FALSE);
+    return status;
+}
+
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK trackFreePages(EFI_PHYSICAL_ADDRESS Memory, UINTN NoPages) {
+    EFI_STATUS status = uefi_call_wrapper(origFreePages, 2, Memory, NoPages);
+
+    if (status == EFI_SUCCESS)
+        forget(Memory, FALSE);
+    return status;
+}
+
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK trackAllocatePool(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID **Buffer) {
+    EFI_STATUS status = uefi_call_wrapper(origAllocatePool, 3, PoolType, Size, Buffer);
+
+    if (status == EFI_SUCCESS)
+        remember((EFI_PHYSICAL_ADDRESS) (UINTN) *Buffer, Size, PoolType, TRUE);
+    return status;
+}
+
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK trackFreePool(VOID *Buffer) {
+    EFI_STATUS status = uefi_call_wrapper(origFreePool, 1, Buffer);
+
+    if (status == EFI_SUCCESS)
+        forget((EFI_PHYSICAL_ADDRESS) (UINTN) Buffer, TRUE);
+    return status;
+}
+
+#ifdef NEED_THUNKS
+/* MS -> ELF thunks for the wrappers, see efiabi.h */
+THUNK4(trackAllocatePages)
+THUNK4(trackFreePages)
+THUNK4(trackAllocatePool)
+THUNK4(trackFreePool)
+#endif
+
+static VOID updateBootServicesCrc(VOID) {
+    UINT32 crc = 0;
+
+    BS->Hdr.CRC32 = 0;
+    uefi_call_wrapper(BS->CalculateCrc32, 3, BS, BS->Hdr.HeaderSize, &crc);
+    BS->Hdr.CRC32 = crc;
+}
+
+VOID allocTrackStart(VOID) {
+    EFI_MEMORY_DESCRIPTOR *Desc, *MemMap;
+    UINTN i, count, mapKey, descriptorSize;
+    UINT32 descriptorVersion;
+    EFI_TPL tpl;
+
+    if (active)
+        return;
+
+    ZeroMem(tracked, sizeof(tracked));
+    ZeroMem(baselinePages, sizeof(baselinePages));
+    ZeroMem(pagesInUse, sizeof(pagesInUse));
+    ZeroMem(poolBytes, sizeof(poolBytes));
+    ZeroMem(peakPages, sizeof(peakPages));
+    untracked = 0;
+
+    MemMap = LibMemoryMap(&count, &mapKey, &descriptorSize, &descriptorVersion);
+    if (MemMap) {
+        Desc = MemMap;
+        for (i = 0; i < count; i++) {
+            if (Desc->Type < EfiMaxMemoryType)
+                baselinePages[Desc->Type] += Desc->NumberOfPages;
+            Desc = NextMemoryDescriptor(Desc, descriptorSize);
+        }
+        FreePool(MemMap);
+    }
+
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_HIGH_LEVEL);
+    origAllocatePages = BS->AllocatePages;
+    origFreePages = BS->FreePages;
+    origAllocatePool = BS->AllocatePool;
+    origFreePool = BS->FreePool;
+    BS->AllocatePages = CALLBACK_ENTRY(trackAllocatePages);
+    BS->FreePages = CALLBACK_ENTRY(trackFreePages);
+    BS->AllocatePool = CALLBACK_ENTRY(trackAllocatePool);
+    BS->FreePool = CALLBACK_ENTRY(trackFreePool);
+    updateBootServicesCrc();
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    active = TRUE;
+}
+
+VOID allocTrackStop(VOID) {
+    EFI_TPL tpl;
+    UINTN i;
+
+    if (!active)
+        return;
+    for (i = 0; i < ALLOCTRACK_TABLE_SIZE && leftoverCount < ALLOCTRACK_MAX_LEFTOVERS; i++) {
+        if (tracked[i].Address != 0 && (tracked[i].Type == EfiLoaderCode || tracked[i].Type == EfiLoaderData))
+            leftovers[leftoverCount++] = tracked[i];
+    }
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_HIGH_LEVEL);
+    BS->AllocatePages = origAllocatePages;
+    BS->FreePages = origFreePages;
+    BS->AllocatePool = origAllocatePool;
+    BS->FreePool = origFreePool;
+    updateBootServicesCrc();
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    active = FALSE;
+}
+
+BOOLEAN allocTrackReport(CHAR16 *Entry, INT32 StoredPages[EfiMaxMemoryType]) {
+    BOOLEAN exceeded = FALSE;
+    UINT64 peak;
+    UINTN i;
+
+    uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_WHITE);
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    Print(L"Allocations of %s (pages)\n\n", Entry);
+    Print(L"Type  Before    Peak      Now       Bin\n");
+    for (i = 0; i < EfiMaxMemoryType; i++) {
+        if (peakPages[i] == 0 && StoredPages[i] == -1)
+            continue;
+        peak = baselinePages[i] + peakPages[i];
+        if (StoredPages[i] != -1 && peak > (UINT64) StoredPages[i]) {
+            exceeded = TRUE;
+            uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_YELLOW);
+        }
+        Print(L"%04x  %08lx  %08lx  %08lx  %08x\n", i, baselinePages[i], peak,
+            baselinePages[i] + pagesInUse[i] + EFI_SIZE_TO_PAGES(poolBytes[i]), StoredPages[i]);
+        uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_WHITE);
+    }
+    if (untracked)
+        Print(L"\n%d allocations could not be tracked individually.\n", untracked);
+    if (exceeded) {
+        uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_YELLOW);
+        Print(L"\nPeak usage exceeded the MemoryTypeInformation bins. The firmware will\n");
+        Print(L"adjust them and reset the machine the next time it boots an OS.\n");
+        uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_WHITE);
+    }
+    Print(L"\nPress any key to return to the menu.\n");
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    return exceeded;
+}
+
+UINT64 allocTrackLeftoverPages(VOID) {
+    UINT64 pages = 0;
+    UINTN i;
+
+    for (i = 0; i < leftoverCount; i++)
+        pages += EFI_SIZE_TO_PAGES(leftovers[i].Bytes);
+    return pages;
+}
@@ -0,0 +1,59 @@
+/*
+ * grml-plus UEFI protector - allocation high-water tracking for child images
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ALLOCTRACK_H
+#define ALLOCTRACK_H
+
+/*
+ * While enabled (the protector only enables it on request), BS->AllocatePages/
+ * AllocatePool/FreePages/FreePool are wrapped and the pages in use per memory
+ * type are followed. Usage is
+ * relative to the memory map at allocTrackStart; pool allocations are counted
+ * as the pages they would occupy. Frees of memory allocated before tracking
+ * started are ignored.
+ *
+ * EfiLoaderCode and EfiLoaderData allocations still in use at allocTrackStop
+ * are remembered as leftovers of the image that ran, until a later tracked
+ * image frees them. They are never freed here: they may still back
+ * configuration tables or protocol interfaces the image installed, or
+ * images it loaded and did not unload, so they are only reported.
+ */
+
+#define ALLOCTRACK_TABLE_SIZE 8192
+#define ALLOCTRACK_MAX_LEFTOVERS 256
+
+VOID allocTrackStart(VOID);
+VOID allocTrackStop(VOID);
+/* prints baseline, peak and stored bins per type; returns TRUE if a bin was exceeded */
+BOOLEAN allocTrackReport(CHAR16 *Entry, INT32 StoredPages[EfiMaxMemoryType]);
+UINT64 allocTrackLeftoverPages(VOID);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * grml-plus UEFI tools - SHA-256 allowlist index
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "sha256.h"
+#include "allowlist.h"
+#include "digestline.h"
+
+static UINTN digestPrefix(const UINT8 *Digest, UINTN PrefixBits) {
+    return ((UINT32) Digest[0] << 24 | (UINT32) Digest[1] << 16 | (UINT32) Digest[2] << 8 | Digest[3]) >> (32 - PrefixBits);
+}
+
+static UINTN prefixTableSize(UINTN PrefixBits) {
+    return ((1 << PrefixBits) + 1) * sizeof(UINT32);
+}
+
+static VOID setLayout(ALLOWLIST *List, VOID *Buffer, UINTN HeaderSize, UINTN Count, UINTN PrefixBits) {
+    List->Buffer = Buffer;
+    List->Prefixes = (UINT32 *) ((UINT8 *) Buffer + HeaderSize);
+    List->Digests = (UINT8 *) List->Prefixes + prefixTableSize(PrefixBits);
+    List->Count = Count;
+    List->PrefixBits = PrefixBits;
+}
+
+static EFI_STATUS openIndex(ALLOWLIST *List, VOID *Buffer, UINTN Size) {
+    ALLOWLIST_HEADER *header = Buffer;
+    UINTN p;
+
+    if (Size < sizeof(ALLOWLIST_HEADER) || header->Version != ALLOWLIST_VERSION ||
+            header->HeaderSize < sizeof(ALLOWLIST_HEADER) || (header->HeaderSize & 3) != 0 ||
+            header->PrefixBits < ALLOWLIST_MIN_PREFIX_BITS || header->PrefixBits > ALLOWLIST_MAX_PREFIX_BITS ||
+            Size != header->HeaderSize + prefixTableSize(header->PrefixBits) + (UINTN) header->Count * SHA256_DIGEST_SIZE)
+        return EFI_LOAD_ERROR;
+    setLayout(List, Buffer, header->HeaderSize, header->Count, header->PrefixBits);
+
+    /* with a monotonic table ending at Count, no lookup can leave the buffer */
+    if (List->Prefixes[0] != 0 || List->Prefixes[1 << List->PrefixBits] != List->Count)
+        return EFI_LOAD_ERROR;
+    for (p = 0; p < (UINTN) 1 << List->PrefixBits; p++) {
+        if (List->Prefixes[p] > List->Prefixes[p + 1])
+            return EFI_LOAD_ERROR;
+    }
+    return EFI_SUCCESS;
+}
+
+/* returns the number of digests, which are stored if Digests is not NULL */
+static UINTN parseText(const CHAR8 *Text, UINTN Size, UINT8 *Digests) {
+    const CHAR8 *line, *next, *end = Text + Size;
+    UINT8 digest[SHA256_DIGEST_SIZE];
+    UINTN count = 0;
+
+    for (line = Text; line < end; line = next + 1) {
+        for (next = line; next < end && *next != '\n'; next++)
+            ;
+        if (!parseDigestLine((const unsigned char *) line, next - line, digest))
+            continue;
+        if (Digests)
+            CopyMem(Digests + count * SHA256_DIGEST_SIZE, digest, SHA256_DIGEST_SIZE);
+        count++;
+    }
+    return count;
+}
+
+static VOID swapDigests(UINT8 *a, UINT8 *b) {
+    UINT8 tmp[SHA256_DIGEST_SIZE];
+
+    CopyMem(tmp, a, SHA256_DIGEST_SIZE);
+    CopyMem(a, b, SHA256_DIGEST_SIZE);
+    CopyMem(b, tmp, SHA256_DIGEST_SIZE);
+}
+
+static VOID siftDown(UINT8 *Digests, UINTN Root, UINTN Count) {
+    UINTN child;
+
+    for (; (child = 2 * Root + 1) < Count; Root = child) {
+        if (child + 1 < Count && CompareMem(Digests + child * SHA256_DIGEST_SIZE,
+                Digests + (child + 1) * SHA256_DIGEST_SIZE, SHA256_DIGEST_SIZE) < 0)
+            child++;
+        if (CompareMem(Digests + Root * SHA256_DIGEST_SIZE, Digests + child * SHA256_DIGEST_SIZE, SHA256_DIGEST_SIZE) >= 0)
+            break;
+        swapDigests(Digests + Root * SHA256_DIGEST_SIZE, Digests + child * SHA256_DIGEST_SIZE);
+    }
+}
+
+/* heapsort: no recursion and no extra memory */
+static VOID sortDigests(UINT8 *Digests, UINTN Count) {
+    UINTN i;
+
+    for (i = Count / 2; i > 0; i--)
+        siftDown(Digests, i - 1, Count);
+    for (i = Count; i > 1; i--) {
+        swapDigests(Digests, Digests + (i - 1) * SHA256_DIGEST_SIZE);
+        siftDown(Digests, 0, i - 1);
+    }
+}
+
+static EFI_STATUS convertText(ALLOWLIST *List, const CHAR8 *Text, UINTN Size) {
+    UINTN count = parseText(Text, Size, NULL), bits = ALLOWLIST_MIN_PREFIX_BITS, p, i;
+    ALLOWLIST_HEADER *header;
+    VOID *buffer;
+
+    while (bits < ALLOWLIST_MAX_PREFIX_BITS && ((UINTN) 1 << bits) < count)
+        bits++;
+    buffer = AllocatePool(sizeof(ALLOWLIST_HEADER) + prefixTableSize(bits) + count * SHA256_DIGEST_SIZE);
+    if (buffer == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    header = buffer;
+    header->Signature = ALLOWLIST_SIGNATURE;
+    header->Version = ALLOWLIST_VERSION;
+    header->HeaderSize = sizeof(ALLOWLIST_HEADER);
+    header->Count = count;
+    header->PrefixBits = bits;
+    setLayout(List, buffer, sizeof(ALLOWLIST_HEADER), count, bits);
+
+    parseText(Text, Size, List->Digests);
+    sortDigests(List->Digests, count);
+    for (p = 0, i = 0; p <= (UINTN) 1 << bits; p++) {
+        while (i < count && digestPrefix(List->Digests + i * SHA256_DIGEST_SIZE, bits) < p)
+            i++;
+        List->Prefixes[p] = i;
+    }
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS allowlistOpen(ALLOWLIST *List, VOID *Buffer, UINTN Size) {
+    EFI_STATUS status;
+
+    ZeroMem(List, sizeof(ALLOWLIST));
+    if (Size >= sizeof(UINT32) && *(UINT32 *) Buffer == ALLOWLIST_SIGNATURE) {
+        status = openIndex(List, Buffer, Size);
+        if (status == EFI_SUCCESS)
+            return status;
+    } else {
+        status = convertText(List, Buffer, Size);
+    }
+    FreePool(Buffer);
+    if (status != EFI_SUCCESS)
+        ZeroMem(List, sizeof(ALLOWLIST));
+    return status;
+}
+
+BOOLEAN allowlistContains(const ALLOWLIST *List, const UINT8 *Digest) {
+    UINTN p, low, high, middle;
+    INTN order;
+
+    if (List->Count == 0)
+        return FALSE;
+    p = digestPrefix(Digest, List->PrefixBits);
+    low = List->Prefixes[p];
+    high = List->Prefixes[p + 1];
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        order = CompareMem(List->Digests + middle * SHA256_DIGEST_SIZE, (VOID *) Digest, SHA256_DIGEST_SIZE);
+        if (order == 0)
+            return TRUE;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return FALSE;
+}
+
+VOID allowlistFree(ALLOWLIST *List) {
+    if (List->Buffer)
+        FreePool(List->Buffer);
+    ZeroMem(List, sizeof(ALLOWLIST));
+}
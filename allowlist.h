@@ -0,0 +1,85 @@
+/*
+ * grml-plus UEFI tools - SHA-256 allowlist index
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ALLOWLIST_H
+#define ALLOWLIST_H
+
+/*
+ * A set of SHA-256 digests, held in one pool buffer in the on-disk index
+ * layout built by tools/allowlist-index (little endian, version 1):
+ *
+ *   ALLOWLIST_HEADER
+ *   UINT32 Prefixes[(1 << PrefixBits) + 1]
+ *   UINT8 Digests[Count][SHA256_DIGEST_SIZE], sorted
+ *
+ * Prefixes[p] is the index of the first digest whose leading PrefixBits bits
+ * are at least p, so the digests starting with p are Prefixes[p] up to
+ * Prefixes[p + 1]. PrefixBits is chosen so that there is about one digest
+ * per bucket, and a lookup is one table read plus a binary search in that
+ * bucket, without any per-entry allocation.
+ */
+
+#define ALLOWLIST_SIGNATURE 0x41505247 /* "GRPA" */
+#define ALLOWLIST_VERSION 1
+#define ALLOWLIST_MIN_PREFIX_BITS 4
+#define ALLOWLIST_MAX_PREFIX_BITS 20
+
+typedef struct {
+    UINT32 Signature;
+    UINT16 Version;
+    UINT16 HeaderSize;
+    UINT32 Count;
+    UINT8 PrefixBits;
+    UINT8 Reserved[3];
+} __attribute__((packed)) ALLOWLIST_HEADER;
+
+typedef struct {
+    VOID *Buffer;
+    UINT32 *Prefixes;
+    UINT8 *Digests;
+    UINTN Count;
+    UINTN PrefixBits;
+} ALLOWLIST;
+
+/*
+ * Takes over Buffer, a pool allocation holding either an index or the
+ * output of sha256sum (every line starting with 64 hex digits adds a
+ * digest), which is converted into an index. Returns EFI_LOAD_ERROR for a
+ * malformed index. A valid index is used in place: Buffer becomes
+ * List->Buffer and is freed by allowlistFree. In every other case,
+ * including a successful conversion into a new index, Buffer is freed
+ * before allowlistOpen returns.
+ */
+EFI_STATUS allowlistOpen(ALLOWLIST *List, VOID *Buffer, UINTN Size);
+BOOLEAN allowlistContains(const ALLOWLIST *List, const UINT8 *Digest);
+VOID allowlistFree(ALLOWLIST *List);
+
+#endif
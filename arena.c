@@ -0,0 +1,130 @@
+/*
+ * grml-plus UEFI tools - page backed arena for per-launch allocations
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "arena.h"
+
+EFI_STATUS arenaInit(ARENA *Arena, UINTN Pages) {
+    ZeroMem(Arena, sizeof(ARENA));
+    Arena->Pages = Pages;
+    return uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, Pages, &Arena->Base);
+}
+
+VOID *arenaAlloc(ARENA *Arena, UINTN Size) {
+    VOID *result;
+
+    Size = (Size + 7) & ~7;
+    if (Arena->Base == 0 || Size > (Arena->Pages << EFI_PAGE_SHIFT) - Arena->Used) {
+        Arena->Failed++;
+        return NULL;
+    }
+    result = (VOID *) (UINTN) (Arena->Base + Arena->Used);
+    Arena->Used += Size;
+    if (Arena->Used > Arena->HighWater)
+        Arena->HighWater = Arena->Used;
+    ZeroMem(result, Size);
+    return result;
+}
+
+VOID arenaReset(ARENA *Arena) {
+    Arena->Used = 0;
+    Arena->Resets++;
+}
+
+VOID arenaFree(ARENA *Arena) {
+    if (Arena->Base != 0)
+        uefi_call_wrapper(BS->FreePages, 2, Arena->Base, Arena->Pages);
+    Arena->Base = 0;
+    Arena->Used = 0;
+}
+
+CHAR16 *arenaChildPath(ARENA *Arena, EFI_DEVICE_PATH *ImagePath, CHAR16 *FileName) {
+    EFI_DEVICE_PATH *node;
+    CHAR16 *pathname, *name;
+    UINTN length = 0, dir = 0;
+
+    for (node = ImagePath; !IsDevicePathEnd(node); node = NextDevicePathNode(node)) {
+        if (DevicePathType(node) == MEDIA_DEVICE_PATH && DevicePathSubType(node) == MEDIA_FILEPATH_DP)
+            length += (DevicePathNodeLength(node) - SIZE_OF_FILEPATH_DEVICE_PATH) / sizeof(CHAR16) + 1;
+    }
+    pathname = arenaAlloc(Arena, (length + StrLen(FileName) + 1) * sizeof(CHAR16));
+    if (pathname == NULL)
+        return NULL;
+
+    /* concatenate all file path nodes, then cut after the last backslash */
+    length = 0;
+    for (node = ImagePath; !IsDevicePathEnd(node); node = NextDevicePathNode(node)) {
+        if (DevicePathType(node) != MEDIA_DEVICE_PATH || DevicePathSubType(node) != MEDIA_FILEPATH_DP)
+            continue;
+        name = ((FILEPATH_DEVICE_PATH *) node)->PathName;
+        if (length > 0 && pathname[length - 1] != L'\\' && name[0] != L'\\')
+            pathname[length++] = L'\\';
+        for (; *name && (UINT8 *) name < (UINT8 *) node + DevicePathNodeLength(node); name++)
+            pathname[length++] = *name;
+    }
+    for (dir = length; dir > 0 && pathname[dir - 1] != L'\\'; dir--) ;
+    /* an image in the root directory loads its children relative to the root */
+    if (dir == 1)
+        dir = 0;
+    pathname[dir] = L'\0';
+    StrCat(pathname, FileName);
+    return pathname;
+}
+
+EFI_DEVICE_PATH *arenaFileDevicePath(ARENA *Arena, EFI_HANDLE Device, CHAR16 *FileName) {
+    EFI_DEVICE_PATH *devicePath = NULL, *result, *end;
+    FILEPATH_DEVICE_PATH *file;
+    UINTN deviceSize = 0, fileSize;
+
+    if (FileName == NULL)
+        return NULL;
+    if (Device != NULL)
+        devicePath = DevicePathFromHandle(Device);
+    if (devicePath != NULL)
+        deviceSize = DevicePathSize(devicePath) - sizeof(EFI_DEVICE_PATH);
+    fileSize = SIZE_OF_FILEPATH_DEVICE_PATH + StrSize(FileName);
+
+    result = arenaAlloc(Arena, deviceSize + fileSize + sizeof(EFI_DEVICE_PATH));
+    if (result == NULL)
+        return NULL;
+    if (deviceSize)
+        CopyMem(result, devicePath, deviceSize);
+    file = (FILEPATH_DEVICE_PATH *) ((UINT8 *) result + deviceSize);
+    file->Header.Type = MEDIA_DEVICE_PATH;
+    file->Header.SubType = MEDIA_FILEPATH_DP;
+    SetDevicePathNodeLength(&file->Header, fileSize);
+    CopyMem(file->PathName, FileName, StrSize(FileName));
+    end = NextDevicePathNode(&file->Header);
+    SetDevicePathEndNode(end);
+    return result;
+}
@@ -0,0 +1,62 @@
+/*
+ * grml-plus UEFI tools - page backed arena for per-launch allocations
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+ * The menus allocate path names and device paths for every image they
+ * start. These come from a fixed set of pages that is reset in one step
+ * before the next launch, so returning to the menu any number of times
+ * does not grow the memory map.
+ */
+
+#define ARENA_PAGES 8
+
+typedef struct {
+    EFI_PHYSICAL_ADDRESS Base;
+    UINTN Pages;
+    UINTN Used;
+    UINTN HighWater;
+    UINTN Resets;
+    UINTN Failed;
+} ARENA;
+
+EFI_STATUS arenaInit(ARENA *Arena, UINTN Pages);
+VOID *arenaAlloc(ARENA *Arena, UINTN Size);
+VOID arenaReset(ARENA *Arena);
+VOID arenaFree(ARENA *Arena);
+/* directory of the image's own file path with FileName appended */
+CHAR16 *arenaChildPath(ARENA *Arena, EFI_DEVICE_PATH *ImagePath, CHAR16 *FileName);
+/* like FileDevicePath, but allocated from the arena */
+EFI_DEVICE_PATH *arenaFileDevicePath(ARENA *Arena, EFI_HANDLE Device, CHAR16 *FileName);
+
+#endif
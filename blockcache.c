@@ -0,0 +1,413 @@
+/*
+ * grml-plus UEFI tools - read-ahead cache in front of the boot disk
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "efiabi.h"
+#include "blockcache.h"
+
+#define EFI_BLOCK_IO2_PROTOCOL_GUID { 0xa77b2472, 0xe282, 0x4e9f, { 0xa2, 0x45, 0xc2, 0xc0, 0xe2, 0x7b, 0xbc, 0xc1 } }
+/* partitions inside partitions, e.g. El Torito images on a partitioned stick */
+#define MAX_PARTITION_DEPTH 4
+
+/* the hooks only get the BLOCK_IO, there is one cache at a time */
+static BLOCK_CACHE *activeCache;
+
+#ifdef NEED_THUNKS
+static EFI_STATUS thunk_cacheReadBlocks(EFI_BLOCK_IO *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer)
+__attribute__((unused));
+static EFI_STATUS thunk_cacheWriteBlocks(EFI_BLOCK_IO *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer)
+__attribute__((unused));
+#endif
+
+static UINT8 *lineData(BLOCK_CACHE *Cache, UINT32 Index) {
+    return Cache->Data + (UINTN) Index * BLOCK_CACHE_LINE_SIZE;
+}
+
+static UINT32 hashOf(EFI_LBA Line) {
+    return (UINT32) ((Line * 0x9e3779b97f4a7c15ULL) >> 56) % BLOCK_CACHE_HASH_SIZE;
+}
+
+static UINT32 findLine(BLOCK_CACHE *Cache, EFI_LBA Line) {
+    UINT32 i;
+
+    for (i = Cache->Hash[hashOf(Line)]; i != BLOCK_CACHE_NO_LINE; i = Cache->Lines[i].HashNext) {
+        if (Cache->Lines[i].Line == Line)
+            return i;
+    }
+    return BLOCK_CACHE_NO_LINE;
+}
+
+static VOID unhash(BLOCK_CACHE *Cache, UINT32 Index) {
+    UINT32 *link = &Cache->Hash[hashOf(Cache->Lines[Index].Line)];
+
+    while (*link != Index)
+        link = &Cache->Lines[*link].HashNext;
+    *link = Cache->Lines[Index].HashNext;
+    Cache->Lines[Index].Valid = FALSE;
+}
+
+/* moves a line to the newest end of the LRU list */
+static VOID touch(BLOCK_CACHE *Cache, UINT32 Index) {
+    BLOCK_CACHE_LINE *line = &Cache->Lines[Index];
+
+    if (Cache->Newest == Index)
+        return;
+    if (line->Older != BLOCK_CACHE_NO_LINE)
+        Cache->Lines[line->Older].Newer = line->Newer;
+    else
+        Cache->Oldest = line->Newer;
+    Cache->Lines[line->Newer].Older = line->Older;
+    line->Older = Cache->Newest;
+    line->Newer = BLOCK_CACHE_NO_LINE;
+    Cache->Lines[Cache->Newest].Newer = Index;
+    Cache->Newest = Index;
+}
+
+/* the least recently used line, now holding Line (its data is up to the caller) */
+static UINT32 claimLine(BLOCK_CACHE *Cache, EFI_LBA Line) {
+    UINT32 index = Cache->Oldest;
+    BLOCK_CACHE_LINE *line = &Cache->Lines[index];
+
+    if (line->Valid)
+        unhash(Cache, index);
+    line->Line = Line;
+    line->Valid = TRUE;
+    line->HashNext = Cache->Hash[hashOf(Line)];
+    Cache->Hash[hashOf(Line)] = index;
+    touch(Cache, index);
+    return index;
+}
+
+static VOID invalidateAll(BLOCK_CACHE *Cache) {
+    UINT32 i;
+
+    for (i = 0; i < BLOCK_CACHE_LINES; i++) {
+        Cache->Lines[i].Valid = FALSE;
+        Cache->Lines[i].Older = i > 0 ? i - 1 : BLOCK_CACHE_NO_LINE;
+        Cache->Lines[i].Newer = i + 1 < BLOCK_CACHE_LINES ? i + 1 : BLOCK_CACHE_NO_LINE;
+        Cache->Lines[i].HashNext = BLOCK_CACHE_NO_LINE;
+    }
+    for (i = 0; i < BLOCK_CACHE_HASH_SIZE; i++)
+        Cache->Hash[i] = BLOCK_CACHE_NO_LINE;
+    Cache->Oldest = 0;
+    Cache->Newest = BLOCK_CACHE_LINES - 1;
+    Cache->Window = 1;
+}
+
+static EFI_STATUS deviceRead(BLOCK_CACHE *Cache, EFI_LBA Lba, UINTN Size, VOID *Buffer) {
+    UINT64 start = perfTimestamp(), ticks;
+    EFI_STATUS status;
+
+    status = uefi_call_wrapper(Cache->OrigReadBlocks, 5, Cache->BlockIo, Cache->MediaId, Lba, Size, Buffer);
+    ticks = perfTimestamp() - start;
+    Cache->Stats.DeviceReads++;
+    Cache->Stats.DeviceBlocks += Size / Cache->BlockSize;
+    Cache->Stats.DeviceTicks += ticks;
+    if (Size == BLOCK_CACHE_LINE_SIZE) {
+        Cache->Stats.LineReads++;
+        Cache->Stats.LineTicks += ticks;
+    }
+    return status;
+}
+
+/* reads Count lines from First on (fewer at the end of the medium) with one device read */
+static EFI_STATUS fillLines(BLOCK_CACHE *Cache, EFI_LBA First, UINTN Count) {
+    UINT8 *window = lineData(Cache, BLOCK_CACHE_LINES);
+    EFI_LBA end = Cache->BlockIo->Media->LastBlock + 1, lba = First * Cache->LineBlocks;
+    EFI_STATUS status;
+    UINTN blocks = Count * Cache->LineBlocks, i;
+
+    if (blocks > end - lba)
+        blocks = (UINTN) (end - lba);
+    status = deviceRead(Cache, lba, blocks * Cache->BlockSize, window);
+    if (EFI_ERROR(status))
+        return status;
+    for (i = 0; i * Cache->LineBlocks < blocks; i++) {
+        if (findLine(Cache, First + i) != BLOCK_CACHE_NO_LINE)
+            continue;
+        CopyMem(lineData(Cache, claimLine(Cache, First + i)), window + i * BLOCK_CACHE_LINE_SIZE,
+            blocks - i * Cache->LineBlocks < Cache->LineBlocks ? (blocks - i * Cache->LineBlocks) * Cache->BlockSize
+                : BLOCK_CACHE_LINE_SIZE);
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS readCached(BLOCK_CACHE *Cache, EFI_LBA Lba, UINTN Blocks, UINT8 *Buffer) {
+    BOOLEAN sequential = Lba == Cache->NextLba, hit = TRUE;
+    EFI_LBA lba = Lba, end = Lba + Blocks, line;
+    EFI_STATUS status = EFI_SUCCESS;
+    UINTN offset, count, ahead;
+    UINT32 index;
+
+    while (lba < end) {
+        line = lba / Cache->LineBlocks;
+        offset = (UINTN) (lba % Cache->LineBlocks);
+        count = end - lba < Cache->LineBlocks - offset ? (UINTN) (end - lba) : Cache->LineBlocks - offset;
+        index = findLine(Cache, line);
+        if (index == BLOCK_CACHE_NO_LINE) {
+            hit = FALSE;
+            ahead = sequential ? Cache->Window : 1;
+            Cache->Window = sequential && Cache->Window < BLOCK_CACHE_MAX_WINDOW ? Cache->Window * 2 : sequential ? Cache->Window : 2;
+            status = fillLines(Cache, line, ahead);
+            if (EFI_ERROR(status)) {
+                /* the rest straight from the device, in case only the read-ahead part failed */
+                status = deviceRead(Cache, lba, (UINTN) (end - lba) * Cache->BlockSize, Buffer);
+                break;
+            }
+            index = findLine(Cache, line);
+        } else {
+            Cache->Stats.BlocksFromCache += count;
+        }
+        touch(Cache, index);
+        CopyMem(Buffer, lineData(Cache, index) + offset * Cache->BlockSize, count * Cache->BlockSize);
+        Buffer += count * Cache->BlockSize;
+        lba += count;
+        sequential = TRUE;
+    }
+    if (hit)
+        Cache->Stats.Hits++;
+    return status;
+}
+
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK cacheReadBlocks(EFI_BLOCK_IO *This, UINT32 MediaId, EFI_LBA Lba,
+        UINTN BufferSize, VOID *Buffer) {
+    BLOCK_CACHE *cache = activeCache;
+    EFI_BLOCK_IO_MEDIA *media = This->Media;
+    EFI_STATUS status;
+    UINT64 start, ticks;
+    UINTN blocks;
+    EFI_TPL tpl;
+
+    /* anything unusual is the driver's to judge */
+    if (MediaId != media->MediaId || media->BlockSize != cache->BlockSize || Buffer == NULL || BufferSize == 0 ||
+            BufferSize % cache->BlockSize != 0 || Lba > media->LastBlock ||
+            BufferSize / cache->BlockSize > media->LastBlock - Lba + 1)
+        return uefi_call_wrapper(cache->OrigReadBlocks, 5, This, MediaId, Lba, BufferSize, Buffer);
+
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_CALLBACK);
+    start = perfTimestamp();
+    if (MediaId != cache->MediaId) {
+        invalidateAll(cache);
+        cache->MediaId = MediaId;
+    }
+    blocks = BufferSize / cache->BlockSize;
+    cache->Stats.Requests++;
+    cache->Stats.BlocksRequested += blocks;
+    if (BufferSize > BLOCK_CACHE_MAX_WINDOW * BLOCK_CACHE_LINE_SIZE) {
+        status = uefi_call_wrapper(cache->OrigReadBlocks, 5, This, MediaId, Lba, BufferSize, Buffer);
+        ticks = perfTimestamp() - start;
+        cache->Stats.Bypassed++;
+        cache->Stats.BypassTicks += ticks;
+    } else {
+        status = readCached(cache, Lba, blocks, Buffer);
+        ticks = perfTimestamp() - start;
+    }
+    cache->NextLba = Lba + blocks;
+    cache->Stats.CacheTicks += ticks;
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    return status;
+}
+
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK cacheWriteBlocks(EFI_BLOCK_IO *This, UINT32 MediaId, EFI_LBA Lba,
+        UINTN BufferSize, VOID *Buffer) {
+    BLOCK_CACHE *cache = activeCache;
+    EFI_STATUS status;
+    EFI_LBA line, last;
+    EFI_TPL tpl;
+    UINT32 i, index;
+
+    status = uefi_call_wrapper(cache->OrigWriteBlocks, 5, This, MediaId, Lba, BufferSize, Buffer);
+    if (BufferSize == 0 || cache->BlockSize == 0)
+        return status;
+    /* even a failed write may have changed some of the blocks */
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_CALLBACK);
+    cache->Stats.Writes++;
+    line = Lba / cache->LineBlocks;
+    last = (Lba + (BufferSize + cache->BlockSize - 1) / cache->BlockSize - 1) / cache->LineBlocks;
+    if (last - line >= BLOCK_CACHE_LINES) {
+        for (i = 0; i < BLOCK_CACHE_LINES; i++) {
+            if (cache->Lines[i].Valid && cache->Lines[i].Line >= line && cache->Lines[i].Line <= last)
+                unhash(cache, i);
+        }
+    } else {
+        for (; line <= last; line++) {
+            index = findLine(cache, line);
+            if (index != BLOCK_CACHE_NO_LINE)
+                unhash(cache, index);
+        }
+    }
+    cache->NextLba = (EFI_LBA) -1;
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    return status;
+}
+
+#ifdef NEED_THUNKS
+/* MS -> ELF thunks for the hooks, see efiabi.h */
+THUNK5(cacheReadBlocks)
+THUNK5(cacheWriteBlocks)
+#endif
+
+/* the handle of the whole disk that Handle is a partition of, or Handle itself */
+static EFI_HANDLE findDisk(EFI_HANDLE Handle, EFI_BLOCK_IO **BlockIo) {
+    EFI_DEVICE_PATH *path, *node, *last, *remaining;
+    EFI_BLOCK_IO *parentIo;
+    EFI_HANDLE parent;
+    BOOLEAN found;
+    UINTN depth;
+
+    if (uefi_call_wrapper(BS->HandleProtocol, 3, Handle, &BlockIoProtocol, (VOID **) BlockIo) != EFI_SUCCESS)
+        return NULL;
+    for (depth = 0; depth < MAX_PARTITION_DEPTH && (*BlockIo)->Media->LogicalPartition; depth++) {
+        path = DevicePathFromHandle(Handle);
+        if (path == NULL || IsDevicePathEnd(path) || (path = DuplicateDevicePath(path)) == NULL)
+            break;
+        for (node = last = path; !IsDevicePathEnd(node); node = NextDevicePathNode(node))
+            last = node;
+        SetDevicePathEndNode(last);
+        remaining = path;
+        found = !IsDevicePathEnd(path) &&
+            uefi_call_wrapper(BS->LocateDevicePath, 3, &BlockIoProtocol, &remaining, &parent) == EFI_SUCCESS &&
+            IsDevicePathEnd(remaining) &&
+            uefi_call_wrapper(BS->HandleProtocol, 3, parent, &BlockIoProtocol, (VOID **) &parentIo) == EFI_SUCCESS;
+        FreePool(path);
+        if (!found)
+            break;
+        Handle = parent;
+        *BlockIo = parentIo;
+    }
+    return Handle;
+}
+
+EFI_STATUS blockCacheStart(BLOCK_CACHE *Cache, EFI_HANDLE DeviceHandle) {
+    EFI_GUID blockIo2Protocol = EFI_BLOCK_IO2_PROTOCOL_GUID;
+    EFI_PHYSICAL_ADDRESS data;
+    EFI_BLOCK_IO_MEDIA *media;
+    EFI_STATUS status;
+    VOID *blockIo2;
+    EFI_TPL tpl;
+
+    if (activeCache != NULL)
+        return EFI_ALREADY_STARTED;
+    ZeroMem(Cache, sizeof(BLOCK_CACHE));
+    Cache->Disk = findDisk(DeviceHandle, &Cache->BlockIo);
+    if (Cache->Disk == NULL)
+        return EFI_UNSUPPORTED;
+    if (uefi_call_wrapper(BS->HandleProtocol, 3, Cache->Disk, &blockIo2Protocol, &blockIo2) == EFI_SUCCESS)
+        return EFI_UNSUPPORTED;
+    media = Cache->BlockIo->Media;
+    if (!media->MediaPresent || media->BlockSize == 0 || BLOCK_CACHE_LINE_SIZE % media->BlockSize != 0)
+        return EFI_UNSUPPORTED;
+
+    Cache->DataPages = ((UINTN) (BLOCK_CACHE_LINES + BLOCK_CACHE_MAX_WINDOW) * BLOCK_CACHE_LINE_SIZE) >> EFI_PAGE_SHIFT;
+    status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, Cache->DataPages, &data);
+    if (status != EFI_SUCCESS)
+        return status;
+    Cache->Data = (UINT8 *) (UINTN) data;
+    Cache->MediaId = media->MediaId;
+    Cache->BlockSize = media->BlockSize;
+    Cache->LineBlocks = BLOCK_CACHE_LINE_SIZE / media->BlockSize;
+    Cache->NextLba = (EFI_LBA) -1;
+    invalidateAll(Cache);
+
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_NOTIFY);
+    activeCache = Cache;
+    Cache->OrigReadBlocks = Cache->BlockIo->ReadBlocks;
+    Cache->OrigWriteBlocks = Cache->BlockIo->WriteBlocks;
+    Cache->BlockIo->ReadBlocks = CALLBACK_ENTRY(cacheReadBlocks);
+    Cache->BlockIo->WriteBlocks = CALLBACK_ENTRY(cacheWriteBlocks);
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    Cache->Active = TRUE;
+    return EFI_SUCCESS;
+}
+
+VOID blockCacheStop(BLOCK_CACHE *Cache) {
+    EFI_BLOCK_IO *blockIo;
+    EFI_TPL tpl;
+
+    if (!Cache->Active)
+        return;
+    tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_NOTIFY);
+    /* a stick pulled meanwhile takes its BLOCK_IO with it */
+    if (uefi_call_wrapper(BS->HandleProtocol, 3, Cache->Disk, &BlockIoProtocol, (VOID **) &blockIo) == EFI_SUCCESS &&
+            blockIo == Cache->BlockIo) {
+        if (blockIo->ReadBlocks != CALLBACK_ENTRY(cacheReadBlocks) || blockIo->WriteBlocks != CALLBACK_ENTRY(cacheWriteBlocks)) {
+            uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+            return;
+        }
+        blockIo->ReadBlocks = Cache->OrigReadBlocks;
+        blockIo->WriteBlocks = Cache->OrigWriteBlocks;
+    }
+    activeCache = NULL;
+    uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    Cache->Active = FALSE;
+    uefi_call_wrapper(BS->FreePages, 2, (EFI_PHYSICAL_ADDRESS) (UINTN) Cache->Data, Cache->DataPages);
+    Cache->Data = NULL;
+}
+
+static UINT64 percentTenths(UINT64 Part, UINT64 Whole) {
+    return Whole ? Part * 1000 / Whole : 0;
+}
+
+VOID blockCacheReport(BLOCK_CACHE *Cache, TEXT_LINES *Text) {
+    BLOCK_CACHE_STATS *stats = &Cache->Stats;
+    UINT64 hits = percentTenths(stats->Hits, stats->Requests - stats->Bypassed);
+    UINT64 blocks = percentTenths(stats->BlocksFromCache, stats->BlocksRequested);
+    UINT64 lineTicks = stats->LineReads ? stats->LineTicks / stats->LineReads
+        : stats->DeviceReads ? stats->DeviceTicks / stats->DeviceReads : 0;
+    UINT64 without = (stats->Requests - stats->Bypassed) * lineTicks, with = stats->CacheTicks - stats->BypassTicks;
+    CHAR16 *path = DevicePathToStr(DevicePathFromHandle(Cache->Disk));
+
+    textLinesAdd(Text, PoolPrint(L"Disk: %s", path ? path : L"?"));
+    if (path)
+        FreePool(path);
+    textLinesAdd(Text, PoolPrint(L"Cache: %d lines of %d KB, read-ahead up to %d KB, %d byte blocks%s",
+        BLOCK_CACHE_LINES, BLOCK_CACHE_LINE_SIZE / 1024, BLOCK_CACHE_MAX_WINDOW * BLOCK_CACHE_LINE_SIZE / 1024,
+        Cache->BlockSize, Cache->Active ? L", still active (hooked over)" : L""));
+    textLinesAdd(Text, StrDuplicate(L""));
+    textLinesAdd(Text, PoolPrint(L"Read requests      %ld, %ld bypassed (larger than %d KB)", stats->Requests, stats->Bypassed,
+        BLOCK_CACHE_MAX_WINDOW * BLOCK_CACHE_LINE_SIZE / 1024));
+    textLinesAdd(Text, PoolPrint(L"Hit rate           %ld.%ld percent of the requests, %ld.%ld percent of the blocks", hits / 10, hits % 10,
+        blocks / 10, blocks % 10));
+    textLinesAdd(Text, PoolPrint(L"Device reads       %ld, %ld KB, %ld ms", stats->DeviceReads,
+        stats->DeviceBlocks * Cache->BlockSize / 1024, perfMicroseconds(stats->DeviceTicks) / 1000));
+    textLinesAdd(Text, PoolPrint(L"Write requests     %ld", stats->Writes));
+    textLinesAdd(Text, StrDuplicate(L""));
+    textLinesAdd(Text, PoolPrint(L"Time in the cache  %ld ms, device reads included", perfMicroseconds(with) / 1000));
+    textLinesAdd(Text, PoolPrint(L"Without the cache  about %ld ms, at %ld us per request (one line read)",
+        perfMicroseconds(without) / 1000, perfMicroseconds(lineTicks)));
+    if (without > with)
+        textLinesAdd(Text, PoolPrint(L"Saved              about %ld ms", perfMicroseconds(without - with) / 1000));
+    else
+        textLinesAdd(Text, StrDuplicate(L"Saved              nothing"));
+}
@@ -0,0 +1,118 @@
+/*
+ * grml-plus UEFI tools - read-ahead cache in front of the boot disk
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include "common.h"
+
+/*
+ * A read-ahead block cache for the images the loader starts.
+ *
+ * blockCacheStart looks up the whole-disk BLOCK_IO below DeviceHandle (the
+ * partition the loader was started from) and replaces its ReadBlocks and
+ * WriteBlocks in place. Every driver and image that opened
+ * the disk shares that one instance, so the partition and FAT drivers as
+ * well as GRUB's own disk code go through the cache; installing a second
+ * instance instead would make them all disconnect and reconnect. Disks that
+ * also have BLOCK_IO2 are left alone, as writes through it would bypass
+ * the cache.
+ *
+ * The cache holds BLOCK_CACHE_LINES lines of BLOCK_CACHE_LINE_SIZE bytes in
+ * EfiLoaderData pages, replaced least recently used first. A miss reads the
+ * line from the device; a miss right after the previous request reads ahead
+ * as well, doubling the window up to BLOCK_CACHE_MAX_WINDOW lines per
+ * device read. Requests larger than the window bypass the cache. Writes go
+ * to the device and drop the lines they touch. The hooks run at
+ * TPL_CALLBACK, like the firmware's own disk drivers.
+ *
+ * blockCacheStop restores the original functions and frees the cache,
+ * unless something hooked the same functions on top of us in the meantime;
+ * the cache then stays active (and allocated) for good. blockCacheReport
+ * adds the statistics to Text, including an estimate of the time saved:
+ * every request that did not bypass the cache is assumed to have cost one
+ * device read of a single line without it.
+ */
+
+#define BLOCK_CACHE_LINE_SIZE (64 * 1024)
+#define BLOCK_CACHE_LINES 128
+#define BLOCK_CACHE_MAX_WINDOW 8
+#define BLOCK_CACHE_HASH_SIZE 256
+#define BLOCK_CACHE_NO_LINE 0xffffffff
+
+/* line indexes are chained through Older/Newer (LRU order) and HashNext */
+typedef struct {
+    EFI_LBA Line;       /* first block / LineBlocks */
+    BOOLEAN Valid;
+    UINT32 Older, Newer;
+    UINT32 HashNext;
+} BLOCK_CACHE_LINE;
+
+typedef struct {
+    UINT64 Requests;
+    UINT64 Hits;            /* requests served from memory alone */
+    UINT64 BlocksRequested;
+    UINT64 BlocksFromCache;
+    UINT64 Bypassed;
+    UINT64 BypassTicks;
+    UINT64 Writes;
+    UINT64 DeviceReads;     /* for the cache, bypassed requests not included */
+    UINT64 DeviceBlocks;
+    UINT64 DeviceTicks;
+    UINT64 LineReads;       /* device reads of a single line */
+    UINT64 LineTicks;
+    UINT64 CacheTicks;      /* time spent in the read hook, device reads included */
+} BLOCK_CACHE_STATS;
+
+typedef struct {
+    BOOLEAN Active;
+    EFI_BLOCK_IO *BlockIo;
+    EFI_HANDLE Disk;
+    EFI_BLOCK_READ OrigReadBlocks;
+    EFI_BLOCK_WRITE OrigWriteBlocks;
+    UINT32 MediaId;
+    UINT32 BlockSize;
+    UINTN LineBlocks;
+    UINT8 *Data;        /* the lines, then the read-ahead window */
+    UINTN DataPages;
+    UINT32 Oldest, Newest;
+    UINT32 Hash[BLOCK_CACHE_HASH_SIZE];
+    BLOCK_CACHE_LINE Lines[BLOCK_CACHE_LINES];
+    EFI_LBA NextLba;    /* where a sequential request would start */
+    UINTN Window;       /* lines read ahead on the next sequential miss */
+    BLOCK_CACHE_STATS Stats;
+} BLOCK_CACHE;
+
+EFI_STATUS blockCacheStart(BLOCK_CACHE *Cache, EFI_HANDLE DeviceHandle);
+VOID blockCacheStop(BLOCK_CACHE *Cache);
+VOID blockCacheReport(BLOCK_CACHE *Cache, TEXT_LINES *Text);
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * grml-plus UEFI tools - stub child image for the QEMU boot benchmark
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Started by tools/qemu-bench.py in place of GRUB. Dumps the BootPerf
+ * variables the tools published right before starting it, together with its
+ * own entry timestamp, to the console (and thereby the serial port) and
+ * powers the machine off. Lines look like
+ *
+ *   BOOTBENCH child <tsc> <tsc frequency>
+ *   BOOTBENCH reads <files> <bytes> <ticks>
+ *   BOOTBENCH <variable> <offset> <up to 16 bytes in hex>
+ *   BOOTBENCH end
+ *
+ * and are kept short enough not to be wrapped by the console. The reads
+ * line stands for GRUB loading its modules, fonts and themes: every file in
+ * \bootbench on the child's own volume read in 4 KB pieces, if there is
+ * such a directory.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+
+#define READ_DIRECTORY L"\\bootbench"
+#define READ_SIZE 4096
+
+static CHAR16 *variableNames[] = { L"BootPerfSkipSign", L"BootPerfProtector", L"BootPerfLoader" };
+
+static VOID readFiles(EFI_HANDLE DeviceHandle) {
+    EFI_FILE_HANDLE root, dir, file;
+    EFI_FILE_INFO *info;
+    UINT8 buffer[READ_SIZE];
+    UINTN bufferSize = SIZE_OF_EFI_FILE_INFO + 256 * sizeof(CHAR16), size, files = 0;
+    UINT64 start = perfTimestamp(), bytes = 0;
+
+    root = LibOpenRoot(DeviceHandle);
+    if (root == NULL)
+        return;
+    if (uefi_call_wrapper(root->Open, 5, root, &dir, READ_DIRECTORY, EFI_FILE_MODE_READ, 0) != EFI_SUCCESS) {
+        uefi_call_wrapper(root->Close, 1, root);
+        return;
+    }
+    info = AllocatePool(bufferSize);
+    while (info != NULL) {
+        size = bufferSize;
+        if (uefi_call_wrapper(dir->Read, 3, dir, &size, info) != EFI_SUCCESS || size == 0)
+            break;
+        if ((info->Attribute & EFI_FILE_DIRECTORY) != 0 ||
+                uefi_call_wrapper(dir->Open, 5, dir, &file, info->FileName, EFI_FILE_MODE_READ, 0) != EFI_SUCCESS)
+            continue;
+        do {
+            size = sizeof(buffer);
+            if (uefi_call_wrapper(file->Read, 3, file, &size, buffer) != EFI_SUCCESS)
+                break;
+            bytes += size;
+        } while (size == sizeof(buffer));
+        uefi_call_wrapper(file->Close, 1, file);
+        files++;
+    }
+    if (info)
+        FreePool(info);
+    uefi_call_wrapper(dir->Close, 1, dir);
+    uefi_call_wrapper(root->Close, 1, root);
+    Print(L"BOOTBENCH reads %d %ld %ld\n", files, bytes, perfTimestamp() - start);
+}
+
+static VOID dumpVariable(CHAR16 *Name) {
+    EFI_GUID bootPerfGUID = BOOTPERF_VARIABLE_GUID;
+    UINT8 data[sizeof(BOOTPERF_HEADER) + BOOTPERF_MAX_RECORDS * sizeof(BOOTPERF_RECORD)];
+    CHAR16 hex[33];
+    UINTN size = sizeof(data), offset, i;
+
+    if (uefi_call_wrapper(RT->GetVariable, 5, Name, &bootPerfGUID, NULL, &size, data) != EFI_SUCCESS)
+        return;
+    for (offset = 0; offset < size; offset += 16) {
+        for (i = 0; i < 16 && offset + i < size; i++)
+            SPrint(hex + 2 * i, 3 * sizeof(CHAR16), L"%02x", data[offset + i]);
+        hex[2 * i] = L'\0';
+        Print(L"BOOTBENCH %s %d %s\n", Name, offset, hex);
+    }
+}
+
+EFI_STATUS efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
+    EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
+    EFI_LOADED_IMAGE *loadedImage;
+    UINT64 entry = perfTimestamp();
+    UINTN i;
+
+    InitializeLib(ImageHandle, SystemTable);
+    Print(L"\nBOOTBENCH child %ld %ld\n", entry, perfFrequency());
+    if (uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (VOID **) &loadedImage) == EFI_SUCCESS)
+        readFiles(loadedImage->DeviceHandle);
+    for (i = 0; i < sizeof(variableNames) / sizeof(variableNames[0]); i++)
+        dumpVariable(variableNames[i]);
+    Print(L"BOOTBENCH end\n");
+    uefi_call_wrapper(RT->ResetSystem, 4, EfiResetShutdown, EFI_SUCCESS, 0, NULL);
+    return EFI_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/*
+ * grml-plus UEFI tools - boot phase timestamps
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+
+static EFI_GUID bootPerfGUID = BOOTPERF_VARIABLE_GUID;
+static CHAR16 *perfVariableName;
+/* the same names as in tools/bootperf-decode */
+static CHAR16 *phaseNames[] = {
+    L"?", L"InitializeLib", L"security_policy_install", L"OpenVolume",
+    L"file probe", L"menu wait", L"LoadImage", L"StartImage", L"key to paint",
+    L"image hash", L"decompress", L"key to action", L"RAM disk load"
+};
+static struct {
+    BOOTPERF_HEADER Header;
+    BOOTPERF_RECORD Records[BOOTPERF_MAX_RECORDS];
+} __attribute__((packed)) perfData;
+
+UINT64 perfTimestamp(VOID) {
+    UINT32 lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((UINT64) hi << 32) | lo;
+}
+
+static void cpuid(UINT32 leaf, UINT32 *eax, UINT32 *ebx, UINT32 *ecx, UINT32 *edx) {
+    asm volatile ("cpuid" : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx) : "a" (leaf), "c" (0));
+}
+
+VOID perfInit(CHAR16 *VariableName) {
+    perfData.Header.EntryTsc = perfTimestamp();
+    perfData.Header.Signature = BOOTPERF_SIGNATURE;
+    perfData.Header.Version = BOOTPERF_VERSION;
+    perfData.Header.HeaderSize = sizeof(BOOTPERF_HEADER);
+    perfVariableName = VariableName;
+}
+
+UINT64 perfFrequency(VOID) {
+    UINT32 eax, ebx, ecx, edx;
+    UINT64 start;
+
+    if (perfData.Header.TscFrequency != 0)
+        return perfData.Header.TscFrequency;
+
+    /* prefer the architectural TSC/crystal ratio, fall back to timing a Stall */
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x15) {
+        cpuid(0x15, &eax, &ebx, &ecx, &edx);
+        if (eax != 0 && ebx != 0 && ecx != 0)
+            perfData.Header.TscFrequency = (UINT64) ecx * ebx / eax;
+    }
+    if (perfData.Header.TscFrequency == 0) {
+        start = perfTimestamp();
+        uefi_call_wrapper(BS->Stall, 1, 1000);
+        perfData.Header.TscFrequency = (perfTimestamp() - start) * 1000;
+    }
+    return perfData.Header.TscFrequency;
+}
+
+UINT64 perfMicroseconds(UINT64 Ticks) {
+    UINT64 mhz = perfFrequency() / 1000000;
+    return Ticks / (mhz ? mhz : 1);
+}
+
+CHAR16 *perfPhaseName(UINT16 Phase) {
+    return Phase < sizeof(phaseNames) / sizeof(phaseNames[0]) ? phaseNames[Phase] : phaseNames[0];
+}
+
+UINTN perfBegin(UINT16 Phase) {
+    UINTN record = perfData.Header.RecordCount;
+
+    if (record >= BOOTPERF_MAX_RECORDS) {
+        perfData.Header.Flags |= BOOTPERF_FLAG_OVERFLOW;
+        return BOOTPERF_MAX_RECORDS;
+    }
+    perfData.Header.RecordCount++;
+    perfData.Records[record].Phase = Phase;
+    perfData.Records[record].Count = 0;
+    perfData.Records[record].StartTsc = perfTimestamp();
+    perfData.Records[record].Ticks = 0;
+    return record;
+}
+
+VOID perfEnd(UINTN Record) {
+    if (Record >= BOOTPERF_MAX_RECORDS || perfData.Records[Record].Count != 0)
+        return;
+    perfData.Records[Record].Ticks = perfTimestamp() - perfData.Records[Record].StartTsc;
+    perfData.Records[Record].Count = 1;
+}
+
+/* add an interval to the last record if it has the same phase (menu waits) */
+VOID perfAccumulate(UINT16 Phase, UINT64 StartTsc) {
+    UINT64 now = perfTimestamp();
+    UINTN last = perfData.Header.RecordCount;
+    BOOTPERF_RECORD *rec;
+
+    if (last > 0 && perfData.Records[last - 1].Phase == Phase && perfData.Records[last - 1].Count != 0xffff) {
+        rec = &perfData.Records[last - 1];
+    } else {
+        last = perfBegin(Phase);
+        if (last >= BOOTPERF_MAX_RECORDS)
+            return;
+        rec = &perfData.Records[last];
+        rec->StartTsc = StartTsc;
+    }
+    rec->Ticks += now - StartTsc;
+    rec->Count++;
+}
+
+/*
+ * add an interval to the most recent record of Phase, wherever it is; for
+ * events that recur all through the run (key-to-paint latency), so that they
+ * take a single record. StartTsc stays that of the first interval.
+ */
+VOID perfTally(UINT16 Phase, UINT64 StartTsc) {
+    perfTallyTicks(Phase, StartTsc, perfTimestamp() - StartTsc);
+}
+
+/* the same for an interval measured elsewhere, e.g. on an application processor */
+VOID perfTallyTicks(UINT16 Phase, UINT64 StartTsc, UINT64 Ticks) {
+    UINTN i = perfData.Header.RecordCount;
+
+    while (i > 0 && perfData.Records[i - 1].Phase != Phase)
+        i--;
+    if (i == 0 || perfData.Records[i - 1].Count == 0xffff) {
+        i = perfBegin(Phase);
+        if (i >= BOOTPERF_MAX_RECORDS)
+            return;
+        perfData.Records[i].StartTsc = StartTsc;
+        i++;
+    }
+    perfData.Records[i - 1].Ticks += Ticks;
+    perfData.Records[i - 1].Count++;
+}
+
+VOID perfPublish(VOID) {
+    if (perfVariableName == NULL)
+        return;
+    perfFrequency();
+    uefi_call_wrapper(RT->SetVariable, 5, perfVariableName, &bootPerfGUID,
+        EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+        sizeof(BOOTPERF_HEADER) + perfData.Header.RecordCount * sizeof(BOOTPERF_RECORD), &perfData);
+}
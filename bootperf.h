@@ -0,0 +1,98 @@
+/*
+ * grml-plus UEFI tools - boot phase timestamps
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BOOTPERF_H
+#define BOOTPERF_H
+
+/*
+ * Every tool records TSC timestamps around the phases of its efi_main and
+ * publishes them as a volatile variable (BootPerfSkipSign, BootPerfProtector,
+ * BootPerfLoader) under BOOTPERF_VARIABLE_GUID. Since the variables are
+ * runtime accessible, they can be read from efivarfs after boot and decoded
+ * with tools/bootperf-decode.
+ *
+ * Layout (little endian, version 1): one BOOTPERF_HEADER followed by
+ * RecordCount BOOTPERF_RECORD entries. A record with Count == 0 was still
+ * running when the variable was last written (e.g. a StartImage that never
+ * returned). All timestamps are raw TSC values, TscFrequency converts them.
+ */
+
+#define BOOTPERF_VARIABLE_GUID { 0x1b8881b9, 0xa2e5, 0x43c6, { 0xbf, 0x6b, 0x15, 0x93, 0x5c, 0x81, 0x3b, 0xb1 } }
+#define BOOTPERF_SIGNATURE 0x46505247 /* "GRPF" */
+#define BOOTPERF_VERSION 1
+#define BOOTPERF_MAX_RECORDS 32
+#define BOOTPERF_FLAG_OVERFLOW 0x00000001
+
+#define PERF_INITIALIZE_LIB 1
+#define PERF_SECURITY_INSTALL 2
+#define PERF_OPEN_VOLUME 3
+#define PERF_FILE_PROBE 4
+#define PERF_MENU_WAIT 5
+#define PERF_LOAD_IMAGE 6
+#define PERF_START_IMAGE 7
+#define PERF_KEY_TO_PAINT 8
+#define PERF_IMAGE_HASH 9
+#define PERF_DECOMPRESS 10
+#define PERF_KEY_TO_ACTION 11
+#define PERF_RAM_DISK_LOAD 12
+
+typedef struct {
+    UINT32 Signature;
+    UINT16 Version;
+    UINT16 HeaderSize;
+    UINT32 RecordCount;
+    UINT32 Flags;
+    UINT64 TscFrequency;
+    UINT64 EntryTsc;
+} __attribute__((packed)) BOOTPERF_HEADER;
+
+typedef struct {
+    UINT16 Phase;
+    UINT16 Count;
+    UINT32 Reserved;
+    UINT64 StartTsc;
+    UINT64 Ticks;
+} __attribute__((packed)) BOOTPERF_RECORD;
+
+/* call first thing in efi_main, before InitializeLib */
+VOID perfInit(CHAR16 *VariableName);
+UINT64 perfTimestamp(VOID);
+UINT64 perfFrequency(VOID);
+UINT64 perfMicroseconds(UINT64 Ticks);
+CHAR16 *perfPhaseName(UINT16 Phase);
+UINTN perfBegin(UINT16 Phase);
+VOID perfEnd(UINTN Record);
+VOID perfAccumulate(UINT16 Phase, UINT64 StartTsc);
+VOID perfTally(UINT16 Phase, UINT64 StartTsc);
+VOID perfTallyTicks(UINT16 Phase, UINT64 StartTsc, UINT64 Ticks);
+VOID perfPublish(VOID);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * grml-plus UEFI tools - firmware call and callback overhead benchmark
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "efiabi.h"
+#include "callbench.h"
+
+/*
+ * The ms_abi attribute does not depend on the build mode, so the wrapper
+ * build can time the direct calls a native build would make, next to its
+ * own uefi_call_wrapper calls and thunks.
+ */
+typedef EFI_TPL (__attribute__((ms_abi)) *MS_RAISE_TPL)(EFI_TPL NewTpl);
+typedef VOID (__attribute__((ms_abi)) *MS_RESTORE_TPL)(EFI_TPL OldTpl);
+typedef UINTN (__attribute__((ms_abi)) *MS_CALLBACK)(UINTN A, UINTN B);
+
+static volatile UINTN sink;
+
+static __attribute__((used)) UINTN EFI_CALLBACK benchCallback(UINTN A, UINTN B) {
+    return A + B;
+}
+
+#ifdef NEED_THUNKS
+/* unlike the other thunks this one is called from C, so it must be declared ms_abi */
+static UINTN __attribute__((ms_abi)) thunk_benchCallback(UINTN A, UINTN B)
+__attribute__((unused));
+
+THUNK4(benchCallback)
+
+static UINTN __attribute__((ms_abi)) nativeCallback(UINTN A, UINTN B) {
+    return A + B;
+}
+#endif
+
+static VOID report(CHAR16 *Label, UINT64 Ticks) {
+    UINT64 mhz = perfFrequency() / 1000000;
+    UINT64 tenths = mhz ? Ticks * 10000 / mhz / CALLBENCH_ROUNDS : 0;
+
+    Print(L"  %-22s %5ld.%ld ns/call  %5ld ticks/call\n", Label, tenths / 10, tenths % 10, Ticks / CALLBENCH_ROUNDS);
+}
+
+static UINT64 timeCallback(MS_CALLBACK Callback) {
+    /* through a volatile pointer, so the compiler cannot see the target */
+    MS_CALLBACK volatile target = Callback;
+    UINT64 start;
+    UINTN i;
+
+    start = perfTimestamp();
+    for (i = 0; i < CALLBENCH_ROUNDS; i++)
+        sink = target(i, sink);
+    return perfTimestamp() - start;
+}
+
+VOID callBenchmark(VOID) {
+    MS_RAISE_TPL raiseTpl = (MS_RAISE_TPL) BS->RaiseTPL;
+    MS_RESTORE_TPL restoreTpl = (MS_RESTORE_TPL) BS->RestoreTPL;
+    EFI_INPUT_KEY key;
+    EFI_TPL tpl, current;
+    UINT64 start;
+    UINTN i;
+
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    Print(L"Call overhead benchmark (%s build, %d rounds)\n\n", ABI_MODE_NAME, CALLBENCH_ROUNDS);
+
+    /* raising to the current TPL is a no-op, so only the call itself is timed */
+    current = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_HIGH_LEVEL);
+    uefi_call_wrapper(BS->RestoreTPL, 1, current);
+
+    Print(L"Firmware call (RaiseTPL + RestoreTPL)\n");
+#ifdef NEED_THUNKS
+    start = perfTimestamp();
+    for (i = 0; i < CALLBENCH_ROUNDS; i++) {
+        tpl = uefi_call_wrapper(BS->RaiseTPL, 1, current);
+        uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    }
+    report(L"uefi_call_wrapper", perfTimestamp() - start);
+#endif
+    start = perfTimestamp();
+    for (i = 0; i < CALLBENCH_ROUNDS; i++) {
+        tpl = raiseTpl(current);
+        restoreTpl(tpl);
+    }
+    report(L"direct ms_abi", perfTimestamp() - start);
+
+    Print(L"\nCallback from firmware\n");
+#ifdef NEED_THUNKS
+    report(L"asm thunk", timeCallback(CALLBACK_ENTRY(benchCallback)));
+    report(L"native ms_abi", timeCallback(nativeCallback));
+#else
+    report(L"native ms_abi", timeCallback(benchCallback));
+#endif
+
+    Print(L"\nPress any key to return to the menu.\n");
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+}
@@ -0,0 +1,241 @@
+/*
+ * grml-plus UEFI tools - helpers shared by all tools
+ *
+ * Copyright 2014, 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+#include <efierr.h>
+
+#include "bootperf.h"
+#include "security.h"
+#include "common.h"
+
+EFI_STATUS loadChildImage(EFI_HANDLE ParentImage, EFI_DEVICE_PATH *FilePath, PREFETCH *Prefetch, EFI_HANDLE *NewImage) {
+    EFI_STATUS status;
+    UINTN record;
+
+    *NewImage = NULL;
+    record = perfBegin(PERF_LOAD_IMAGE);
+    status = prefetchLoadImage(Prefetch, ParentImage, FilePath, NewImage);
+    perfEnd(record);
+    if (status != EFI_SUCCESS && *NewImage != NULL) {
+        /* a security violation still leaves an image behind */
+        if (status == EFI_SECURITY_VIOLATION)
+            unloadImage(*NewImage);
+        *NewImage = NULL;
+    }
+    return status;
+}
+
+EFI_STATUS startChildImage(EFI_HANDLE Image) {
+    EFI_STATUS status;
+    UINTN record;
+
+    record = perfBegin(PERF_START_IMAGE);
+    perfPublish();
+    status = uefi_call_wrapper(BS->StartImage, 3, Image, NULL, NULL);
+    perfEnd(record);
+    perfPublish();
+    return status;
+}
+
+/*
+ * Applications are normally unloaded by the firmware when they return, but not
+ * by every firmware, and never if StartImage failed. Drivers stay resident.
+ */
+VOID unloadImage(EFI_HANDLE Image) {
+    EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
+    EFI_LOADED_IMAGE *li;
+
+    if (uefi_call_wrapper(BS->HandleProtocol, 3, Image, &loadedImageProtocol, (void **)&li) == EFI_SUCCESS &&
+            li->ImageCodeType == EfiLoaderCode)
+        uefi_call_wrapper(BS->UnloadImage, 1, Image);
+}
+
+BOOLEAN fileExists(EFI_FILE_HANDLE Root, CHAR16 *FileName) {
+    EFI_FILE_HANDLE file;
+
+    if (uefi_call_wrapper(Root->Open, 5, Root, &file, FileName, EFI_FILE_MODE_READ, 0) != EFI_SUCCESS)
+        return FALSE;
+    uefi_call_wrapper(file->Close, 1, file);
+    return TRUE;
+}
+
+VOID memoryMapUsage(UINT64 NoPages[EfiMaxMemoryType]) {
+    UINTN i, j, DescriptorSize;
+    UINT32 DescriptorVersion;
+    EFI_MEMORY_DESCRIPTOR *Desc, *MemMap;
+
+    for(i = 0; i < EfiMaxMemoryType; i++) {
+        NoPages[i] = 0;
+    }
+
+    MemMap = LibMemoryMap (&j, &i, &DescriptorSize, &DescriptorVersion);
+    Desc = MemMap;
+    for (i = 0; i < j; i++) {
+        if (Desc->Type < EfiMaxMemoryType)
+            NoPages[Desc->Type] += Desc->NumberOfPages;
+        Desc = NextMemoryDescriptor(Desc, DescriptorSize);
+    }
+    if (MemMap)
+        FreePool(MemMap);
+}
+
+/*
+ * Only images and what they allocate live in the loader types; the others
+ * also move with the firmware's own pool use, so they are shown but not held
+ * against us.
+ */
+BOOLEAN memoryMapCheck(UINT64 StartPages[EfiMaxMemoryType]) {
+    UINT64 NoPages[EfiMaxMemoryType];
+    BOOLEAN clean = TRUE;
+    UINTN i;
+
+    memoryMapUsage(NoPages);
+    for (i = 0; i < EfiMaxMemoryType; i++) {
+        if (NoPages[i] == StartPages[i])
+            continue;
+        Print(L"Memory type %04x: %ld pages since startup\n", i, (INT64)(NoPages[i] - StartPages[i]));
+        if (i == EfiLoaderCode || i == EfiLoaderData)
+            clean = FALSE;
+    }
+    return clean;
+}
+
+/* full device path of an image's file, as LoadImage needs it */
+static EFI_DEVICE_PATH *imageDevicePath(EFI_LOADED_IMAGE *Image) {
+    EFI_DEVICE_PATH *devicePath = DevicePathFromHandle(Image->DeviceHandle), *result;
+    UINTN deviceSize = 0, fileSize = DevicePathSize(Image->FilePath);
+
+    if (devicePath != NULL)
+        deviceSize = DevicePathSize(devicePath) - sizeof(EFI_DEVICE_PATH);
+    result = AllocatePool(deviceSize + fileSize);
+    if (result == NULL)
+        return NULL;
+    if (deviceSize)
+        CopyMem(result, devicePath, deviceSize);
+    CopyMem((UINT8 *) result + deviceSize, Image->FilePath, fileSize);
+    return result;
+}
+
+EFI_STATUS restartImage(EFI_HANDLE ImageHandle, CHAR16 *LoadOptions, BOOLEAN *Started) {
+    EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
+    EFI_LOADED_IMAGE *li, *newLi;
+    EFI_DEVICE_PATH *path;
+    EFI_HANDLE newImage;
+    EFI_STATUS status;
+
+    *Started = FALSE;
+    status = uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (void **)&li);
+    if (status != EFI_SUCCESS)
+        return status;
+    path = imageDevicePath(li);
+    if (path == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    status = loadChildImage(ImageHandle, path, NULL, &newImage);
+    FreePool(path);
+    if (status != EFI_SUCCESS)
+        return status;
+    if (LoadOptions != NULL &&
+            uefi_call_wrapper(BS->HandleProtocol, 3, newImage, &loadedImageProtocol, (void **)&newLi) == EFI_SUCCESS) {
+        newLi->LoadOptions = LoadOptions;
+        newLi->LoadOptionsSize = StrSize(LoadOptions);
+    }
+    *Started = TRUE;
+    status = startChildImage(newImage);
+    unloadImage(newImage);
+    return status;
+}
+
+VOID textLinesAdd(TEXT_LINES *Text, CHAR16 *Line) {
+    CHAR16 **lines;
+
+    if (Line == NULL)
+        return;
+    if (Text->Count == Text->Capacity) {
+        lines = ReallocatePool(Text->Lines, Text->Capacity * sizeof(CHAR16 *), (Text->Capacity + 64) * sizeof(CHAR16 *));
+        if (lines == NULL) {
+            FreePool(Line);
+            return;
+        }
+        Text->Lines = lines;
+        Text->Capacity += 64;
+    }
+    Text->Lines[Text->Count++] = Line;
+}
+
+VOID textLinesFree(TEXT_LINES *Text) {
+    UINTN i;
+
+    for (i = 0; i < Text->Count; i++)
+        FreePool(Text->Lines[i]);
+    if (Text->Lines)
+        FreePool(Text->Lines);
+    Text->Lines = NULL;
+    Text->Count = Text->Capacity = 0;
+}
+
+VOID textLinesShow(TEXT_LINES *Text, CHAR16 *Title) {
+    UINTN columns, rows, page, top = 0, last, i;
+    EFI_INPUT_KEY key;
+
+    if (uefi_call_wrapper(ST->ConOut->QueryMode, 4, ST->ConOut, ST->ConOut->Mode->Mode, &columns, &rows) != EFI_SUCCESS)
+        rows = 25;
+    /* the title, a blank line and the status line */
+    page = rows > 4 ? rows - 3 : 1;
+    last = Text->Count > page ? Text->Count - page : 0;
+
+    while (TRUE) {
+        uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+        Print(L"%s\n\n", Title);
+        for (i = top; i < Text->Count && i < top + page; i++)
+            Print(L"%s\n", Text->Lines[i]);
+        if (Text->Count > page)
+            PrintAt(0, rows - 1, L"Lines %d-%d of %d, cursor keys to scroll, any other key: back",
+                top + 1, i, Text->Count);
+        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+        if (uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key) != EFI_SUCCESS)
+            continue;
+        if (key.ScanCode == SCAN_UP && top > 0)
+            top--;
+        else if (key.ScanCode == SCAN_DOWN && top < last)
+            top++;
+        else if (key.ScanCode == SCAN_PAGE_UP)
+            top = top > page ? top - page : 0;
+        else if (key.ScanCode == SCAN_PAGE_DOWN)
+            top = top + page < last ? top + page : last;
+        else if (key.ScanCode == SCAN_HOME)
+            top = 0;
+        else if (key.ScanCode == SCAN_END)
+            top = last;
+        else if (key.ScanCode != SCAN_UP && key.ScanCode != SCAN_DOWN)
+            return;
+    }
+}
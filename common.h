@@ -0,0 +1,68 @@
+/*
+ * grml-plus UEFI tools - helpers shared by all tools
+ *
+ * Copyright 2014, 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMMON_H
+#define COMMON_H
+
+#include "prefetch.h"
+
+/* LoadImage with boot phase timing; Prefetch may be NULL */
+EFI_STATUS loadChildImage(EFI_HANDLE ParentImage, EFI_DEVICE_PATH *FilePath, PREFETCH *Prefetch, EFI_HANDLE *NewImage);
+/* StartImage with boot phase timing, published before and after */
+EFI_STATUS startChildImage(EFI_HANDLE Image);
+VOID unloadImage(EFI_HANDLE Image);
+/* TRUE if FileName can be opened for reading on Root */
+BOOLEAN fileExists(EFI_FILE_HANDLE Root, CHAR16 *FileName);
+/* pages per memory type in the current memory map */
+VOID memoryMapUsage(UINT64 NoPages[EfiMaxMemoryType]);
+/* prints the types whose page count differs from StartPages; TRUE if the loader types match */
+BOOLEAN memoryMapCheck(UINT64 StartPages[EfiMaxMemoryType]);
+/*
+ * Loads a fresh copy of the running image from disk and starts it with
+ * LoadOptions (may be NULL). Started tells whether it ran; if so, its exit
+ * status is returned.
+ */
+EFI_STATUS restartImage(EFI_HANDLE ImageHandle, CHAR16 *LoadOptions, BOOLEAN *Started);
+
+/* lines of a report that may be longer than the screen */
+typedef struct {
+    CHAR16 **Lines;
+    UINTN Count;
+    UINTN Capacity;
+} TEXT_LINES;
+
+/* takes over Line (from the pool); NULL, as PoolPrint returns when out of memory, is skipped */
+VOID textLinesAdd(TEXT_LINES *Text, CHAR16 *Line);
+VOID textLinesFree(TEXT_LINES *Text);
+/* shows Text below Title, scrolled with the cursor keys, Page Up/Down, Home and End; any other key returns */
+VOID textLinesShow(TEXT_LINES *Text, CHAR16 *Title);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * grml-plus UEFI tools - sha256sum line parser
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DIGESTLINE_H
+#define DIGESTLINE_H
+
+/*
+ * Shared by allowlist.c and tools/allowlist-index.c, so it only uses plain C
+ * types. A line is accepted if it starts with exactly 64 hex digits, as
+ * sha256sum writes them; Line need not be terminated, Length bytes are read
+ * at most.
+ */
+
+#define DIGESTLINE_SIZE 32
+
+static inline int digestLineHexDigit(unsigned char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/* returns 1 and fills Digest if the line is accepted; Digest may be changed either way */
+static inline int parseDigestLine(const unsigned char *Line, unsigned long Length, unsigned char *Digest) {
+    unsigned long i;
+    int high, low;
+
+    if (Length < 2 * DIGESTLINE_SIZE)
+        return 0;
+    for (i = 0; i < DIGESTLINE_SIZE; i++) {
+        high = digestLineHexDigit(Line[2 * i]);
+        low = digestLineHexDigit(Line[2 * i + 1]);
+        if (high < 0 || low < 0)
+            return 0;
+        Digest[i] = (unsigned char) (high << 4 | low);
+    }
+    return Length == 2 * DIGESTLINE_SIZE || digestLineHexDigit(Line[2 * DIGESTLINE_SIZE]) < 0;
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * grml-plus UEFI tools - calling convention glue for firmware callbacks
+ *
+ * Copyright 2014, 2017 Michael Schierl <schierlm@gmx.de>
+ *
+ * Based on the Linux Foundation's PreLoader, which is
+ *
+ * Copyright 2012 <James.Bottomley@HansenPartnership.com>
+ *
+ * Licensed under version 2 of the GNU General Public Licence.
+ *
+ * For details see <http://git.kernel.org/cgit/linux/kernel/git/jejb/efitools.git/tree/COPYING>
+ */
+
+#ifndef EFIABI_H
+#define EFIABI_H
+
+/*
+ * The tools can be built in two ways (see the Makefile):
+ *
+ * - the default EFI_FUNCTION_WRAPPER mode, where the code uses the ELF ABI,
+ *   firmware calls go through uefi_call_wrapper, and every function handed
+ *   to the firmware needs a hand-written MS -> ELF thunk_<name>
+ * - the native GNU_EFI_USE_MS_ABI mode, where EFIAPI is ms_abi, firmware
+ *   calls are plain calls and callbacks are given to the firmware as they are
+ *
+ * Callbacks are therefore declared EFI_CALLBACK and installed through
+ * CALLBACK_ENTRY(name), and their thunks are wrapped in #ifdef NEED_THUNKS.
+ */
+#ifdef GNU_EFI_USE_MS_ABI
+#define EFI_CALLBACK EFIAPI
+#define CALLBACK_ENTRY(name) name
+#define ABI_MODE_NAME L"native ms_abi"
+#else
+#define NEED_THUNKS
+#define EFI_CALLBACK
+#define CALLBACK_ENTRY(name) thunk_##name
+#define ABI_MODE_NAME L"uefi_call_wrapper"
+
+/*
+ * xmm6 to xmm15 are preserved across calls in the MS ABI but not in the ELF
+ * one, and the ELF side is free to use them (e.g. for SHA-NI hashing in the
+ * security policy hooks), so the thunks save them around the call.
+ */
+#define THUNK_SAVE_XMM \
+    "subq    $160, %rsp\n\t" \
+    "movdqu    %xmm6, 0(%rsp)\n\t" \
+    "movdqu    %xmm7, 16(%rsp)\n\t" \
+    "movdqu    %xmm8, 32(%rsp)\n\t" \
+    "movdqu    %xmm9, 48(%rsp)\n\t" \
+    "movdqu    %xmm10, 64(%rsp)\n\t" \
+    "movdqu    %xmm11, 80(%rsp)\n\t" \
+    "movdqu    %xmm12, 96(%rsp)\n\t" \
+    "movdqu    %xmm13, 112(%rsp)\n\t" \
+    "movdqu    %xmm14, 128(%rsp)\n\t" \
+    "movdqu    %xmm15, 144(%rsp)\n\t"
+#define THUNK_RESTORE_XMM \
+    "movdqu    0(%rsp), %xmm6\n\t" \
+    "movdqu    16(%rsp), %xmm7\n\t" \
+    "movdqu    32(%rsp), %xmm8\n\t" \
+    "movdqu    48(%rsp), %xmm9\n\t" \
+    "movdqu    64(%rsp), %xmm10\n\t" \
+    "movdqu    80(%rsp), %xmm11\n\t" \
+    "movdqu    96(%rsp), %xmm12\n\t" \
+    "movdqu    112(%rsp), %xmm13\n\t" \
+    "movdqu    128(%rsp), %xmm14\n\t" \
+    "movdqu    144(%rsp), %xmm15\n\t" \
+    "addq    $160, %rsp\n\t"
+
+/*
+ * THUNK4(name) emits thunk_<name>, an MS -> ELF thunk for a callback with
+ * at most four arguments, which are all passed in registers. See the comment
+ * in security.c for the details of the two calling conventions.
+ */
+#define THUNK4(name) \
+asm ( \
+".type " #name ",@function\n" \
+"thunk_" #name ":\n\t" \
+    "push    %rdi\n\t" \
+    "push    %rsi\n\t" \
+    THUNK_SAVE_XMM \
+    "subq    $8, %rsp    # space for storing stack pad\n\t" \
+    "mov    $0x08, %rax\n\t" \
+    "mov    $0x10, %r10\n\t" \
+    "and    %rsp, %rax\n\t" \
+    "cmovnz    %rax, %r11\n\t" \
+    "cmovz    %r10, %r11\n\t" \
+    "subq    %r11, %rsp\n\t" \
+    "addq    $8, %r11\n\t" \
+    "mov    %r11, (%rsp)\n\t" \
+"# four argument swizzle\n\t" \
+    "mov    %rcx, %rdi\n\t" \
+    "mov    %rdx, %rsi\n\t" \
+    "mov    %r8, %rdx\n\t" \
+    "mov    %r9, %rcx\n\t" \
+    "callq    " #name "@PLT\n\t" \
+    "mov    (%rsp), %r11\n\t" \
+    "addq    %r11, %rsp\n\t" \
+    THUNK_RESTORE_XMM \
+    "pop    %rsi\n\t" \
+    "pop    %rdi\n\t" \
+    "ret\n" \
+);
+
+/*
+ * THUNK5(name) does the same for five arguments, the fifth of which the MS
+ * caller passes on the stack above the 32 byte shadow space
+ */
+#define THUNK5(name) \
+asm ( \
+".type " #name ",@function\n" \
+"thunk_" #name ":\n\t" \
+    "mov    0x28(%rsp), %r10    # ARG5\n\t" \
+    "push    %rdi\n\t" \
+    "push    %rsi\n\t" \
+    "mov    %r10, %rdi\n\t" \
+    THUNK_SAVE_XMM \
+    "subq    $8, %rsp    # space for storing stack pad\n\t" \
+    "mov    $0x08, %rax\n\t" \
+    "mov    $0x10, %r10\n\t" \
+    "and    %rsp, %rax\n\t" \
+    "cmovnz    %rax, %r11\n\t" \
+    "cmovz    %r10, %r11\n\t" \
+    "subq    %r11, %rsp\n\t" \
+    "addq    $8, %r11\n\t" \
+    "mov    %r11, (%rsp)\n\t" \
+"# five argument swizzle\n\t" \
+    "mov    %rdi, %r10\n\t" \
+    "mov    %rcx, %rdi\n\t" \
+    "mov    %rdx, %rsi\n\t" \
+    "mov    %r8, %rdx\n\t" \
+    "mov    %r9, %rcx\n\t" \
+    "mov    %r10, %r8\n\t" \
+    "callq    " #name "@PLT\n\t" \
+    "mov    (%rsp), %r11\n\t" \
+    "addq    %r11, %rsp\n\t" \
+    THUNK_RESTORE_XMM \
+    "pop    %rsi\n\t" \
+    "pop    %rdi\n\t" \
+    "ret\n" \
+);
+#endif
+
+#endif
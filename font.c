@@ -0,0 +1,896 @@
+/*
+ * grml-plus UEFI tools - built-in bitmap font
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+
+#include "font.h"
+
+/*
+ * 5x7 glyphs for ASCII 0x20 to 0x7e, one byte per row, bit 4 is the
+ * leftmost pixel. Lowercase descenders sit on the bottom rows.
+ */
+const UINT8 fontGlyphs[FONT_LAST - FONT_FIRST + 1][FONT_GLYPH_ROWS] = {
+    { /* ' ' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* '!' */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x00, /* ..... */
+        0x04  /* ..#.. */
+    },
+    { /* '"' */
+        0x0a, /* .#.#. */
+        0x0a, /* .#.#. */
+        0x0a, /* .#.#. */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* '#' */
+        0x0a, /* .#.#. */
+        0x0a, /* .#.#. */
+        0x1f, /* ##### */
+        0x0a, /* .#.#. */
+        0x1f, /* ##### */
+        0x0a, /* .#.#. */
+        0x0a  /* .#.#. */
+    },
+    { /* '$' */
+        0x04, /* ..#.. */
+        0x0f, /* .#### */
+        0x14, /* #.#.. */
+        0x0e, /* .###. */
+        0x05, /* ..#.# */
+        0x1e, /* ####. */
+        0x04  /* ..#.. */
+    },
+    { /* '%' */
+        0x18, /* ##... */
+        0x19, /* ##..# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x13, /* #..## */
+        0x03  /* ...## */
+    },
+    { /* '&' */
+        0x0c, /* .##.. */
+        0x12, /* #..#. */
+        0x14, /* #.#.. */
+        0x08, /* .#... */
+        0x15, /* #.#.# */
+        0x12, /* #..#. */
+        0x0d  /* .##.# */
+    },
+    { /* '\'' */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* '(' */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x02  /* ...#. */
+    },
+    { /* ')' */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08  /* .#... */
+    },
+    { /* '*' */
+        0x00, /* ..... */
+        0x04, /* ..#.. */
+        0x15, /* #.#.# */
+        0x0e, /* .###. */
+        0x15, /* #.#.# */
+        0x04, /* ..#.. */
+        0x00  /* ..... */
+    },
+    { /* '+' */
+        0x00, /* ..... */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x1f, /* ##### */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x00  /* ..... */
+    },
+    { /* ',' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x04, /* ..#.. */
+        0x08  /* .#... */
+    },
+    { /* '-' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x1f, /* ##### */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* '.' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x0c  /* .##.. */
+    },
+    { /* '/' */
+        0x00, /* ..... */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x10, /* #.... */
+        0x00  /* ..... */
+    },
+    { /* '0' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x13, /* #..## */
+        0x15, /* #.#.# */
+        0x19, /* ##..# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* '1' */
+        0x04, /* ..#.. */
+        0x0c, /* .##.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x0e  /* .###. */
+    },
+    { /* '2' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x1f  /* ##### */
+    },
+    { /* '3' */
+        0x1f, /* ##### */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x02, /* ...#. */
+        0x01, /* ....# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* '4' */
+        0x02, /* ...#. */
+        0x06, /* ..##. */
+        0x0a, /* .#.#. */
+        0x12, /* #..#. */
+        0x1f, /* ##### */
+        0x02, /* ...#. */
+        0x02  /* ...#. */
+    },
+    { /* '5' */
+        0x1f, /* ##### */
+        0x10, /* #.... */
+        0x1e, /* ####. */
+        0x01, /* ....# */
+        0x01, /* ....# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* '6' */
+        0x06, /* ..##. */
+        0x08, /* .#... */
+        0x10, /* #.... */
+        0x1e, /* ####. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* '7' */
+        0x1f, /* ##### */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x08  /* .#... */
+    },
+    { /* '8' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* '9' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0f, /* .#### */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x0c  /* .##.. */
+    },
+    { /* ':' */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x0c, /* .##.. */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x0c, /* .##.. */
+        0x00  /* ..... */
+    },
+    { /* ';' */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x0c, /* .##.. */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x04, /* ..#.. */
+        0x08  /* .#... */
+    },
+    { /* '<' */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x10, /* #.... */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x02  /* ...#. */
+    },
+    { /* '=' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x1f, /* ##### */
+        0x00, /* ..... */
+        0x1f, /* ##### */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* '>' */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x02, /* ...#. */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08  /* .#... */
+    },
+    { /* '?' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x00, /* ..... */
+        0x04  /* ..#.. */
+    },
+    { /* '@' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x01, /* ....# */
+        0x0d, /* .##.# */
+        0x15, /* #.#.# */
+        0x15, /* #.#.# */
+        0x0e  /* .###. */
+    },
+    { /* 'A' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1f, /* ##### */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'B' */
+        0x1e, /* ####. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1e, /* ####. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1e  /* ####. */
+    },
+    { /* 'C' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* 'D' */
+        0x1c, /* ###.. */
+        0x12, /* #..#. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x12, /* #..#. */
+        0x1c  /* ###.. */
+    },
+    { /* 'E' */
+        0x1f, /* ##### */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x1e, /* ####. */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x1f  /* ##### */
+    },
+    { /* 'F' */
+        0x1f, /* ##### */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x1e, /* ####. */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10  /* #.... */
+    },
+    { /* 'G' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x10, /* #.... */
+        0x17, /* #.### */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0f  /* .#### */
+    },
+    { /* 'H' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1f, /* ##### */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'I' */
+        0x0e, /* .###. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x0e  /* .###. */
+    },
+    { /* 'J' */
+        0x07, /* ..### */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x12, /* #..#. */
+        0x0c  /* .##.. */
+    },
+    { /* 'K' */
+        0x11, /* #...# */
+        0x12, /* #..#. */
+        0x14, /* #.#.. */
+        0x18, /* ##... */
+        0x14, /* #.#.. */
+        0x12, /* #..#. */
+        0x11  /* #...# */
+    },
+    { /* 'L' */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x1f  /* ##### */
+    },
+    { /* 'M' */
+        0x11, /* #...# */
+        0x1b, /* ##.## */
+        0x15, /* #.#.# */
+        0x15, /* #.#.# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'N' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x19, /* ##..# */
+        0x15, /* #.#.# */
+        0x13, /* #..## */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'O' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* 'P' */
+        0x1e, /* ####. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1e, /* ####. */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10  /* #.... */
+    },
+    { /* 'Q' */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x15, /* #.#.# */
+        0x12, /* #..#. */
+        0x0d  /* .##.# */
+    },
+    { /* 'R' */
+        0x1e, /* ####. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1e, /* ####. */
+        0x14, /* #.#.. */
+        0x12, /* #..#. */
+        0x11  /* #...# */
+    },
+    { /* 'S' */
+        0x0f, /* .#### */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x0e, /* .###. */
+        0x01, /* ....# */
+        0x01, /* ....# */
+        0x1e  /* ####. */
+    },
+    { /* 'T' */
+        0x1f, /* ##### */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04  /* ..#.. */
+    },
+    { /* 'U' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* 'V' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0a, /* .#.#. */
+        0x04  /* ..#.. */
+    },
+    { /* 'W' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x15, /* #.#.# */
+        0x15, /* #.#.# */
+        0x15, /* #.#.# */
+        0x0a  /* .#.#. */
+    },
+    { /* 'X' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0a, /* .#.#. */
+        0x04, /* ..#.. */
+        0x0a, /* .#.#. */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'Y' */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0a, /* .#.#. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04  /* ..#.. */
+    },
+    { /* 'Z' */
+        0x1f, /* ##### */
+        0x01, /* ....# */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x10, /* #.... */
+        0x1f  /* ##### */
+    },
+    { /* '[' */
+        0x0e, /* .###. */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x0e  /* .###. */
+    },
+    { /* '\\' */
+        0x00, /* ..... */
+        0x10, /* #.... */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x02, /* ...#. */
+        0x01, /* ....# */
+        0x00  /* ..... */
+    },
+    { /* ']' */
+        0x0e, /* .###. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x0e  /* .###. */
+    },
+    { /* '^' */
+        0x04, /* ..#.. */
+        0x0a, /* .#.#. */
+        0x11, /* #...# */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* '_' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x1f  /* ##### */
+    },
+    { /* '`' */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x02, /* ...#. */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    },
+    { /* 'a' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0e, /* .###. */
+        0x01, /* ....# */
+        0x0f, /* .#### */
+        0x11, /* #...# */
+        0x0f  /* .#### */
+    },
+    { /* 'b' */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x16, /* #.##. */
+        0x19, /* ##..# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x1e  /* ####. */
+    },
+    { /* 'c' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0e, /* .###. */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* 'd' */
+        0x01, /* ....# */
+        0x01, /* ....# */
+        0x0d, /* .##.# */
+        0x13, /* #..## */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0f  /* .#### */
+    },
+    { /* 'e' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x1f, /* ##### */
+        0x10, /* #.... */
+        0x0e  /* .###. */
+    },
+    { /* 'f' */
+        0x06, /* ..##. */
+        0x09, /* .#..# */
+        0x08, /* .#... */
+        0x1c, /* ###.. */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x08  /* .#... */
+    },
+    { /* 'g' */
+        0x00, /* ..... */
+        0x0f, /* .#### */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0f, /* .#### */
+        0x01, /* ....# */
+        0x0e  /* .###. */
+    },
+    { /* 'h' */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x16, /* #.##. */
+        0x19, /* ##..# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'i' */
+        0x04, /* ..#.. */
+        0x00, /* ..... */
+        0x0c, /* .##.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x0e  /* .###. */
+    },
+    { /* 'j' */
+        0x02, /* ...#. */
+        0x00, /* ..... */
+        0x06, /* ..##. */
+        0x02, /* ...#. */
+        0x02, /* ...#. */
+        0x12, /* #..#. */
+        0x0c  /* .##.. */
+    },
+    { /* 'k' */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x12, /* #..#. */
+        0x14, /* #.#.. */
+        0x18, /* ##... */
+        0x14, /* #.#.. */
+        0x12  /* #..#. */
+    },
+    { /* 'l' */
+        0x0c, /* .##.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x0e  /* .###. */
+    },
+    { /* 'm' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x1a, /* ##.#. */
+        0x15, /* #.#.# */
+        0x15, /* #.#.# */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'n' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x16, /* #.##. */
+        0x19, /* ##..# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11  /* #...# */
+    },
+    { /* 'o' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0e, /* .###. */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0e  /* .###. */
+    },
+    { /* 'p' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x1e, /* ####. */
+        0x11, /* #...# */
+        0x1e, /* ####. */
+        0x10, /* #.... */
+        0x10  /* #.... */
+    },
+    { /* 'q' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0d, /* .##.# */
+        0x13, /* #..## */
+        0x0f, /* .#### */
+        0x01, /* ....# */
+        0x01  /* ....# */
+    },
+    { /* 'r' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x16, /* #.##. */
+        0x19, /* ##..# */
+        0x10, /* #.... */
+        0x10, /* #.... */
+        0x10  /* #.... */
+    },
+    { /* 's' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x0e, /* .###. */
+        0x10, /* #.... */
+        0x0e, /* .###. */
+        0x01, /* ....# */
+        0x1e  /* ####. */
+    },
+    { /* 't' */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x1c, /* ###.. */
+        0x08, /* .#... */
+        0x08, /* .#... */
+        0x09, /* .#..# */
+        0x06  /* ..##. */
+    },
+    { /* 'u' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x13, /* #..## */
+        0x0d  /* .##.# */
+    },
+    { /* 'v' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0a, /* .#.#. */
+        0x04  /* ..#.. */
+    },
+    { /* 'w' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x15, /* #.#.# */
+        0x15, /* #.#.# */
+        0x0a  /* .#.#. */
+    },
+    { /* 'x' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x11, /* #...# */
+        0x0a, /* .#.#. */
+        0x04, /* ..#.. */
+        0x0a, /* .#.#. */
+        0x11  /* #...# */
+    },
+    { /* 'y' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x11, /* #...# */
+        0x11, /* #...# */
+        0x0f, /* .#### */
+        0x01, /* ....# */
+        0x0e  /* .###. */
+    },
+    { /* 'z' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x1f, /* ##### */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x1f  /* ##### */
+    },
+    { /* '{' */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x02  /* ...#. */
+    },
+    { /* '|' */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x04  /* ..#.. */
+    },
+    { /* '}' */
+        0x08, /* .#... */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x02, /* ...#. */
+        0x04, /* ..#.. */
+        0x04, /* ..#.. */
+        0x08  /* .#... */
+    },
+    { /* '~' */
+        0x00, /* ..... */
+        0x00, /* ..... */
+        0x08, /* .#... */
+        0x15, /* #.#.# */
+        0x02, /* ...#. */
+        0x00, /* ..... */
+        0x00  /* ..... */
+    }
+};
@@ -0,0 +1,2201 @@
+/*
+ * grml-plus UEFI tools - mock firmware to run the tools as host programs
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Provides main() for a tool's objects linked on the host ("make host"):
+ * builds a system table, boot and runtime services and a handle database
+ * good enough for efi_main of protector, skipsign and usb-modboot-loader,
+ * and calls it. gnu-efi's libefi is linked as it is, so Print, LibOpenRoot
+ * and friends reach the mocks through the same tables as on firmware.
+ *
+ *   -r DIR      directory served as the boot volume (default .), file names
+ *               are matched case-insensitively like on FAT
+ *   -w          let the tools create, write and delete files on that volume
+ *   -p PATH     the tool's own path on that volume (\EFI\BOOT\<name>.efi)
+ *   -k KEYS     keys to type; {up} {down} {left} {right} {pgup} {pgdn}
+ *               {home} {end} {esc} and {enter} for special keys
+ *   -n COUNT    type the keys COUNT times; once they are used up, the next
+ *               wait for a key ends the run
+ *   -s STATUS   firmware verdict for LoadImage: violation (default), denied
+ *               or success
+ *   -1          only install the PI 1.0 Security protocol, not Security2
+ *   -e          no SIMPLE_TEXT_INPUT_EX, so no key notifications
+ *   -a          no ACPI tables; by default an FPDT is provided whose boot
+ *               record puts reset 2 s and the OS loader LoadImage 30 ms
+ *               before efi_main, and an SRAT with the memory below 4 GB on
+ *               node 0 and the 4 GB above it on node 1
+ *   -m COUNT    split the memory of node 1 into COUNT descriptors, boot
+ *               services data and free memory in pairs, listed from the top
+ *               down, to stand in for the maps of big machines
+ *   -g WxH      provide a GOP with a WxH framebuffer in memory
+ *   -v NAME=FILE  preload variable NAME (any vendor GUID) with FILE
+ *   -b KBS      throttle file and disk reads to KBS kilobytes per second, to stand
+ *               in for slow boot media
+ *   -l USEC     make every read from the disk under the volume take USEC
+ *               microseconds more, like a command to a USB stick; started
+ *               images then read the disk in small pieces, as GRUB does
+ *   -c CPUS     provide MP services with CPUS processors, the APs running
+ *               as threads
+ *   -d          no RAM disk protocol; by default RAM disks can be
+ *               registered, and their file system serves the boot volume's
+ *               directory again
+ *   -t          mirror console output to stdout as ANSI escape sequences
+ *   -q          do not dump the final text screen at exit
+ *
+ * At exit the call counters of the console, image and memory services are
+ * written to stderr; the exit code is 0 if efi_main returned EFI_SUCCESS or
+ * the run ended by ResetSystem or running out of keys.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "../ramdisk.h"
+#include "../security.h"
+#include "../timeline.h"
+#include "../workpool.h"
+
+#ifndef GNU_EFI_USE_MS_ABI
+#error "the mocks are called by libefi and the tools as EFIAPI functions, build with -DGNU_EFI_USE_MS_ABI"
+#endif
+
+#define MAX_HANDLE_PROTOCOLS 64
+#define MAX_KEYS 4096
+#define MAX_KEY_NOTIFIES 64
+#define MAX_COLUMNS 100
+#define MAX_ROWS 50
+#define DISK_BLOCKS (64 * 2048)
+/* node 1 of the machine, 4 GB above 4 GB */
+#define HIGH_MEMORY_START 0x100000000ULL
+#define HIGH_MEMORY_PAGES 0x100000ULL
+
+EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable);
+
+typedef struct {
+    EFI_HANDLE Handle;
+    EFI_GUID Guid;
+    VOID *Interface;
+} HANDLE_PROTOCOL;
+
+typedef struct {
+    UINT32 Type;
+    BOOLEAN Signaled;
+    EFI_EVENT_NOTIFY Notify;
+    VOID *Context;
+} MOCK_EVENT;
+
+typedef struct {
+    EFI_LOADED_IMAGE Image;
+    VOID *Buffer;
+} MOCK_IMAGE;
+
+typedef struct {
+    EFI_FILE File;
+    char *Path;
+    FILE *Host;
+    DIR *Dir;
+    UINT64 Position;
+} MOCK_FILE;
+
+typedef struct _MOCK_VARIABLE {
+    struct _MOCK_VARIABLE *Next;
+    CHAR16 *Name;
+    EFI_GUID Guid;
+    BOOLEAN AnyGuid;
+    UINT32 Attributes;
+    UINTN Size;
+    UINT8 *Data;
+} MOCK_VARIABLE;
+
+typedef struct {
+    EFI_DEVICE_PATH Header;
+    UINT32 StartingAddr[2];
+    UINT32 EndingAddr[2];
+    EFI_GUID TypeGuid;
+    UINT16 Instance;
+} __attribute__((packed)) RAM_DISK_NODE;
+
+/* the handle of a registered RAM disk */
+typedef struct {
+    RAM_DISK_NODE Node;
+    EFI_DEVICE_PATH End;
+} __attribute__((packed)) MOCK_RAM_DISK;
+
+typedef struct _MOCK_PAGES {
+    struct _MOCK_PAGES *Next;
+    EFI_PHYSICAL_ADDRESS Address;
+    UINTN Pages;
+    EFI_MEMORY_TYPE Type;
+} MOCK_PAGES;
+
+static struct {
+    UINTN OutputString, OutputChars, SetCursorPosition, SetAttribute, ClearScreen;
+    UINTN ReadKeyStroke, KeyNotify, LoadImage, Denied, StartImage, UnloadImage;
+    UINTN AllocatePages, FreePages, AllocatePool, FreePool, GetVariable, SetVariable;
+    UINTN StartupThisAP, ApsBusy, FileWrite, RamDiskRegister, RamDiskUnregister, ReadBlocks;
+    UINT64 RamDiskBytes, BlockBytes;
+} calls;
+
+static EFI_GUID loadedImageGuid = LOADED_IMAGE_PROTOCOL;
+static EFI_GUID devicePathGuid = DEVICE_PATH_PROTOCOL;
+static EFI_GUID simpleFSGuid = SIMPLE_FILE_SYSTEM_PROTOCOL;
+static EFI_GUID blockIoGuid = BLOCK_IO_PROTOCOL;
+static EFI_GUID fileInfoGuid = EFI_FILE_INFO_ID;
+static EFI_GUID gopGuid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
+static EFI_GUID securityGuid = { 0xA46423E3, 0x4617, 0x49f1, {0xB9, 0xFF, 0xD1, 0xBF, 0xA9, 0x11, 0x58, 0x39 } };
+static EFI_GUID security2Guid = { 0x94ab2f58, 0x1438, 0x4ef1, {0x91, 0x52, 0x18, 0x94, 0x1a, 0x3a, 0x0e, 0x68 } };
+static EFI_GUID mpServicesGuid = EFI_MP_SERVICES_PROTOCOL_GUID;
+static EFI_GUID textInputExGuid = EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL_GUID;
+static EFI_GUID ramDiskGuid = EFI_RAM_DISK_PROTOCOL_GUID;
+
+static EFI_SYSTEM_TABLE systemTable;
+static EFI_BOOT_SERVICES bootServices;
+static EFI_RUNTIME_SERVICES runtimeServices;
+static SIMPLE_TEXT_OUTPUT_INTERFACE conOut;
+static SIMPLE_TEXT_OUTPUT_MODE conOutMode;
+static SIMPLE_INPUT_INTERFACE conIn;
+static EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL conInEx;
+static EFI_FILE_IO_INTERFACE simpleFS;
+static EFI_BLOCK_IO blockIo;
+static EFI_BLOCK_IO_MEDIA blockIoMedia;
+static EFI_SECURITY_PROTOCOL security;
+static EFI_SECURITY2_PROTOCOL security2;
+static EFI_GRAPHICS_OUTPUT_PROTOCOL gop;
+static EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE gopMode;
+static EFI_GRAPHICS_OUTPUT_MODE_INFORMATION gopInfo;
+static EFI_LOADED_IMAGE loadedImage;
+static EFI_MP_SERVICES_PROTOCOL mpServices;
+static EFI_RAM_DISK_PROTOCOL ramDisk;
+
+/* handles only need to be distinct addresses */
+static UINT8 imageHandle, deviceHandle, consoleHandle, securityHandle, gopHandle, mpHandle, ramDiskHandle;
+static EFI_DEVICE_PATH deviceEnd = { END_DEVICE_PATH_TYPE, END_ENTIRE_DEVICE_PATH_SUBTYPE, { 4, 0 } };
+
+static HANDLE_PROTOCOL handleProtocols[MAX_HANDLE_PROTOCOLS];
+static UINTN handleProtocolCount;
+
+static MOCK_EVENT keyEvent = { EVT_NOTIFY_WAIT, FALSE, NULL, NULL };
+static EFI_INPUT_KEY keys[MAX_KEYS];
+static UINTN keyCount, keyNext, keyRepeat = 1;
+static UINTN keysRead, keysNotified;
+static struct {
+    EFI_INPUT_KEY Key;
+    EFI_KEY_NOTIFY_FUNCTION Function;
+} keyNotifies[MAX_KEY_NOTIFIES];
+
+static const UINTN textModes[][2] = { { 80, 25 }, { 80, 50 }, { 100, 31 } };
+static CHAR16 screenText[MAX_ROWS][MAX_COLUMNS];
+static BOOLEAN trace, quiet;
+
+static const char *rootDir = ".";
+static BOOLEAN writable;
+static UINTN highFragments = 1;
+static unsigned long readRate;      /* KB/s for file contents, 0 for no limit */
+static unsigned long blockLatency;  /* us per ReadBlocks call */
+static UINTN processorCount = 1;
+static EFI_STATUS verdict = EFI_SECURITY_VIOLATION;
+static MOCK_VARIABLE *variables;
+static MOCK_PAGES *pages;
+static UINTN pagesAllocated, poolsAllocated;
+static EFI_TPL currentTpl = TPL_APPLICATION;
+
+static void dumpScreen(void) {
+    UINTN columns = textModes[conOutMode.Mode][0], rows = textModes[conOutMode.Mode][1], x, y, end;
+
+    for (y = 0; y < rows; y++) {
+        for (end = columns; end > 0 && screenText[y][end - 1] == ' '; end--)
+            ;
+        for (x = 0; x < end; x++)
+            putchar(screenText[y][x] < 0x80 ? screenText[y][x] : '?');
+        putchar('\n');
+    }
+}
+
+static void finish(const char *why, EFI_STATUS status) {
+    if (trace)
+        printf("\033[0m\n");
+    else if (!quiet)
+        dumpScreen();
+    fflush(stdout);
+    fprintf(stderr, "efimock: %s (status %#lx)\n", why, (unsigned long) status);
+    fprintf(stderr, "efimock: console: %lu OutputString (%lu chars), %lu SetCursorPosition, %lu SetAttribute, %lu ClearScreen, %lu ReadKeyStroke, %lu key notifications\n",
+            (unsigned long) calls.OutputString, (unsigned long) calls.OutputChars, (unsigned long) calls.SetCursorPosition,
+            (unsigned long) calls.SetAttribute, (unsigned long) calls.ClearScreen, (unsigned long) calls.ReadKeyStroke,
+            (unsigned long) calls.KeyNotify);
+    fprintf(stderr, "efimock: images: %lu LoadImage (%lu denied), %lu StartImage, %lu UnloadImage\n",
+            (unsigned long) calls.LoadImage, (unsigned long) calls.Denied, (unsigned long) calls.StartImage,
+            (unsigned long) calls.UnloadImage);
+    fprintf(stderr, "efimock: memory: %lu AllocatePages, %lu FreePages (%lu pages left), %lu AllocatePool, %lu FreePool (%lu left)\n",
+            (unsigned long) calls.AllocatePages, (unsigned long) calls.FreePages, (unsigned long) pagesAllocated,
+            (unsigned long) calls.AllocatePool, (unsigned long) calls.FreePool, (unsigned long) poolsAllocated);
+    fprintf(stderr, "efimock: variables: %lu GetVariable, %lu SetVariable\n",
+            (unsigned long) calls.GetVariable, (unsigned long) calls.SetVariable);
+    if (writable)
+        fprintf(stderr, "efimock: files: %lu Write\n", (unsigned long) calls.FileWrite);
+    if (processorCount > 1)
+        fprintf(stderr, "efimock: processors: %lu, %lu StartupThisAP (%lu on a busy AP)\n",
+                (unsigned long) processorCount, (unsigned long) calls.StartupThisAP, (unsigned long) calls.ApsBusy);
+    if (calls.RamDiskRegister)
+        fprintf(stderr, "efimock: RAM disks: %lu Register (%lu KB), %lu Unregister\n", (unsigned long) calls.RamDiskRegister,
+                (unsigned long) (calls.RamDiskBytes >> 10), (unsigned long) calls.RamDiskUnregister);
+    if (calls.ReadBlocks)
+        fprintf(stderr, "efimock: disk: %lu ReadBlocks (%lu KB)\n", (unsigned long) calls.ReadBlocks,
+                (unsigned long) (calls.BlockBytes >> 10));
+    exit(status == EFI_SUCCESS ? 0 : 1);
+}
+
+static EFI_STATUS EFIAPI mockUnsupported(void) {
+    return EFI_UNSUPPORTED;
+}
+
+/* points every service of a table at mockUnsupported before the real ones are filled in */
+static void fillUnsupported(VOID *Table, UINTN Size) {
+    VOID **entry;
+
+    for (entry = (VOID **) ((UINT8 *) Table + sizeof(EFI_TABLE_HEADER)); entry < (VOID **) ((UINT8 *) Table + Size); entry++)
+        *entry = (VOID *) mockUnsupported;
+}
+
+static UINT32 crc32(const VOID *Data, UINTN Size) {
+    const UINT8 *p = Data;
+    UINT32 crc = 0xffffffff;
+    int bit;
+
+    while (Size--) {
+        crc ^= *p++;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void setTableHeader(EFI_TABLE_HEADER *Hdr, UINT64 Signature, UINT32 Revision, UINT32 Size) {
+    Hdr->Signature = Signature;
+    Hdr->Revision = Revision;
+    Hdr->HeaderSize = Size;
+    Hdr->CRC32 = 0;
+    Hdr->CRC32 = crc32(Hdr, Size);
+}
+
+static BOOLEAN guidEqual(const EFI_GUID *a, const EFI_GUID *b) {
+    return memcmp(a, b, sizeof(EFI_GUID)) == 0;
+}
+
+static void installProtocol(EFI_HANDLE Handle, EFI_GUID *Guid, VOID *Interface) {
+    if (handleProtocolCount == MAX_HANDLE_PROTOCOLS) {
+        fprintf(stderr, "efimock: handle database full\n");
+        exit(2);
+    }
+    handleProtocols[handleProtocolCount].Handle = Handle;
+    handleProtocols[handleProtocolCount].Guid = *Guid;
+    handleProtocols[handleProtocolCount].Interface = Interface;
+    handleProtocolCount++;
+}
+
+static void uninstallHandle(EFI_HANDLE Handle) {
+    UINTN i, j;
+
+    for (i = j = 0; i < handleProtocolCount; i++)
+        if (handleProtocols[i].Handle != Handle)
+            handleProtocols[j++] = handleProtocols[i];
+    handleProtocolCount = j;
+}
+
+static VOID *findProtocol(EFI_HANDLE Handle, EFI_GUID *Guid) {
+    UINTN i;
+
+    for (i = 0; i < handleProtocolCount; i++)
+        if ((Handle == NULL || handleProtocols[i].Handle == Handle) && guidEqual(&handleProtocols[i].Guid, Guid))
+            return handleProtocols[i].Interface;
+    return NULL;
+}
+
+static char *toAscii(const CHAR16 *s, UINTN Length) {
+    char *result = malloc(Length + 1);
+    UINTN i;
+
+    for (i = 0; i < Length; i++)
+        result[i] = s[i] < 0x80 ? (char) s[i] : '?';
+    result[Length] = 0;
+    return result;
+}
+
+static UINTN strLen16(const CHAR16 *s) {
+    UINTN n = 0;
+
+    while (s[n])
+        n++;
+    return n;
+}
+
+/*
+ * Text console
+ */
+
+static void scrollUp(UINTN Columns, UINTN Rows) {
+    UINTN x;
+
+    memmove(screenText[0], screenText[1], (Rows - 1) * sizeof(screenText[0]));
+    for (x = 0; x < Columns; x++)
+        screenText[Rows - 1][x] = ' ';
+}
+
+static void traceChar(CHAR16 c) {
+    if (c < 0x80)
+        putchar(c);
+    else if (c < 0x800)
+        printf("%c%c", 0xc0 | (c >> 6), 0x80 | (c & 0x3f));
+    else
+        printf("%c%c%c", 0xe0 | (c >> 12), 0x80 | ((c >> 6) & 0x3f), 0x80 | (c & 0x3f));
+}
+
+static EFI_STATUS EFIAPI mockOutputString(SIMPLE_TEXT_OUTPUT_INTERFACE *This, CHAR16 *String) {
+    UINTN columns = textModes[conOutMode.Mode][0], rows = textModes[conOutMode.Mode][1];
+
+    calls.OutputString++;
+    for (; *String; String++) {
+        calls.OutputChars++;
+        if (trace)
+            traceChar(*String);
+        switch (*String) {
+        case '\r':
+            conOutMode.CursorColumn = 0;
+            break;
+        case '\n':
+            if (++conOutMode.CursorRow == (INT32) rows) {
+                scrollUp(columns, rows);
+                conOutMode.CursorRow--;
+            }
+            break;
+        case '\b':
+            if (conOutMode.CursorColumn > 0)
+                conOutMode.CursorColumn--;
+            break;
+        default:
+            screenText[conOutMode.CursorRow][conOutMode.CursorColumn] = *String;
+            if (++conOutMode.CursorColumn == (INT32) columns) {
+                conOutMode.CursorColumn = 0;
+                if (++conOutMode.CursorRow == (INT32) rows) {
+                    scrollUp(columns, rows);
+                    conOutMode.CursorRow--;
+                }
+            }
+            break;
+        }
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockTestString(SIMPLE_TEXT_OUTPUT_INTERFACE *This, CHAR16 *String) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockClearScreen(SIMPLE_TEXT_OUTPUT_INTERFACE *This) {
+    UINTN x, y;
+
+    calls.ClearScreen++;
+    for (y = 0; y < MAX_ROWS; y++)
+        for (x = 0; x < MAX_COLUMNS; x++)
+            screenText[y][x] = ' ';
+    conOutMode.CursorColumn = conOutMode.CursorRow = 0;
+    if (trace)
+        printf("\033[H\033[2J");
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockConOutReset(SIMPLE_TEXT_OUTPUT_INTERFACE *This, BOOLEAN ExtendedVerification) {
+    return mockClearScreen(This);
+}
+
+static EFI_STATUS EFIAPI mockQueryMode(SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN ModeNumber, UINTN *Columns, UINTN *Rows) {
+    if (ModeNumber >= (UINTN) conOutMode.MaxMode)
+        return EFI_UNSUPPORTED;
+    *Columns = textModes[ModeNumber][0];
+    *Rows = textModes[ModeNumber][1];
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockSetMode(SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN ModeNumber) {
+    if (ModeNumber >= (UINTN) conOutMode.MaxMode)
+        return EFI_UNSUPPORTED;
+    conOutMode.Mode = ModeNumber;
+    return mockClearScreen(This);
+}
+
+static EFI_STATUS EFIAPI mockSetAttribute(SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN Attribute) {
+    static const int ansi[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+    calls.SetAttribute++;
+    conOutMode.Attribute = Attribute;
+    if (trace)
+        printf("\033[0;%s3%d;4%dm", (Attribute & 8) ? "1;" : "", ansi[Attribute & 7], ansi[(Attribute >> 4) & 7]);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockSetCursorPosition(SIMPLE_TEXT_OUTPUT_INTERFACE *This, UINTN Column, UINTN Row) {
+    calls.SetCursorPosition++;
+    if (Column >= textModes[conOutMode.Mode][0] || Row >= textModes[conOutMode.Mode][1])
+        return EFI_UNSUPPORTED;
+    conOutMode.CursorColumn = Column;
+    conOutMode.CursorRow = Row;
+    if (trace)
+        printf("\033[%lu;%luH", (unsigned long) Row + 1, (unsigned long) Column + 1);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockEnableCursor(SIMPLE_TEXT_OUTPUT_INTERFACE *This, BOOLEAN Visible) {
+    conOutMode.CursorVisible = Visible;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Keyboard
+ */
+
+static BOOLEAN keyPending(void) {
+    if (keyNext == keyCount && keyRepeat > 1) {
+        keyRepeat--;
+        keyNext = 0;
+    }
+    return keyNext < keyCount;
+}
+
+static EFI_STATUS EFIAPI mockConInReset(SIMPLE_INPUT_INTERFACE *This, BOOLEAN ExtendedVerification) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockReadKeyStroke(SIMPLE_INPUT_INTERFACE *This, EFI_INPUT_KEY *Key) {
+    calls.ReadKeyStroke++;
+    if (!keyPending())
+        return EFI_NOT_READY;
+    *Key = keys[keyNext++];
+    keysRead++;
+    return EFI_SUCCESS;
+}
+
+/*
+ * A key arrives when it gets to the head of the script; the notifications
+ * registered for it are called then, from the next event check.
+ */
+static void notifyKeys(void) {
+    EFI_KEY_DATA data;
+    UINTN i;
+
+    if (!keyPending() || keysNotified > keysRead)
+        return;
+    keysNotified = keysRead + 1;
+    memset(&data, 0, sizeof(data));
+    data.Key = keys[keyNext];
+    for (i = 0; i < MAX_KEY_NOTIFIES; i++) {
+        if (keyNotifies[i].Function && keyNotifies[i].Key.ScanCode == data.Key.ScanCode &&
+                keyNotifies[i].Key.UnicodeChar == data.Key.UnicodeChar) {
+            calls.KeyNotify++;
+            keyNotifies[i].Function(&data);
+        }
+    }
+}
+
+static EFI_STATUS EFIAPI mockConInExReset(EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, BOOLEAN ExtendedVerification) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockReadKeyStrokeEx(EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, EFI_KEY_DATA *KeyData) {
+    memset(KeyData, 0, sizeof(EFI_KEY_DATA));
+    return mockReadKeyStroke(&conIn, &KeyData->Key);
+}
+
+static EFI_STATUS EFIAPI mockSetState(EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, UINT8 *KeyToggleState) {
+    return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI mockRegisterKeyNotify(EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, EFI_KEY_DATA *KeyData,
+        EFI_KEY_NOTIFY_FUNCTION KeyNotificationFunction, VOID **NotifyHandle) {
+    UINTN i;
+
+    if (KeyData == NULL || KeyNotificationFunction == NULL || NotifyHandle == NULL)
+        return EFI_INVALID_PARAMETER;
+    for (i = 0; i < MAX_KEY_NOTIFIES; i++) {
+        if (keyNotifies[i].Function == NULL) {
+            keyNotifies[i].Key = KeyData->Key;
+            keyNotifies[i].Function = KeyNotificationFunction;
+            *NotifyHandle = &keyNotifies[i];
+            return EFI_SUCCESS;
+        }
+    }
+    return EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI mockUnregisterKeyNotify(EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *This, VOID *NotificationHandle) {
+    UINTN i;
+
+    for (i = 0; i < MAX_KEY_NOTIFIES; i++) {
+        if (NotificationHandle == &keyNotifies[i] && keyNotifies[i].Function != NULL) {
+            keyNotifies[i].Function = NULL;
+            return EFI_SUCCESS;
+        }
+    }
+    return EFI_INVALID_PARAMETER;
+}
+
+static void parseKeys(const char *Script) {
+    static const struct { const char *Name; UINT16 ScanCode; CHAR16 Char; } names[] = {
+        { "{up}", SCAN_UP, 0 }, { "{down}", SCAN_DOWN, 0 }, { "{left}", SCAN_LEFT, 0 },
+        { "{right}", SCAN_RIGHT, 0 }, { "{pgup}", SCAN_PAGE_UP, 0 }, { "{pgdn}", SCAN_PAGE_DOWN, 0 },
+        { "{home}", SCAN_HOME, 0 }, { "{end}", SCAN_END, 0 }, { "{esc}", SCAN_ESC, 0 },
+        { "{enter}", SCAN_NULL, CHAR_CARRIAGE_RETURN },
+    };
+    UINTN i;
+
+    while (*Script && keyCount < MAX_KEYS) {
+        for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+            if (strncmp(Script, names[i].Name, strlen(names[i].Name)) == 0)
+                break;
+        if (i < sizeof(names) / sizeof(names[0])) {
+            keys[keyCount].ScanCode = names[i].ScanCode;
+            keys[keyCount].UnicodeChar = names[i].Char;
+            Script += strlen(names[i].Name);
+        } else {
+            keys[keyCount].ScanCode = SCAN_NULL;
+            keys[keyCount].UnicodeChar = (UINT8) *Script++;
+        }
+        keyCount++;
+    }
+}
+
+/*
+ * Events and timers: time passes instantly, a timer is due as soon as it is set
+ */
+
+static BOOLEAN pollAps(void);
+
+static BOOLEAN eventSignaled(MOCK_EVENT *Event) {
+    pollAps();
+    notifyKeys();
+    if (Event == &keyEvent)
+        return keyPending();
+    if (!Event->Signaled)
+        return FALSE;
+    Event->Signaled = FALSE;
+    return TRUE;
+}
+
+static void signalEvent(MOCK_EVENT *Event) {
+    Event->Signaled = TRUE;
+    if ((Event->Type & EVT_NOTIFY_SIGNAL) && Event->Notify)
+        Event->Notify(Event, Event->Context);
+}
+
+static EFI_STATUS EFIAPI mockCreateEvent(UINT32 Type, EFI_TPL NotifyTpl, EFI_EVENT_NOTIFY NotifyFunction, VOID *NotifyContext,
+        EFI_EVENT *Event) {
+    MOCK_EVENT *event = calloc(1, sizeof(MOCK_EVENT));
+
+    if (event == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    event->Type = Type;
+    event->Notify = NotifyFunction;
+    event->Context = NotifyContext;
+    *Event = event;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockCloseEvent(EFI_EVENT Event) {
+    if (Event != &keyEvent)
+        free(Event);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockSignalEvent(EFI_EVENT Event) {
+    signalEvent(Event);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockSetTimer(EFI_EVENT Event, EFI_TIMER_DELAY Type, UINT64 TriggerTime) {
+    if (Type != TimerCancel)
+        signalEvent(Event);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockCheckEvent(EFI_EVENT Event) {
+    return eventSignaled(Event) ? EFI_SUCCESS : EFI_NOT_READY;
+}
+
+static EFI_STATUS EFIAPI mockWaitForEvent(UINTN NumberOfEvents, EFI_EVENT *Event, UINTN *Index) {
+    BOOLEAN running;
+    UINTN i;
+
+    /* a running AP may still signal one of them */
+    do {
+        running = pollAps();
+        for (i = 0; i < NumberOfEvents; i++)
+            if (eventSignaled(Event[i])) {
+                *Index = i;
+                return EFI_SUCCESS;
+            }
+        if (running)
+            usleep(100);
+    } while (running);
+    for (i = 0; i < NumberOfEvents; i++)
+        if (Event[i] == &keyEvent)
+            finish("out of keys", EFI_SUCCESS);
+    finish("WaitForEvent would never return", EFI_ABORTED);
+    return EFI_ABORTED;
+}
+
+static EFI_TPL EFIAPI mockRaiseTPL(EFI_TPL NewTpl) {
+    EFI_TPL old = currentTpl;
+
+    currentTpl = NewTpl;
+    return old;
+}
+
+static VOID EFIAPI mockRestoreTPL(EFI_TPL OldTpl) {
+    currentTpl = OldTpl;
+}
+
+static EFI_STATUS EFIAPI mockStall(UINTN Microseconds) {
+    struct timespec delay = { Microseconds / 1000000, (Microseconds % 1000000) * 1000 };
+
+    nanosleep(&delay, NULL);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockSetWatchdogTimer(UINTN Timeout, UINT64 WatchdogCode, UINTN DataSize, CHAR16 *WatchdogData) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockCalculateCrc32(VOID *Data, UINTN DataSize, UINT32 *Crc32) {
+    *Crc32 = crc32(Data, DataSize);
+    return EFI_SUCCESS;
+}
+
+static VOID EFIAPI mockCopyMem(VOID *Destination, VOID *Source, UINTN Length) {
+    memmove(Destination, Source, Length);
+}
+
+static VOID EFIAPI mockSetMem(VOID *Buffer, UINTN Size, UINT8 Value) {
+    memset(Buffer, Value, Size);
+}
+
+/*
+ * Memory: pages come from the host heap; the memory map is a fixed machine
+ * plus one descriptor per live page allocation
+ */
+
+static EFI_STATUS EFIAPI mockAllocatePages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN NoPages,
+        EFI_PHYSICAL_ADDRESS *Memory) {
+    MOCK_PAGES *entry;
+    VOID *buffer;
+
+    calls.AllocatePages++;
+    if (Type == AllocateAddress)
+        return EFI_NOT_FOUND;
+    if (NoPages == 0 || posix_memalign(&buffer, EFI_PAGE_SIZE, NoPages * EFI_PAGE_SIZE) != 0)
+        return EFI_OUT_OF_RESOURCES;
+    if (Type == AllocateMaxAddress && (UINTN) buffer + NoPages * EFI_PAGE_SIZE - 1 > *Memory) {
+        free(buffer);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    entry = malloc(sizeof(MOCK_PAGES));
+    entry->Address = (UINTN) buffer;
+    entry->Pages = NoPages;
+    entry->Type = MemoryType;
+    entry->Next = pages;
+    pages = entry;
+    pagesAllocated += NoPages;
+    *Memory = (UINTN) buffer;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFreePages(EFI_PHYSICAL_ADDRESS Memory, UINTN NoPages) {
+    MOCK_PAGES **link, *entry;
+
+    calls.FreePages++;
+    for (link = &pages; (entry = *link) != NULL; link = &entry->Next)
+        if (entry->Address == Memory) {
+            if (entry->Pages != NoPages)
+                return EFI_INVALID_PARAMETER;
+            *link = entry->Next;
+            pagesAllocated -= NoPages;
+            free((VOID *) (UINTN) Memory);
+            free(entry);
+            return EFI_SUCCESS;
+        }
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI mockAllocatePool(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID **Buffer) {
+    calls.AllocatePool++;
+    *Buffer = malloc(Size ? Size : 1);
+    if (*Buffer == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    poolsAllocated++;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFreePool(VOID *Buffer) {
+    calls.FreePool++;
+    poolsAllocated--;
+    free(Buffer);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockGetMemoryMap(UINTN *MemoryMapSize, EFI_MEMORY_DESCRIPTOR *MemoryMap, UINTN *MapKey,
+        UINTN *DescriptorSize, UINT32 *DescriptorVersion) {
+    /* firmware descriptors are usually larger than the structure, so is this one */
+    static const UINTN descriptorSize = sizeof(EFI_MEMORY_DESCRIPTOR) + 8;
+    static const struct { EFI_MEMORY_TYPE Type; UINT64 Start, Pages; } machine[] = {
+        { EfiBootServicesCode, 0x0, 0x1 },
+        { EfiConventionalMemory, 0x1000, 0x9f },
+        { EfiReservedMemoryType, 0xa0000, 0x60 },
+        { EfiConventionalMemory, 0x100000, 0x7e00 },
+        { EfiBootServicesData, 0x7f00000, 0x800 },
+        { EfiBootServicesCode, 0x8700000, 0x400 },
+        { EfiRuntimeServicesCode, 0x8b00000, 0x100 },
+        { EfiRuntimeServicesData, 0x8c00000, 0x200 },
+        { EfiACPIReclaimMemory, 0x8e00000, 0x20 },
+        { EfiACPIMemoryNVS, 0x8e20000, 0x80 },
+        { EfiConventionalMemory, 0x8ea0000, 0x37160 },
+        { EfiMemoryMappedIO, 0xffc00000, 0x400 },
+    };
+    UINTN count = sizeof(machine) / sizeof(machine[0]) + highFragments, i, needed;
+    EFI_MEMORY_DESCRIPTOR *desc;
+    MOCK_PAGES *entry;
+
+    for (entry = pages; entry != NULL; entry = entry->Next)
+        count++;
+    needed = count * descriptorSize;
+    *DescriptorSize = descriptorSize;
+    *DescriptorVersion = 1;
+    *MapKey = calls.AllocatePages + calls.FreePages;
+    if (*MemoryMapSize < needed) {
+        *MemoryMapSize = needed;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *MemoryMapSize = needed;
+    memset(MemoryMap, 0, needed);
+    desc = MemoryMap;
+    for (i = 0; i < sizeof(machine) / sizeof(machine[0]); i++) {
+        desc->Type = machine[i].Type;
+        desc->PhysicalStart = machine[i].Start;
+        desc->NumberOfPages = machine[i].Pages;
+        desc->Attribute = machine[i].Type == EfiMemoryMappedIO ? EFI_MEMORY_UC | EFI_MEMORY_RUNTIME : EFI_MEMORY_WB;
+        if (machine[i].Type == EfiRuntimeServicesCode || machine[i].Type == EfiRuntimeServicesData)
+            desc->Attribute |= EFI_MEMORY_RUNTIME;
+        desc = NextMemoryDescriptor(desc, descriptorSize);
+    }
+    for (i = highFragments; i > 0; i--) {
+        desc->Type = highFragments == 1 ? EfiConventionalMemory : ((i - 1) / 2 % 2 ? EfiConventionalMemory : EfiBootServicesData);
+        desc->PhysicalStart = HIGH_MEMORY_START + (i - 1) * (HIGH_MEMORY_PAGES / highFragments) * EFI_PAGE_SIZE;
+        desc->NumberOfPages = i == highFragments ? HIGH_MEMORY_PAGES - (i - 1) * (HIGH_MEMORY_PAGES / highFragments)
+            : HIGH_MEMORY_PAGES / highFragments;
+        desc->Attribute = EFI_MEMORY_WB;
+        desc = NextMemoryDescriptor(desc, descriptorSize);
+    }
+    for (entry = pages; entry != NULL; entry = entry->Next) {
+        desc->Type = entry->Type;
+        desc->PhysicalStart = entry->Address;
+        desc->NumberOfPages = entry->Pages;
+        desc->Attribute = EFI_MEMORY_WB;
+        desc = NextMemoryDescriptor(desc, descriptorSize);
+    }
+    return EFI_SUCCESS;
+}
+
+/*
+ * Handle database
+ */
+
+static EFI_STATUS EFIAPI mockHandleProtocol(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface) {
+    if (Handle == NULL)
+        return EFI_INVALID_PARAMETER;
+    *Interface = findProtocol(Handle, Protocol);
+    return *Interface ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI mockOpenProtocol(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface, EFI_HANDLE AgentHandle,
+        EFI_HANDLE ControllerHandle, UINT32 Attributes) {
+    VOID *found;
+
+    if (Handle == NULL)
+        return EFI_INVALID_PARAMETER;
+    found = findProtocol(Handle, Protocol);
+    if (Interface != NULL)
+        *Interface = found;
+    return found ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI mockCloseProtocol(EFI_HANDLE Handle, EFI_GUID *Protocol, EFI_HANDLE AgentHandle, EFI_HANDLE ControllerHandle) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockLocateHandle(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey,
+        UINTN *BufferSize, EFI_HANDLE *Buffer) {
+    UINTN count = 0, i, j;
+
+    if (SearchType == ByRegisterNotify)
+        return EFI_UNSUPPORTED;
+    for (i = 0; i < handleProtocolCount; i++) {
+        if (SearchType == ByProtocol && !guidEqual(&handleProtocols[i].Guid, Protocol))
+            continue;
+        for (j = 0; j < i; j++)
+            if (handleProtocols[j].Handle == handleProtocols[i].Handle
+                    && (SearchType == AllHandles || guidEqual(&handleProtocols[j].Guid, Protocol)))
+                break;
+        if (j < i)
+            continue;
+        if ((count + 1) * sizeof(EFI_HANDLE) <= *BufferSize)
+            Buffer[count] = handleProtocols[i].Handle;
+        count++;
+    }
+    if (count == 0)
+        return EFI_NOT_FOUND;
+    if (count * sizeof(EFI_HANDLE) > *BufferSize) {
+        *BufferSize = count * sizeof(EFI_HANDLE);
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *BufferSize = count * sizeof(EFI_HANDLE);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockLocateHandleBuffer(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey,
+        UINTN *NoHandles, EFI_HANDLE **Buffer) {
+    UINTN size = 0;
+    EFI_STATUS status;
+
+    status = mockLocateHandle(SearchType, Protocol, SearchKey, &size, NULL);
+    if (status != EFI_BUFFER_TOO_SMALL)
+        return status;
+    mockAllocatePool(EfiBootServicesData, size, (VOID **) Buffer);
+    mockLocateHandle(SearchType, Protocol, SearchKey, &size, *Buffer);
+    *NoHandles = size / sizeof(EFI_HANDLE);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockLocateProtocol(EFI_GUID *Protocol, VOID *Registration, VOID **Interface) {
+    *Interface = findProtocol(NULL, Protocol);
+    return *Interface ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+static UINTN devicePathLength(EFI_DEVICE_PATH *Path) {
+    UINTN length = 0;
+
+    while (!IsDevicePathEnd((EFI_DEVICE_PATH *) ((UINT8 *) Path + length)))
+        length += DevicePathNodeLength((EFI_DEVICE_PATH *) ((UINT8 *) Path + length));
+    return length;
+}
+
+/* the handle with Protocol whose device path is the longest prefix of *DevicePath */
+static EFI_STATUS EFIAPI mockLocateDevicePath(EFI_GUID *Protocol, EFI_DEVICE_PATH **DevicePath, EFI_HANDLE *Device) {
+    EFI_DEVICE_PATH *path;
+    UINTN i, length, best = 0, wanted = devicePathLength(*DevicePath);
+    EFI_HANDLE found = NULL;
+
+    for (i = 0; i < handleProtocolCount; i++) {
+        if (!guidEqual(&handleProtocols[i].Guid, Protocol)
+                || (path = findProtocol(handleProtocols[i].Handle, &devicePathGuid)) == NULL)
+            continue;
+        length = devicePathLength(path);
+        if (length <= wanted && (found == NULL || length > best) && memcmp(path, *DevicePath, length) == 0) {
+            found = handleProtocols[i].Handle;
+            best = length;
+        }
+    }
+    if (found == NULL)
+        return EFI_NOT_FOUND;
+    *DevicePath = (EFI_DEVICE_PATH *) ((UINT8 *) *DevicePath + best);
+    *Device = found;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Read-only simple file system over the host directory
+ */
+
+static EFI_STATUS EFIAPI mockFileOpen(EFI_FILE *File, EFI_FILE **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes);
+static EFI_STATUS EFIAPI mockFileClose(EFI_FILE *File);
+static EFI_STATUS EFIAPI mockFileRead(EFI_FILE *File, UINTN *BufferSize, VOID *Buffer);
+static EFI_STATUS EFIAPI mockFileReadEx(EFI_FILE *File, EFI_FILE_IO_TOKEN *Token);
+static EFI_STATUS EFIAPI mockFileGetPosition(EFI_FILE *File, UINT64 *Position);
+static EFI_STATUS EFIAPI mockFileSetPosition(EFI_FILE *File, UINT64 Position);
+static EFI_STATUS EFIAPI mockFileGetInfo(EFI_FILE *File, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer);
+
+static EFI_STATUS EFIAPI mockWriteProtected(void) {
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI mockFileDelete(EFI_FILE *File);
+static EFI_STATUS EFIAPI mockFileWrite(EFI_FILE *File, UINTN *BufferSize, VOID *Buffer);
+static EFI_STATUS EFIAPI mockFileFlush(EFI_FILE *File);
+
+static MOCK_FILE *newFile(char *Path) {
+    MOCK_FILE *file = calloc(1, sizeof(MOCK_FILE));
+    struct stat st;
+
+    if (stat(Path, &st) != 0 || (S_ISDIR(st.st_mode) ? (file->Dir = opendir(Path)) == NULL
+            : (file->Host = fopen(Path, writable ? "r+b" : "rb")) == NULL)) {
+        free(file);
+        free(Path);
+        return NULL;
+    }
+    file->Path = Path;
+    file->File.Revision = EFI_FILE_PROTOCOL_REVISION2;
+    file->File.Open = (VOID *) mockFileOpen;
+    file->File.Close = (VOID *) mockFileClose;
+    file->File.Delete = (VOID *) mockWriteProtected;
+    file->File.Read = (VOID *) mockFileRead;
+    file->File.Write = (VOID *) mockWriteProtected;
+    file->File.GetPosition = (VOID *) mockFileGetPosition;
+    file->File.SetPosition = (VOID *) mockFileSetPosition;
+    file->File.GetInfo = (VOID *) mockFileGetInfo;
+    file->File.SetInfo = (VOID *) mockWriteProtected;
+    file->File.Flush = (VOID *) mockWriteProtected;
+    file->File.OpenEx = (VOID *) mockUnsupported;
+    file->File.ReadEx = (VOID *) mockFileReadEx;
+    file->File.WriteEx = (VOID *) mockWriteProtected;
+    file->File.FlushEx = (VOID *) mockWriteProtected;
+    if (writable) {
+        file->File.Delete = (VOID *) mockFileDelete;
+        file->File.Write = (VOID *) mockFileWrite;
+        file->File.Flush = (VOID *) mockFileFlush;
+    }
+    return file;
+}
+
+/* resolves a \ separated path below Base ("" being the volume root) by a case-insensitive match of each component */
+static char *resolvePath(const char *Base, const CHAR16 *Name) {
+    char *name = toAscii(Name, strLen16(Name)), *path, *component, *save, *candidate;
+    struct dirent *entry;
+    DIR *dir;
+
+    path = strdup(name[0] == '\\' ? "" : Base);
+    for (component = strtok_r(name, "\\", &save); component; component = strtok_r(NULL, "\\", &save)) {
+        if (strcmp(component, ".") == 0)
+            continue;
+        if (strcmp(component, "..") == 0) {
+            candidate = strrchr(path, '/');
+            *(candidate ? candidate : path) = 0;
+            continue;
+        }
+        candidate = NULL;
+        if (asprintf(&candidate, "%s/%s", rootDir, path) < 0 || (dir = opendir(candidate)) == NULL) {
+            free(candidate);
+            free(path);
+            free(name);
+            return NULL;
+        }
+        free(candidate);
+        candidate = NULL;
+        while ((entry = readdir(dir)) != NULL)
+            if (strcasecmp(entry->d_name, component) == 0) {
+                if (asprintf(&candidate, "%s/%s", path, entry->d_name) < 0)
+                    candidate = NULL;
+                break;
+            }
+        closedir(dir);
+        free(path);
+        if (candidate == NULL) {
+            free(name);
+            return NULL;
+        }
+        path = candidate;
+    }
+    free(name);
+    return path;
+}
+
+/* creates the last component of Name in its (existing) parent directory, returns the volume path */
+static char *createPath(const char *Base, const CHAR16 *Name, UINT64 Attributes) {
+    UINTN length = strLen16(Name), slash = length;
+    CHAR16 *parentName;
+    char *parent, *leaf, *path = NULL, *hostPath = NULL;
+    FILE *f;
+
+    while (slash > 0 && Name[slash - 1] != L'\\')
+        slash--;
+    parentName = calloc(slash + 2, sizeof(CHAR16));
+    memcpy(parentName, Name, (slash > 1 ? slash - 1 : slash) * sizeof(CHAR16));
+    parent = resolvePath(Base, parentName);
+    free(parentName);
+    leaf = toAscii(Name + slash, length - slash);
+    if (parent != NULL && leaf[0] != 0 && asprintf(&path, "%s/%s", parent, leaf) >= 0
+            && asprintf(&hostPath, "%s/%s", rootDir, path) >= 0) {
+        if (Attributes & EFI_FILE_DIRECTORY) {
+            if (mkdir(hostPath, 0777) != 0) {
+                free(path);
+                path = NULL;
+            }
+        } else if ((f = fopen(hostPath, "wb")) != NULL) {
+            fclose(f);
+        } else {
+            free(path);
+            path = NULL;
+        }
+    }
+    free(hostPath);
+    free(leaf);
+    free(parent);
+    return path;
+}
+
+static EFI_STATUS EFIAPI mockFileOpen(EFI_FILE *File, EFI_FILE **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes) {
+    char *path, *hostPath;
+    MOCK_FILE *file;
+
+    if (OpenMode != EFI_FILE_MODE_READ && !writable)
+        return EFI_WRITE_PROTECTED;
+    path = resolvePath(((MOCK_FILE *) File)->Path, FileName);
+    if (path == NULL && (OpenMode & EFI_FILE_MODE_CREATE))
+        path = createPath(((MOCK_FILE *) File)->Path, FileName, Attributes);
+    if (path == NULL)
+        return EFI_NOT_FOUND;
+    if (asprintf(&hostPath, "%s/%s", rootDir, path) < 0)
+        hostPath = NULL;
+    file = hostPath ? newFile(hostPath) : NULL;
+    if (file == NULL) {
+        free(path);
+        return EFI_NOT_FOUND;
+    }
+    free(file->Path);
+    file->Path = path;
+    *NewHandle = &file->File;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileClose(EFI_FILE *File) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+
+    if (file->Host)
+        fclose(file->Host);
+    if (file->Dir)
+        closedir(file->Dir);
+    free(file->Path);
+    free(file);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileDelete(EFI_FILE *File) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+    EFI_STATUS status = EFI_SUCCESS;
+    char *hostPath;
+
+    if (file->Path[0] == 0 || asprintf(&hostPath, "%s/%s", rootDir, file->Path) < 0) {
+        mockFileClose(File);
+        return EFI_WARN_DELETE_FAILURE;
+    }
+    if (file->Host) {
+        fclose(file->Host);
+        file->Host = NULL;
+    }
+    if (file->Dir) {
+        closedir(file->Dir);
+        file->Dir = NULL;
+    }
+    if (remove(hostPath) != 0)
+        status = EFI_WARN_DELETE_FAILURE;
+    free(hostPath);
+    mockFileClose(File);
+    return status;
+}
+
+static EFI_STATUS EFIAPI mockFileWrite(EFI_FILE *File, UINTN *BufferSize, VOID *Buffer) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+
+    if (file->Host == NULL)
+        return EFI_UNSUPPORTED;
+    fseek(file->Host, file->Position, SEEK_SET);
+    *BufferSize = fwrite(Buffer, 1, *BufferSize, file->Host);
+    file->Position += *BufferSize;
+    calls.FileWrite++;
+    return ferror(file->Host) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileFlush(EFI_FILE *File) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+
+    if (file->Host && fflush(file->Host) != 0)
+        return EFI_DEVICE_ERROR;
+    return EFI_SUCCESS;
+}
+
+static void toEfiTime(time_t Time, EFI_TIME *Efi) {
+    struct tm tm;
+
+    gmtime_r(&Time, &tm);
+    memset(Efi, 0, sizeof(EFI_TIME));
+    Efi->Year = tm.tm_year + 1900;
+    Efi->Month = tm.tm_mon + 1;
+    Efi->Day = tm.tm_mday;
+    Efi->Hour = tm.tm_hour;
+    Efi->Minute = tm.tm_min;
+    Efi->Second = tm.tm_sec;
+}
+
+/* fills an EFI_FILE_INFO for the host file Path, named Name */
+static EFI_STATUS fileInfo(const char *Path, const char *Name, UINTN *BufferSize, VOID *Buffer) {
+    UINTN needed = SIZE_OF_EFI_FILE_INFO + (strlen(Name) + 1) * sizeof(CHAR16), i;
+    EFI_FILE_INFO *info = Buffer;
+    struct stat st;
+
+    if (stat(Path, &st) != 0)
+        return EFI_DEVICE_ERROR;
+    if (*BufferSize < needed) {
+        *BufferSize = needed;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    memset(info, 0, needed);
+    info->Size = needed;
+    info->FileSize = S_ISDIR(st.st_mode) ? 0 : st.st_size;
+    info->PhysicalSize = (info->FileSize + 511) & ~511ULL;
+    toEfiTime(st.st_mtime, &info->CreateTime);
+    toEfiTime(st.st_atime, &info->LastAccessTime);
+    toEfiTime(st.st_mtime, &info->ModificationTime);
+    info->Attribute = (S_ISDIR(st.st_mode) ? EFI_FILE_DIRECTORY : EFI_FILE_ARCHIVE) | (writable ? 0 : EFI_FILE_READ_ONLY);
+    for (i = 0; Name[i]; i++)
+        info->FileName[i] = (UINT8) Name[i];
+    info->FileName[i] = 0;
+    *BufferSize = needed;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileRead(EFI_FILE *File, UINTN *BufferSize, VOID *Buffer) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+    struct dirent *entry;
+    EFI_STATUS status;
+    char *path;
+    long offset;
+
+    if (file->Host) {
+        fseek(file->Host, file->Position, SEEK_SET);
+        *BufferSize = fread(Buffer, 1, *BufferSize, file->Host);
+        file->Position += *BufferSize;
+        if (readRate)
+            usleep(*BufferSize * 1000ULL / readRate);
+        return EFI_SUCCESS;
+    }
+    do {
+        offset = telldir(file->Dir);
+        entry = readdir(file->Dir);
+    } while (entry && (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0));
+    if (entry == NULL) {
+        *BufferSize = 0;
+        return EFI_SUCCESS;
+    }
+    if (asprintf(&path, "%s/%s/%s", rootDir, file->Path, entry->d_name) < 0)
+        return EFI_OUT_OF_RESOURCES;
+    status = fileInfo(path, entry->d_name, BufferSize, Buffer);
+    free(path);
+    if (status == EFI_BUFFER_TOO_SMALL)
+        seekdir(file->Dir, offset);
+    return status;
+}
+
+static EFI_STATUS EFIAPI mockFileReadEx(EFI_FILE *File, EFI_FILE_IO_TOKEN *Token) {
+    Token->Status = mockFileRead(File, &Token->BufferSize, Token->Buffer);
+    if (Token->Event)
+        signalEvent(Token->Event);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileGetPosition(EFI_FILE *File, UINT64 *Position) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+
+    if (file->Dir)
+        return EFI_UNSUPPORTED;
+    *Position = file->Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileSetPosition(EFI_FILE *File, UINT64 Position) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+    struct stat st;
+
+    if (file->Dir) {
+        if (Position != 0)
+            return EFI_UNSUPPORTED;
+        rewinddir(file->Dir);
+        return EFI_SUCCESS;
+    }
+    if (Position == 0xFFFFFFFFFFFFFFFFULL) {
+        fstat(fileno(file->Host), &st);
+        Position = st.st_size;
+    }
+    file->Position = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFileGetInfo(EFI_FILE *File, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer) {
+    MOCK_FILE *file = (MOCK_FILE *) File;
+    const char *name = strrchr(file->Path, '/');
+    EFI_STATUS status;
+    char *path;
+
+    if (!guidEqual(InformationType, &fileInfoGuid))
+        return EFI_UNSUPPORTED;
+    if (asprintf(&path, "%s/%s", rootDir, file->Path) < 0)
+        return EFI_OUT_OF_RESOURCES;
+    status = fileInfo(path, name ? name + 1 : "\\", BufferSize, Buffer);
+    free(path);
+    return status;
+}
+
+static EFI_STATUS EFIAPI mockOpenVolume(EFI_FILE_IO_INTERFACE *This, EFI_FILE **Root) {
+    MOCK_FILE *file = newFile(strdup(rootDir));
+
+    if (file == NULL)
+        return EFI_NO_MEDIA;
+    free(file->Path);
+    file->Path = strdup("");
+    *Root = &file->File;
+    return EFI_SUCCESS;
+}
+
+/* every 64 bit word of a block on the disk under the volume holds its LBA, so misplaced data shows */
+static EFI_STATUS EFIAPI mockReadBlocks(EFI_BLOCK_IO *This, UINT32 MediaId, EFI_LBA LBA, UINTN BufferSize, VOID *Buffer) {
+    UINT64 *word = Buffer;
+    UINTN i;
+
+    if (MediaId != blockIoMedia.MediaId)
+        return EFI_MEDIA_CHANGED;
+    if (BufferSize % blockIoMedia.BlockSize)
+        return EFI_BAD_BUFFER_SIZE;
+    if (LBA + BufferSize / blockIoMedia.BlockSize > blockIoMedia.LastBlock + 1)
+        return EFI_INVALID_PARAMETER;
+    for (i = 0; i < BufferSize / sizeof(UINT64); i++)
+        word[i] = LBA + i * sizeof(UINT64) / blockIoMedia.BlockSize;
+    calls.ReadBlocks++;
+    calls.BlockBytes += BufferSize;
+    if (blockLatency || readRate)
+        usleep(blockLatency + (readRate ? BufferSize * 1000ULL / readRate : 0));
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockBlockReset(EFI_BLOCK_IO *This, BOOLEAN ExtendedVerification) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockFlushBlocks(EFI_BLOCK_IO *This) {
+    return EFI_SUCCESS;
+}
+
+/*
+ * Images: LoadImage reads the file and asks the security protocols through
+ * their (possibly hooked) interface structures like the DXE core does
+ */
+
+static EFI_STATUS EFIAPI mockAuthenticationState(const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
+        const EFI_DEVICE_PATH_PROTOCOL *File) {
+    return verdict;
+}
+
+static EFI_STATUS EFIAPI mockAuthentication(const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy) {
+    return verdict;
+}
+
+/* reads the file named by the file path nodes of FilePath */
+static EFI_STATUS readImage(EFI_DEVICE_PATH *FilePath, VOID **Buffer, UINTN *Size) {
+    CHAR16 name[1024];
+    UINTN length = 0, nodeLength;
+    EFI_FILE *root, *file;
+    EFI_STATUS status;
+    UINTN bufferSize;
+    FILE *host;
+    long size;
+
+    for (; !IsDevicePathEnd(FilePath); FilePath = NextDevicePathNode(FilePath)) {
+        if (DevicePathType(FilePath) != MEDIA_DEVICE_PATH || DevicePathSubType(FilePath) != MEDIA_FILEPATH_DP)
+            continue;
+        nodeLength = strLen16(((FILEPATH_DEVICE_PATH *) FilePath)->PathName);
+        if (length + nodeLength + 2 > sizeof(name) / sizeof(name[0]))
+            return EFI_INVALID_PARAMETER;
+        if (length && name[length - 1] != '\\' && ((FILEPATH_DEVICE_PATH *) FilePath)->PathName[0] != '\\')
+            name[length++] = '\\';
+        memcpy(name + length, ((FILEPATH_DEVICE_PATH *) FilePath)->PathName, nodeLength * sizeof(CHAR16));
+        length += nodeLength;
+    }
+    if (length == 0)
+        return EFI_NOT_FOUND;
+    name[length] = 0;
+
+    status = mockOpenVolume(&simpleFS, &root);
+    if (EFI_ERROR(status))
+        return status;
+    status = mockFileOpen(root, &file, name, EFI_FILE_MODE_READ, 0);
+    mockFileClose(root);
+    if (EFI_ERROR(status))
+        return status;
+    host = ((MOCK_FILE *) file)->Host;
+    if (host == NULL) {
+        mockFileClose(file);
+        return EFI_NOT_FOUND;
+    }
+    fseek(host, 0, SEEK_END);
+    size = ftell(host);
+    *Buffer = malloc(size ? size : 1);
+    bufferSize = size;
+    status = mockFileRead(file, &bufferSize, *Buffer);
+    mockFileClose(file);
+    *Size = bufferSize;
+    return status;
+}
+
+static EFI_DEVICE_PATH *filePathOnly(EFI_DEVICE_PATH *FilePath) {
+    EFI_DEVICE_PATH *node = FilePath, *copy;
+    UINTN size;
+
+    while (!IsDevicePathEnd(node) && !(DevicePathType(node) == MEDIA_DEVICE_PATH && DevicePathSubType(node) == MEDIA_FILEPATH_DP))
+        node = NextDevicePathNode(node);
+    for (size = 0; !IsDevicePathEnd((EFI_DEVICE_PATH *) ((UINT8 *) node + size));)
+        size += DevicePathNodeLength((EFI_DEVICE_PATH *) ((UINT8 *) node + size));
+    copy = malloc(size + sizeof(EFI_DEVICE_PATH));
+    memcpy(copy, node, size + sizeof(EFI_DEVICE_PATH));
+    return copy;
+}
+
+static EFI_STATUS EFIAPI mockLoadImage(BOOLEAN BootPolicy, EFI_HANDLE ParentImageHandle, EFI_DEVICE_PATH *FilePath,
+        VOID *SourceBuffer, UINTN SourceSize, EFI_HANDLE *ImageHandle) {
+    EFI_SECURITY2_PROTOCOL *sec2 = findProtocol(&securityHandle, &security2Guid);
+    EFI_SECURITY_PROTOCOL *sec = findProtocol(&securityHandle, &securityGuid);
+    EFI_STATUS status, authStatus;
+    MOCK_IMAGE *image;
+    VOID *buffer;
+    UINTN size;
+
+    calls.LoadImage++;
+    if (SourceBuffer == NULL) {
+        status = readImage(FilePath, &buffer, &size);
+        if (EFI_ERROR(status))
+            return status;
+    } else {
+        buffer = malloc(SourceSize ? SourceSize : 1);
+        memcpy(buffer, SourceBuffer, SourceSize);
+        size = SourceSize;
+    }
+
+    if (sec2)
+        authStatus = sec2->FileAuthentication(sec2, FilePath, buffer, size, BootPolicy);
+    else
+        authStatus = sec->FileAuthenticationState(sec, 0, FilePath);
+    if (authStatus != EFI_SUCCESS && authStatus != EFI_SECURITY_VIOLATION) {
+        calls.Denied++;
+        free(buffer);
+        return authStatus == EFI_ACCESS_DENIED ? EFI_ACCESS_DENIED : EFI_SECURITY_VIOLATION;
+    }
+
+    image = calloc(1, sizeof(MOCK_IMAGE));
+    image->Buffer = buffer;
+    image->Image.Revision = 0x1000;
+    image->Image.ParentHandle = ParentImageHandle;
+    image->Image.SystemTable = &systemTable;
+    image->Image.DeviceHandle = &deviceHandle;
+    image->Image.FilePath = filePathOnly(FilePath);
+    image->Image.ImageBase = buffer;
+    image->Image.ImageSize = size;
+    image->Image.ImageCodeType = EfiLoaderCode;
+    image->Image.ImageDataType = EfiLoaderData;
+    installProtocol(image, &loadedImageGuid, &image->Image);
+    *ImageHandle = image;
+    if (authStatus == EFI_SECURITY_VIOLATION)
+        calls.Denied++;
+    return authStatus;
+}
+
+/* what GRUB does to the disk while loading modules: runs of 4 KB reads, a few read twice */
+static void startedImageReads(void) {
+    static UINT64 buffer[4096 / sizeof(UINT64)];
+    struct timespec start, end;
+    UINTN run, i, j, reads = 0, bad = 0;
+    EFI_LBA lba;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (run = 0; run < 64; run++) {
+        lba = 2048 + (run * 7919 % 48) * 512 + (run & 1 ? 0 : 8);
+        for (i = 0; i < 16 + run % 24; i++, lba += sizeof(buffer) / blockIoMedia.BlockSize) {
+            if (blockIo.ReadBlocks(&blockIo, blockIoMedia.MediaId, lba, sizeof(buffer), buffer) != EFI_SUCCESS) {
+                bad++;
+                continue;
+            }
+            reads++;
+            for (j = 0; j < sizeof(buffer) / sizeof(UINT64); j++) {
+                if (buffer[j] != lba + j * sizeof(UINT64) / blockIoMedia.BlockSize) {
+                    bad++;
+                    break;
+                }
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(stderr, "efimock: the image read the disk: %lu reads of 4 KB in %ld ms, %lu bad\n", (unsigned long) reads,
+            (long) ((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000), (unsigned long) bad);
+}
+
+static EFI_STATUS EFIAPI mockStartImage(EFI_HANDLE ImageHandle, UINTN *ExitDataSize, CHAR16 **ExitData) {
+    MOCK_IMAGE *image = ImageHandle;
+    char *name;
+
+    if (findProtocol(ImageHandle, &loadedImageGuid) == NULL || ImageHandle == &imageHandle)
+        return EFI_INVALID_PARAMETER;
+    calls.StartImage++;
+    name = toAscii(((FILEPATH_DEVICE_PATH *) image->Image.FilePath)->PathName,
+            strLen16(((FILEPATH_DEVICE_PATH *) image->Image.FilePath)->PathName));
+    fprintf(stderr, "efimock: StartImage %s (%lu bytes)\n", name, (unsigned long) image->Image.ImageSize);
+    free(name);
+    if (blockLatency)
+        startedImageReads();
+    if (ExitDataSize)
+        *ExitDataSize = 0;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockUnloadImage(EFI_HANDLE ImageHandle) {
+    MOCK_IMAGE *image = ImageHandle;
+
+    if (findProtocol(ImageHandle, &loadedImageGuid) == NULL || ImageHandle == &imageHandle)
+        return EFI_INVALID_PARAMETER;
+    calls.UnloadImage++;
+    uninstallHandle(ImageHandle);
+    free(image->Image.FilePath);
+    free(image->Buffer);
+    free(image);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockExit(EFI_HANDLE ImageHandle, EFI_STATUS ExitStatus, UINTN ExitDataSize, CHAR16 *ExitData) {
+    if (ImageHandle == &imageHandle)
+        finish("Exit", ExitStatus);
+    return EFI_INVALID_PARAMETER;
+}
+
+/*
+ * Graphics output: a single mode with a framebuffer on the heap
+ */
+
+static EFI_STATUS EFIAPI mockGopQueryMode(EFI_GRAPHICS_OUTPUT_PROTOCOL *This, UINT32 ModeNumber, UINTN *SizeOfInfo,
+        EFI_GRAPHICS_OUTPUT_MODE_INFORMATION **Info) {
+    if (ModeNumber != 0)
+        return EFI_INVALID_PARAMETER;
+    mockAllocatePool(EfiBootServicesData, sizeof(gopInfo), (VOID **) Info);
+    memcpy(*Info, &gopInfo, sizeof(gopInfo));
+    *SizeOfInfo = sizeof(gopInfo);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockGopSetMode(EFI_GRAPHICS_OUTPUT_PROTOCOL *This, UINT32 ModeNumber) {
+    if (ModeNumber != 0)
+        return EFI_UNSUPPORTED;
+    memset((VOID *) (UINTN) gopMode.FrameBufferBase, 0, gopMode.FrameBufferSize);
+    return EFI_SUCCESS;
+}
+
+static BOOLEAN setupGop(const char *Size) {
+    unsigned width, height;
+
+    if (sscanf(Size, "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+        return FALSE;
+    gopInfo.HorizontalResolution = width;
+    gopInfo.VerticalResolution = height;
+    gopInfo.PixelFormat = PixelBlueGreenRedReserved8BitPerColor;
+    gopInfo.PixelsPerScanLine = width;
+    gopMode.MaxMode = 1;
+    gopMode.Info = &gopInfo;
+    gopMode.SizeOfInfo = sizeof(gopInfo);
+    gopMode.FrameBufferSize = (UINTN) width * height * 4;
+    gopMode.FrameBufferBase = (UINTN) calloc(1, gopMode.FrameBufferSize);
+    gop.QueryMode = (VOID *) mockGopQueryMode;
+    gop.SetMode = (VOID *) mockGopSetMode;
+    gop.Blt = (VOID *) mockUnsupported;
+    gop.Mode = &gopMode;
+    installProtocol(&gopHandle, &gopGuid, &gop);
+    return TRUE;
+}
+
+/*
+ * MP services: every AP is a thread. As in the edk2 driver, an AP that has
+ * finished only signals its event and takes new work once the BSP looks at
+ * an event again.
+ */
+
+typedef struct {
+    pthread_t Thread;
+    EFI_AP_PROCEDURE Procedure;
+    VOID *Argument;
+    MOCK_EVENT *Event;
+    BOOLEAN Busy;
+    int Finished;
+} MOCK_AP;
+
+static MOCK_AP *aps;
+
+static void *apThread(void *Arg) {
+    MOCK_AP *ap = Arg;
+
+    ap->Procedure(ap->Argument);
+    __atomic_store_n(&ap->Finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* collects the APs that have finished; TRUE if any is still running */
+static BOOLEAN pollAps(void) {
+    BOOLEAN running = FALSE;
+    UINTN i;
+
+    for (i = 1; i < processorCount; i++) {
+        if (!aps[i].Busy)
+            continue;
+        if (!__atomic_load_n(&aps[i].Finished, __ATOMIC_ACQUIRE)) {
+            running = TRUE;
+            continue;
+        }
+        pthread_join(aps[i].Thread, NULL);
+        aps[i].Busy = FALSE;
+        if (aps[i].Event)
+            signalEvent(aps[i].Event);
+    }
+    return running;
+}
+
+static EFI_STATUS EFIAPI mockGetNumberOfProcessors(EFI_MP_SERVICES_PROTOCOL *This, UINTN *NumberOfProcessors,
+        UINTN *NumberOfEnabledProcessors) {
+    *NumberOfProcessors = processorCount;
+    *NumberOfEnabledProcessors = processorCount;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockGetProcessorInfo(EFI_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        EFI_PROCESSOR_INFORMATION *ProcessorInfoBuffer) {
+    if (ProcessorNumber >= processorCount)
+        return EFI_NOT_FOUND;
+    memset(ProcessorInfoBuffer, 0, sizeof(EFI_PROCESSOR_INFORMATION));
+    ProcessorInfoBuffer->ProcessorId = ProcessorNumber;
+    ProcessorInfoBuffer->StatusFlag = PROCESSOR_ENABLED_BIT | PROCESSOR_HEALTH_STATUS_BIT |
+        (ProcessorNumber == 0 ? PROCESSOR_AS_BSP_BIT : 0);
+    ProcessorInfoBuffer->Location.Core = ProcessorNumber;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockStartupThisAP(EFI_MP_SERVICES_PROTOCOL *This, EFI_AP_PROCEDURE Procedure, UINTN ProcessorNumber,
+        EFI_EVENT WaitEvent, UINTN TimeoutInMicroseconds, VOID *ProcedureArgument, BOOLEAN *Finished) {
+    MOCK_AP *ap;
+
+    calls.StartupThisAP++;
+    if (ProcessorNumber == 0 || ProcessorNumber >= processorCount || Procedure == NULL)
+        return EFI_INVALID_PARAMETER;
+    ap = &aps[ProcessorNumber];
+    if (ap->Busy) {
+        calls.ApsBusy++;
+        return EFI_NOT_READY;
+    }
+    ap->Procedure = Procedure;
+    ap->Argument = ProcedureArgument;
+    ap->Event = WaitEvent;
+    ap->Finished = 0;
+    ap->Busy = TRUE;
+    if (pthread_create(&ap->Thread, NULL, apThread, ap) != 0) {
+        ap->Busy = FALSE;
+        return EFI_DEVICE_ERROR;
+    }
+    if (WaitEvent == NULL) {
+        pthread_join(ap->Thread, NULL);
+        ap->Busy = FALSE;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockWhoAmI(EFI_MP_SERVICES_PROTOCOL *This, UINTN *ProcessorNumber) {
+    /* only the BSP calls the firmware */
+    *ProcessorNumber = 0;
+    return EFI_SUCCESS;
+}
+
+static void setupMpServices(void) {
+    aps = calloc(processorCount, sizeof(MOCK_AP));
+    mpServices.GetNumberOfProcessors = (VOID *) mockGetNumberOfProcessors;
+    mpServices.GetProcessorInfo = (VOID *) mockGetProcessorInfo;
+    mpServices.StartupAllAPs = (VOID *) mockUnsupported;
+    mpServices.StartupThisAP = (VOID *) mockStartupThisAP;
+    mpServices.SwitchBSP = (VOID *) mockUnsupported;
+    mpServices.EnableDisableAP = (VOID *) mockUnsupported;
+    mpServices.WhoAmI = (VOID *) mockWhoAmI;
+    installProtocol(&mpHandle, &mpServicesGuid, &mpServices);
+}
+
+/*
+ * RAM disks: the memory has to be a live page allocation; the disk gets the
+ * boot volume's block I/O and file system, so its \EFI\BOOT is the volume's
+ */
+
+static EFI_STATUS EFIAPI mockRegisterRamDisk(UINT64 RamDiskBase, UINT64 RamDiskSize, EFI_GUID *RamDiskType,
+        EFI_DEVICE_PATH *ParentDevicePath, EFI_DEVICE_PATH **DevicePath) {
+    static UINT16 instance;
+    MOCK_RAM_DISK *disk;
+    MOCK_PAGES *entry;
+
+    if (RamDiskSize == 0 || RamDiskType == NULL || DevicePath == NULL || ParentDevicePath != NULL)
+        return EFI_INVALID_PARAMETER;
+    for (entry = pages; entry != NULL; entry = entry->Next)
+        if (RamDiskBase >= entry->Address && RamDiskBase + RamDiskSize <= entry->Address + entry->Pages * EFI_PAGE_SIZE)
+            break;
+    if (entry == NULL)
+        return EFI_INVALID_PARAMETER;
+    calls.RamDiskRegister++;
+    calls.RamDiskBytes += RamDiskSize;
+    disk = calloc(1, sizeof(MOCK_RAM_DISK));
+    disk->Node.Header.Type = MEDIA_DEVICE_PATH;
+    disk->Node.Header.SubType = 9;
+    disk->Node.Header.Length[0] = sizeof(RAM_DISK_NODE);
+    disk->Node.StartingAddr[0] = (UINT32) RamDiskBase;
+    disk->Node.StartingAddr[1] = (UINT32) (RamDiskBase >> 32);
+    disk->Node.EndingAddr[0] = (UINT32) (RamDiskBase + RamDiskSize - 1);
+    disk->Node.EndingAddr[1] = (UINT32) ((RamDiskBase + RamDiskSize - 1) >> 32);
+    disk->Node.TypeGuid = *RamDiskType;
+    disk->Node.Instance = instance++;
+    disk->End = deviceEnd;
+    installProtocol(disk, &devicePathGuid, disk);
+    installProtocol(disk, &blockIoGuid, &blockIo);
+    installProtocol(disk, &simpleFSGuid, &simpleFS);
+    mockAllocatePool(EfiBootServicesData, sizeof(MOCK_RAM_DISK), (VOID **) DevicePath);
+    memcpy(*DevicePath, disk, sizeof(MOCK_RAM_DISK));
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockUnregisterRamDisk(EFI_DEVICE_PATH *DevicePath) {
+    EFI_HANDLE disk;
+    UINTN i;
+
+    for (i = 0; i < handleProtocolCount; i++) {
+        if (guidEqual(&handleProtocols[i].Guid, &devicePathGuid) && handleProtocols[i].Interface == handleProtocols[i].Handle
+                && memcmp(handleProtocols[i].Interface, DevicePath, sizeof(MOCK_RAM_DISK)) == 0) {
+            calls.RamDiskUnregister++;
+            disk = handleProtocols[i].Handle;
+            uninstallHandle(disk);
+            free(disk);
+            return EFI_SUCCESS;
+        }
+    }
+    return EFI_NOT_FOUND;
+}
+
+static void setupRamDisk(void) {
+    ramDisk.Register = (VOID *) mockRegisterRamDisk;
+    ramDisk.Unregister = (VOID *) mockUnregisterRamDisk;
+    installProtocol(&ramDiskHandle, &ramDiskGuid, &ramDisk);
+}
+
+/*
+ * Variables
+ */
+
+static MOCK_VARIABLE *findVariable(const CHAR16 *Name, const EFI_GUID *Guid) {
+    MOCK_VARIABLE *var;
+
+    for (var = variables; var != NULL; var = var->Next)
+        if (strLen16(var->Name) == strLen16(Name) && memcmp(var->Name, Name, strLen16(Name) * sizeof(CHAR16)) == 0
+                && (var->AnyGuid || guidEqual(&var->Guid, Guid)))
+            return var;
+    return NULL;
+}
+
+static EFI_STATUS EFIAPI mockGetVariable(CHAR16 *VariableName, EFI_GUID *VendorGuid, UINT32 *Attributes, UINTN *DataSize,
+        VOID *Data) {
+    MOCK_VARIABLE *var = findVariable(VariableName, VendorGuid);
+
+    calls.GetVariable++;
+    if (var == NULL)
+        return EFI_NOT_FOUND;
+    if (Attributes)
+        *Attributes = var->Attributes;
+    if (*DataSize < var->Size) {
+        *DataSize = var->Size;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *DataSize = var->Size;
+    memcpy(Data, var->Data, var->Size);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockSetVariable(CHAR16 *VariableName, EFI_GUID *VendorGuid, UINT32 Attributes, UINTN DataSize,
+        VOID *Data) {
+    MOCK_VARIABLE *var = findVariable(VariableName, VendorGuid), **link;
+
+    calls.SetVariable++;
+    if (DataSize == 0 || Attributes == 0) {
+        if (var == NULL)
+            return EFI_NOT_FOUND;
+        for (link = &variables; *link != var; link = &(*link)->Next)
+            ;
+        *link = var->Next;
+        free(var->Name);
+        free(var->Data);
+        free(var);
+        return EFI_SUCCESS;
+    }
+    if (var == NULL) {
+        var = calloc(1, sizeof(MOCK_VARIABLE));
+        var->Name = malloc((strLen16(VariableName) + 1) * sizeof(CHAR16));
+        memcpy(var->Name, VariableName, (strLen16(VariableName) + 1) * sizeof(CHAR16));
+        var->Next = variables;
+        variables = var;
+    }
+    var->Guid = *VendorGuid;
+    var->AnyGuid = FALSE;
+    var->Attributes = Attributes;
+    free(var->Data);
+    var->Data = malloc(DataSize);
+    memcpy(var->Data, Data, DataSize);
+    var->Size = DataSize;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockGetNextVariableName(UINTN *VariableNameSize, CHAR16 *VariableName, EFI_GUID *VendorGuid) {
+    MOCK_VARIABLE *var = variables;
+    UINTN size;
+
+    if (VariableName[0]) {
+        var = findVariable(VariableName, VendorGuid);
+        if (var == NULL)
+            return EFI_NOT_FOUND;
+        var = var->Next;
+    }
+    if (var == NULL)
+        return EFI_NOT_FOUND;
+    size = (strLen16(var->Name) + 1) * sizeof(CHAR16);
+    if (*VariableNameSize < size) {
+        *VariableNameSize = size;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    memcpy(VariableName, var->Name, size);
+    *VendorGuid = var->Guid;
+    *VariableNameSize = size;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI mockGetTime(EFI_TIME *Time, VOID *Capabilities) {
+    toEfiTime(time(NULL), Time);
+    return EFI_SUCCESS;
+}
+
+static VOID EFIAPI mockResetSystem(EFI_RESET_TYPE ResetType, EFI_STATUS ResetStatus, UINTN DataSize, CHAR16 *ResetData) {
+    static const char *types[] = { "cold", "warm", "shutdown" };
+
+    fprintf(stderr, "efimock: ResetSystem %s\n", ResetType <= EfiResetShutdown ? types[ResetType] : "platform specific");
+    finish("ResetSystem", EFI_SUCCESS);
+}
+
+static BOOLEAN preloadVariable(const char *Assignment) {
+    const char *eq = strchr(Assignment, '=');
+    MOCK_VARIABLE *var;
+    FILE *f;
+    long size;
+    UINTN i;
+
+    if (eq == NULL || eq == Assignment || (f = fopen(eq + 1, "rb")) == NULL)
+        return FALSE;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    var = calloc(1, sizeof(MOCK_VARIABLE));
+    var->Name = calloc(eq - Assignment + 1, sizeof(CHAR16));
+    for (i = 0; Assignment + i < eq; i++)
+        var->Name[i] = (UINT8) Assignment[i];
+    var->AnyGuid = TRUE;
+    var->Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+    var->Data = malloc(size ? size : 1);
+    var->Size = fread(var->Data, 1, size, f);
+    fclose(f);
+    var->Next = variables;
+    variables = var;
+    return TRUE;
+}
+
+/*
+ * Setup
+ */
+
+static EFI_DEVICE_PATH *makeFilePath(const char *Path) {
+    UINTN length = strlen(Path), size = SIZE_OF_FILEPATH_DEVICE_PATH + (length + 1) * sizeof(CHAR16), i;
+    FILEPATH_DEVICE_PATH *node = calloc(1, size + sizeof(EFI_DEVICE_PATH));
+
+    node->Header.Type = MEDIA_DEVICE_PATH;
+    node->Header.SubType = MEDIA_FILEPATH_DP;
+    SetDevicePathNodeLength(&node->Header, size);
+    for (i = 0; i < length; i++)
+        node->PathName[i] = Path[i] == '/' ? '\\' : (UINT8) Path[i];
+    SetDevicePathEndNode((EFI_DEVICE_PATH *) ((UINT8 *) node + size));
+    return &node->Header;
+}
+
+static void setupTables(const char *ImagePath, BOOLEAN Security2) {
+    fillUnsupported(&bootServices, sizeof(bootServices));
+    bootServices.RaiseTPL = (VOID *) mockRaiseTPL;
+    bootServices.RestoreTPL = (VOID *) mockRestoreTPL;
+    bootServices.AllocatePages = (VOID *) mockAllocatePages;
+    bootServices.FreePages = (VOID *) mockFreePages;
+    bootServices.GetMemoryMap = (VOID *) mockGetMemoryMap;
+    bootServices.AllocatePool = (VOID *) mockAllocatePool;
+    bootServices.FreePool = (VOID *) mockFreePool;
+    bootServices.CreateEvent = (VOID *) mockCreateEvent;
+    bootServices.SetTimer = (VOID *) mockSetTimer;
+    bootServices.WaitForEvent = (VOID *) mockWaitForEvent;
+    bootServices.SignalEvent = (VOID *) mockSignalEvent;
+    bootServices.CloseEvent = (VOID *) mockCloseEvent;
+    bootServices.CheckEvent = (VOID *) mockCheckEvent;
+    bootServices.HandleProtocol = (VOID *) mockHandleProtocol;
+    bootServices.LocateHandle = (VOID *) mockLocateHandle;
+    bootServices.LocateDevicePath = (VOID *) mockLocateDevicePath;
+    bootServices.LoadImage = (VOID *) mockLoadImage;
+    bootServices.StartImage = (VOID *) mockStartImage;
+    bootServices.Exit = (VOID *) mockExit;
+    bootServices.UnloadImage = (VOID *) mockUnloadImage;
+    bootServices.Stall = (VOID *) mockStall;
+    bootServices.SetWatchdogTimer = (VOID *) mockSetWatchdogTimer;
+    bootServices.OpenProtocol = (VOID *) mockOpenProtocol;
+    bootServices.CloseProtocol = (VOID *) mockCloseProtocol;
+    bootServices.LocateHandleBuffer = (VOID *) mockLocateHandleBuffer;
+    bootServices.LocateProtocol = (VOID *) mockLocateProtocol;
+    bootServices.CalculateCrc32 = (VOID *) mockCalculateCrc32;
+    bootServices.CopyMem = (VOID *) mockCopyMem;
+    bootServices.SetMem = (VOID *) mockSetMem;
+    setTableHeader(&bootServices.Hdr, EFI_BOOT_SERVICES_SIGNATURE, EFI_BOOT_SERVICES_REVISION, sizeof(bootServices));
+
+    fillUnsupported(&runtimeServices, sizeof(runtimeServices));
+    runtimeServices.GetTime = (VOID *) mockGetTime;
+    runtimeServices.GetVariable = (VOID *) mockGetVariable;
+    runtimeServices.GetNextVariableName = (VOID *) mockGetNextVariableName;
+    runtimeServices.SetVariable = (VOID *) mockSetVariable;
+    runtimeServices.ResetSystem = (VOID *) mockResetSystem;
+    setTableHeader(&runtimeServices.Hdr, EFI_RUNTIME_SERVICES_SIGNATURE, EFI_RUNTIME_SERVICES_REVISION, sizeof(runtimeServices));
+
+    conOut.Reset = (VOID *) mockConOutReset;
+    conOut.OutputString = (VOID *) mockOutputString;
+    conOut.TestString = (VOID *) mockTestString;
+    conOut.QueryMode = (VOID *) mockQueryMode;
+    conOut.SetMode = (VOID *) mockSetMode;
+    conOut.SetAttribute = (VOID *) mockSetAttribute;
+    conOut.ClearScreen = (VOID *) mockClearScreen;
+    conOut.SetCursorPosition = (VOID *) mockSetCursorPosition;
+    conOut.EnableCursor = (VOID *) mockEnableCursor;
+    conOut.Mode = &conOutMode;
+    conOutMode.MaxMode = sizeof(textModes) / sizeof(textModes[0]);
+    conOutMode.Attribute = EFI_TEXT_ATTR(EFI_LIGHTGRAY, EFI_BLACK);
+    conOutMode.CursorVisible = TRUE;
+    mockClearScreen(&conOut);
+    calls.ClearScreen = 0;
+
+    conIn.Reset = (VOID *) mockConInReset;
+    conIn.ReadKeyStroke = (VOID *) mockReadKeyStroke;
+    conIn.WaitForKey = &keyEvent;
+    conInEx.Reset = (VOID *) mockConInExReset;
+    conInEx.ReadKeyStrokeEx = (VOID *) mockReadKeyStrokeEx;
+    conInEx.WaitForKeyEx = &keyEvent;
+    conInEx.SetState = (VOID *) mockSetState;
+    conInEx.RegisterKeyNotify = (VOID *) mockRegisterKeyNotify;
+    conInEx.UnregisterKeyNotify = (VOID *) mockUnregisterKeyNotify;
+
+    systemTable.FirmwareVendor = L"grml-plus efimock";
+    systemTable.FirmwareRevision = 0x10000;
+    systemTable.ConsoleInHandle = &consoleHandle;
+    systemTable.ConIn = &conIn;
+    systemTable.ConsoleOutHandle = &consoleHandle;
+    systemTable.ConOut = &conOut;
+    systemTable.StandardErrorHandle = &consoleHandle;
+    systemTable.StdErr = &conOut;
+    systemTable.RuntimeServices = &runtimeServices;
+    systemTable.BootServices = &bootServices;
+    setTableHeader(&systemTable.Hdr, EFI_SYSTEM_TABLE_SIGNATURE, EFI_SYSTEM_TABLE_REVISION, sizeof(systemTable));
+
+    simpleFS.Revision = 0x10000;
+    simpleFS.OpenVolume = (VOID *) mockOpenVolume;
+    blockIoMedia.MediaId = 1;
+    blockIoMedia.RemovableMedia = TRUE;
+    blockIoMedia.MediaPresent = TRUE;
+    blockIoMedia.LogicalPartition = TRUE;
+    blockIoMedia.ReadOnly = TRUE;
+    blockIoMedia.BlockSize = 512;
+    blockIoMedia.LastBlock = DISK_BLOCKS - 1;
+    blockIo.Revision = 0x10000;
+    blockIo.Media = &blockIoMedia;
+    blockIo.Reset = (VOID *) mockBlockReset;
+    blockIo.ReadBlocks = (VOID *) mockReadBlocks;
+    blockIo.WriteBlocks = (VOID *) mockWriteProtected;
+    blockIo.FlushBlocks = (VOID *) mockFlushBlocks;
+    installProtocol(&deviceHandle, &devicePathGuid, &deviceEnd);
+    installProtocol(&deviceHandle, &simpleFSGuid, &simpleFS);
+    installProtocol(&deviceHandle, &blockIoGuid, &blockIo);
+
+    security.FileAuthenticationState = mockAuthenticationState;
+    security2.FileAuthentication = mockAuthentication;
+    installProtocol(&securityHandle, &securityGuid, &security);
+    if (Security2)
+        installProtocol(&securityHandle, &security2Guid, &security2);
+
+    loadedImage.Revision = 0x1000;
+    loadedImage.SystemTable = &systemTable;
+    loadedImage.DeviceHandle = &deviceHandle;
+    loadedImage.FilePath = makeFilePath(ImagePath);
+    loadedImage.ImageCodeType = EfiLoaderCode;
+    loadedImage.ImageDataType = EfiLoaderData;
+    installProtocol(&imageHandle, &loadedImageGuid, &loadedImage);
+}
+
+static struct {
+    ACPI_RSDP Rsdp;
+    struct {
+        ACPI_TABLE_HEADER Header;
+        UINT64 Entries[2];
+    } __attribute__((packed)) Xsdt;
+    struct {
+        ACPI_TABLE_HEADER Header;
+        FPDT_POINTER_RECORD Pointer;
+    } __attribute__((packed)) Fpdt;
+    struct {
+        FBPT_HEADER Header;
+        FPDT_FIRMWARE_BASIC_BOOT_RECORD Boot;
+    } __attribute__((packed)) Fbpt;
+    struct {
+        ACPI_SRAT Header;
+        SRAT_MEMORY_AFFINITY Memory[2];
+    } __attribute__((packed)) Srat;
+} acpiTables;
+static EFI_CONFIGURATION_TABLE configurationTable[1];
+
+static UINT8 acpiChecksum(const VOID *Table, UINTN Length) {
+    const UINT8 *p = Table;
+    UINT8 sum = 0;
+
+    while (Length--)
+        sum += *p++;
+    return -sum;
+}
+
+static UINT64 readTsc(void) {
+    UINT32 lo, hi;
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((UINT64) hi << 32) | lo;
+}
+
+/*
+ * The FPDT's times are nanoseconds since reset, which the tools take the TSC
+ * for; it is converted with the frequency they will derive (bootperf.c), so
+ * that both sets of records line up.
+ */
+static void setupAcpi(void) {
+    EFI_GUID acpi20TableGuid = ACPI_20_TABLE_GUID;
+    struct timespec delay = { 0, 10000000 };
+    UINT32 eax, ebx, ecx, edx;
+    UINT64 frequency = 0, start, nowNs;
+    UINTN i;
+
+    asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0), "c" (0));
+    if (eax >= 0x15) {
+        asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0x15), "c" (0));
+        if (eax != 0 && ebx != 0 && ecx != 0)
+            frequency = (UINT64) ecx * ebx / eax;
+    }
+    if (frequency == 0) {
+        start = readTsc();
+        nanosleep(&delay, NULL);
+        frequency = (readTsc() - start) * 100;
+    }
+    nowNs = (UINT64) ((unsigned __int128) readTsc() * 1000000000 / frequency);
+
+    acpiTables.Fbpt.Header.Signature = ACPI_FBPT_SIGNATURE;
+    acpiTables.Fbpt.Header.Length = sizeof(acpiTables.Fbpt);
+    acpiTables.Fbpt.Boot.Header.Type = FPDT_FIRMWARE_BASIC_BOOT_TYPE;
+    acpiTables.Fbpt.Boot.Header.Length = sizeof(acpiTables.Fbpt.Boot);
+    acpiTables.Fbpt.Boot.Header.Revision = 2;
+    acpiTables.Fbpt.Boot.ResetEnd = nowNs > 2000000000ULL ? nowNs - 2000000000ULL : 0;
+    acpiTables.Fbpt.Boot.OsLoaderLoadImageStart = nowNs - 30000000ULL;
+    acpiTables.Fbpt.Boot.OsLoaderStartImageStart = nowNs - 5000000ULL;
+
+    acpiTables.Fpdt.Header.Signature = ACPI_FPDT_SIGNATURE;
+    acpiTables.Fpdt.Header.Length = sizeof(acpiTables.Fpdt);
+    acpiTables.Fpdt.Header.Revision = 1;
+    acpiTables.Fpdt.Pointer.Header.Type = FPDT_FBPT_POINTER_TYPE;
+    acpiTables.Fpdt.Pointer.Header.Length = sizeof(acpiTables.Fpdt.Pointer);
+    acpiTables.Fpdt.Pointer.Header.Revision = 1;
+    acpiTables.Fpdt.Pointer.Address = (UINTN) &acpiTables.Fbpt;
+    acpiTables.Fpdt.Header.Checksum = acpiChecksum(&acpiTables.Fpdt, sizeof(acpiTables.Fpdt));
+
+    acpiTables.Srat.Header.Header.Signature = ACPI_SRAT_SIGNATURE;
+    acpiTables.Srat.Header.Header.Length = sizeof(acpiTables.Srat);
+    acpiTables.Srat.Header.Header.Revision = 3;
+    acpiTables.Srat.Header.Reserved1 = 1;
+    for (i = 0; i < 2; i++) {
+        acpiTables.Srat.Memory[i].Header.Type = SRAT_MEMORY_AFFINITY_TYPE;
+        acpiTables.Srat.Memory[i].Header.Length = sizeof(SRAT_MEMORY_AFFINITY);
+        acpiTables.Srat.Memory[i].ProximityDomain = i;
+        acpiTables.Srat.Memory[i].BaseAddress = i ? HIGH_MEMORY_START : 0;
+        acpiTables.Srat.Memory[i].Length = i ? HIGH_MEMORY_PAGES * EFI_PAGE_SIZE : HIGH_MEMORY_START;
+        acpiTables.Srat.Memory[i].Flags = SRAT_MEMORY_ENABLED;
+    }
+    acpiTables.Srat.Header.Header.Checksum = acpiChecksum(&acpiTables.Srat, sizeof(acpiTables.Srat));
+
+    memcpy(&acpiTables.Xsdt.Header.Signature, "XSDT", 4);
+    acpiTables.Xsdt.Header.Length = sizeof(acpiTables.Xsdt);
+    acpiTables.Xsdt.Header.Revision = 1;
+    acpiTables.Xsdt.Entries[0] = (UINTN) &acpiTables.Fpdt;
+    acpiTables.Xsdt.Entries[1] = (UINTN) &acpiTables.Srat;
+    acpiTables.Xsdt.Header.Checksum = acpiChecksum(&acpiTables.Xsdt, sizeof(acpiTables.Xsdt));
+
+    memcpy(&acpiTables.Rsdp.Signature, "RSD PTR ", 8);
+    memcpy(acpiTables.Rsdp.OemId, "EFIMCK", 6);
+    acpiTables.Rsdp.Revision = 2;
+    acpiTables.Rsdp.Length = sizeof(acpiTables.Rsdp);
+    acpiTables.Rsdp.XsdtAddress = (UINTN) &acpiTables.Xsdt;
+    acpiTables.Rsdp.Checksum = acpiChecksum(&acpiTables.Rsdp, 20);
+    acpiTables.Rsdp.ExtendedChecksum = acpiChecksum(&acpiTables.Rsdp, sizeof(acpiTables.Rsdp));
+
+    configurationTable[0].VendorGuid = acpi20TableGuid;
+    configurationTable[0].VendorTable = &acpiTables.Rsdp;
+    systemTable.NumberOfTableEntries = 1;
+    systemTable.ConfigurationTable = configurationTable;
+}
+
+static void usage(const char *Name) {
+    fprintf(stderr, "usage: %s [-r dir] [-w] [-p path] [-k keys] [-n count] [-s violation|denied|success] [-1] [-e] [-a]\n"
+            "       [-m count] [-g WxH] [-v name=file]... [-b KBS] [-l usec] [-c cpus] [-d] [-t] [-q]\n", Name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0], *gopSize = NULL;
+    char *imagePath = NULL;
+    BOOLEAN security2 = TRUE, inputEx = TRUE, acpi = TRUE, ramDisks = TRUE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:wp:k:n:s:1eam:g:v:b:l:c:dtq")) != -1) {
+        switch (opt) {
+        case 'r':
+            rootDir = optarg;
+            break;
+        case 'w':
+            writable = TRUE;
+            break;
+        case 'p':
+            imagePath = optarg;
+            break;
+        case 'k':
+            parseKeys(optarg);
+            break;
+        case 'n':
+            keyRepeat = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            if (strcmp(optarg, "violation") == 0)
+                verdict = EFI_SECURITY_VIOLATION;
+            else if (strcmp(optarg, "denied") == 0)
+                verdict = EFI_ACCESS_DENIED;
+            else if (strcmp(optarg, "success") == 0)
+                verdict = EFI_SUCCESS;
+            else
+                usage(name);
+            break;
+        case '1':
+            security2 = FALSE;
+            break;
+        case 'e':
+            inputEx = FALSE;
+            break;
+        case 'a':
+            acpi = FALSE;
+            break;
+        case 'm':
+            highFragments = strtoul(optarg, NULL, 0);
+            if (highFragments == 0 || highFragments > HIGH_MEMORY_PAGES)
+                usage(name);
+            break;
+        case 'g':
+            gopSize = optarg;
+            break;
+        case 'v':
+            if (!preloadVariable(optarg)) {
+                fprintf(stderr, "%s: cannot preload %s\n", name, optarg);
+                return 2;
+            }
+            break;
+        case 'b':
+            readRate = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            blockLatency = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            processorCount = strtoul(optarg, NULL, 0);
+            if (processorCount == 0)
+                usage(name);
+            break;
+        case 'd':
+            ramDisks = FALSE;
+            break;
+        case 't':
+            trace = TRUE;
+            break;
+        case 'q':
+            quiet = TRUE;
+            break;
+        default:
+            usage(name);
+        }
+    }
+    if (optind != argc)
+        usage(name);
+
+    if (imagePath == NULL && asprintf(&imagePath, "\\EFI\\BOOT\\%s.efi", name) < 0)
+        return 2;
+    setupTables(imagePath, security2);
+    if (gopSize && !setupGop(gopSize))
+        usage(name);
+    if (processorCount > 1)
+        setupMpServices();
+    if (inputEx)
+        installProtocol(&consoleHandle, &textInputExGuid, &conInEx);
+    if (acpi)
+        setupAcpi();
+    if (ramDisks)
+        setupRamDisk();
+
+    finish("efi_main returned", efi_main(&imageHandle, &systemTable));
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * grml-plus UEFI tools - hotkeys through key notifications
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "efiabi.h"
+#include "hotkey.h"
+
+/* the notification functions get nothing but the key */
+static HOTKEYS *active;
+
+#ifdef NEED_THUNKS
+static EFI_STATUS thunk_keyNotify(EFI_KEY_DATA *KeyData)
+__attribute__((unused));
+#endif
+
+static INTN keyIndex(HOTKEYS *Hotkeys, EFI_INPUT_KEY *Key) {
+    UINTN i;
+
+    for (i = 0; i < Hotkeys->KeyCount; i++) {
+        if (Hotkeys->Keys[i].ScanCode == Key->ScanCode && Hotkeys->Keys[i].UnicodeChar == Key->UnicodeChar)
+            return i;
+    }
+    return -1;
+}
+
+/* runs at the keyboard driver's notify TPL */
+static __attribute__((used)) EFI_STATUS EFI_CALLBACK keyNotify(EFI_KEY_DATA *KeyData) {
+    UINT64 now = perfTimestamp();
+    HOTKEYS *hotkeys = active;
+    HOTKEY_PRESS *press;
+    INTN i;
+
+    if (hotkeys == NULL)
+        return EFI_SUCCESS;
+    i = keyIndex(hotkeys, &KeyData->Key);
+    /* already taken from ConIn otherwise */
+    if (i < 0 || ++hotkeys->Balance[i] <= 0)
+        return EFI_SUCCESS;
+    if (hotkeys->Count < HOTKEY_QUEUE_SIZE) {
+        press = &hotkeys->Queue[(hotkeys->Head + hotkeys->Count++) % HOTKEY_QUEUE_SIZE];
+        press->Key = KeyData->Key;
+        press->Tsc = now;
+        hotkeys->Notified++;
+    } else {
+        /* no room, so let ConIn deliver it */
+        hotkeys->Balance[i]--;
+    }
+    uefi_call_wrapper(BS->SignalEvent, 1, hotkeys->Event);
+    return EFI_SUCCESS;
+}
+
+#ifdef NEED_THUNKS
+THUNK4(keyNotify)
+#endif
+
+BOOLEAN hotkeyStart(HOTKEYS *Hotkeys, EFI_INPUT_KEY *Keys, UINTN Count) {
+    EFI_GUID inputExProtocol = EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL_GUID;
+    EFI_KEY_DATA keyData;
+    UINTN i;
+
+    if (Hotkeys->InputEx != NULL)
+        hotkeyStop(Hotkeys);
+    /* the statistics carry over, e.g. across child images */
+    ZeroMem(Hotkeys->Balance, sizeof(Hotkeys->Balance));
+    Hotkeys->KeyCount = Hotkeys->Head = Hotkeys->Count = 0;
+    if (uefi_call_wrapper(BS->HandleProtocol, 3, ST->ConsoleInHandle, &inputExProtocol, (VOID **) &Hotkeys->InputEx) != EFI_SUCCESS ||
+            uefi_call_wrapper(BS->CreateEvent, 5, 0, 0, NULL, NULL, &Hotkeys->Event) != EFI_SUCCESS) {
+        Hotkeys->InputEx = NULL;
+        return FALSE;
+    }
+    active = Hotkeys;
+    ZeroMem(&keyData, sizeof(keyData));
+    for (i = 0; i < Count && Hotkeys->KeyCount < HOTKEY_MAX_KEYS; i++) {
+        keyData.Key = Keys[i];
+        if (uefi_call_wrapper(Hotkeys->InputEx->RegisterKeyNotify, 4, Hotkeys->InputEx, &keyData,
+                (EFI_KEY_NOTIFY_FUNCTION) CALLBACK_ENTRY(keyNotify), &Hotkeys->Handles[Hotkeys->KeyCount]) == EFI_SUCCESS)
+            Hotkeys->Keys[Hotkeys->KeyCount++] = Keys[i];
+    }
+    return Hotkeys->KeyCount != 0;
+}
+
+/*
+ * Takes the ConIn strokes of key Index's notified presses out of ConIn, so
+ * that neither the menu nor whoever reads ConIn next sees them again.
+ * Whatever was typed before them was overtaken and goes as well.
+ */
+static VOID dropStrokes(HOTKEYS *Hotkeys, UINTN Index) {
+    EFI_INPUT_KEY key;
+    EFI_TPL tpl;
+    INTN k;
+
+    while (Hotkeys->Balance[Index] > 0 &&
+            uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key) == EFI_SUCCESS) {
+        k = keyIndex(Hotkeys, &key);
+        if (k < 0)
+            continue;
+        tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_NOTIFY);
+        Hotkeys->Balance[k]--;
+        uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+    }
+}
+
+VOID hotkeyStop(HOTKEYS *Hotkeys) {
+    UINTN i;
+
+    if (Hotkeys->InputEx == NULL)
+        return;
+    if (active == Hotkeys)
+        active = NULL;
+    for (i = 0; i < Hotkeys->KeyCount; i++)
+        uefi_call_wrapper(Hotkeys->InputEx->UnregisterKeyNotify, 2, Hotkeys->InputEx, Hotkeys->Handles[i]);
+    for (i = 0; i < Hotkeys->KeyCount; i++)
+        dropStrokes(Hotkeys, i);
+    uefi_call_wrapper(BS->CloseEvent, 1, Hotkeys->Event);
+    Hotkeys->Event = NULL;
+    Hotkeys->InputEx = NULL;
+    Hotkeys->KeyCount = Hotkeys->Count = 0;
+}
+
+EFI_STATUS hotkeyReadKey(HOTKEYS *Hotkeys, EFI_INPUT_KEY *Key, UINT64 *Tsc) {
+    EFI_STATUS status;
+    EFI_TPL tpl;
+    BOOLEAN fresh;
+    INTN i;
+
+    while (TRUE) {
+        tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_NOTIFY);
+        if (Hotkeys->Count != 0) {
+            *Key = Hotkeys->Queue[Hotkeys->Head].Key;
+            *Tsc = Hotkeys->Queue[Hotkeys->Head].Tsc;
+            Hotkeys->Head = (Hotkeys->Head + 1) % HOTKEY_QUEUE_SIZE;
+            Hotkeys->Count--;
+            uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+            /* the driver buffers the stroke before it notifies, so it can usually be dropped right away */
+            dropStrokes(Hotkeys, keyIndex(Hotkeys, Key));
+            break;
+        }
+        uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+
+        status = uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, Key);
+        if (status != EFI_SUCCESS)
+            return status;
+        *Tsc = perfTimestamp();
+        i = keyIndex(Hotkeys, Key);
+        if (i < 0)
+            break;
+        tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_NOTIFY);
+        fresh = --Hotkeys->Balance[i] < 0;
+        uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+        if (fresh) {
+            Hotkeys->Polled++;
+            break;
+        }
+    }
+    perfTally(PERF_KEY_TO_ACTION, *Tsc);
+    if (perfTimestamp() - *Tsc > Hotkeys->MaxTicks)
+        Hotkeys->MaxTicks = perfTimestamp() - *Tsc;
+    return EFI_SUCCESS;
+}
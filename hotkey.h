@@ -0,0 +1,86 @@
+/*
+ * grml-plus UEFI tools - hotkeys through key notifications
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOTKEY_H
+#define HOTKEY_H
+
+/*
+ * Menu keys are reported by RegisterKeyNotify callbacks of the console's
+ * SIMPLE_TEXT_INPUT_EX protocol as soon as the keyboard driver sees them,
+ * with the TSC of that moment, instead of when the menu polls ConIn. The
+ * callbacks only queue the press and signal Event; the menu picks it up in
+ * hotkeyReadKey.
+ *
+ * Every press also shows up in ConIn. Per key, Balance counts notifications
+ * minus strokes read from ConIn, so whichever of the two arrives first is
+ * acted on and the other is dropped. Reading ConIn directly while hotkeys
+ * are registered would upset that count, so anything that does (a child
+ * image, a screen waiting for "any key") runs between hotkeyStop and
+ * hotkeyStart; hotkeyStop takes the strokes of presses already acted on out
+ * of ConIn. Without SIMPLE_TEXT_INPUT_EX, every key comes from ConIn.
+ */
+
+#define HOTKEY_MAX_KEYS 32
+#define HOTKEY_QUEUE_SIZE 16
+
+typedef struct {
+    EFI_INPUT_KEY Key;
+    UINT64 Tsc;
+} HOTKEY_PRESS;
+
+typedef struct {
+    EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *InputEx;
+    EFI_EVENT Event;      /* signaled when a press is queued, NULL while stopped */
+    EFI_INPUT_KEY Keys[HOTKEY_MAX_KEYS];
+    VOID *Handles[HOTKEY_MAX_KEYS];
+    INTN Balance[HOTKEY_MAX_KEYS];
+    UINTN KeyCount;
+    HOTKEY_PRESS Queue[HOTKEY_QUEUE_SIZE];
+    UINTN Head, Count;
+    UINTN Notified;       /* presses taken from the notifications */
+    UINTN Polled;         /* hotkey presses ConIn had first */
+    UINT64 MaxTicks;      /* slowest key-to-action */
+} HOTKEYS;
+
+/*
+ * registers notifications for Keys, dropping anything still queued; FALSE if
+ * the console cannot. Hotkeys starts out zeroed, its statistics are kept.
+ */
+BOOLEAN hotkeyStart(HOTKEYS *Hotkeys, EFI_INPUT_KEY *Keys, UINTN Count);
+VOID hotkeyStop(HOTKEYS *Hotkeys);
+/*
+ * the next key, queued presses first; Tsc is when it was pressed (or read,
+ * for keys that were not notified). The time from there to the return is
+ * tallied as PERF_KEY_TO_ACTION.
+ */
+EFI_STATUS hotkeyReadKey(HOTKEYS *Hotkeys, EFI_INPUT_KEY *Key, UINT64 *Tsc);
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * grml-plus UEFI tools - LZ4 frame decoder for compressed images
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "lz4.h"
+
+#define LZ4_MAGIC 0x184D2204
+#define LZ4_SKIPPABLE_MAGIC 0x184D2A50
+#define LZ4_SKIPPABLE_MASK 0xFFFFFFF0
+
+#define FLG_VERSION_MASK 0xC0
+#define FLG_VERSION 0x40
+#define FLG_BLOCK_CHECKSUM 0x10
+#define FLG_CONTENT_SIZE 0x08
+#define FLG_CONTENT_CHECKSUM 0x04
+#define FLG_DICT_ID 0x01
+
+#define BLOCK_UNCOMPRESSED 0x80000000
+#define MIN_MATCH 4
+
+/* for copies in 8 byte steps at any alignment */
+typedef UINT64 __attribute__((may_alias, aligned(1))) UNALIGNED_UINT64;
+
+static UINT32 readLE32(const UINT8 *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((UINT32) p[3] << 24);
+}
+
+BOOLEAN lz4IsCompressed(CHAR16 *FileName) {
+    UINTN len = StrLen(FileName), suffix = StrLen(LZ4_SUFFIX);
+
+    return len > suffix && StriCmp(FileName + len - suffix, LZ4_SUFFIX) == 0;
+}
+
+/* reads a length continued in 255 steps; FALSE if the input ends first */
+static BOOLEAN readLength(const UINT8 **Ip, const UINT8 *End, UINTN *Length) {
+    UINT8 b;
+
+    do {
+        if (*Ip >= End)
+            return FALSE;
+        b = *(*Ip)++;
+        *Length += b;
+    } while (b == 255);
+    return TRUE;
+}
+
+/*
+ * Decodes one compressed block appended at Output + Start. Copies run in
+ * 8 byte steps where the input and output have room for the overshoot.
+ */
+static EFI_STATUS decodeBlock(const UINT8 *Input, UINTN Size, UINT8 *Output, UINTN Start, UINTN OutputSize, UINTN *End) {
+    const UINT8 *ip = Input, *iend = Input + Size, *match;
+    UINT8 *op = Output + Start, *oend = Output + OutputSize, *copyEnd;
+    UINTN length, offset;
+    UINT8 token;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        length = token >> 4;
+        if (length == 15 && !readLength(&ip, iend, &length))
+            return EFI_LOAD_ERROR;
+        if (length > (UINTN) (iend - ip))
+            return EFI_LOAD_ERROR;
+        if (length > (UINTN) (oend - op))
+            return EFI_BUFFER_TOO_SMALL;
+        copyEnd = op + length;
+        if (length + 8 <= (UINTN) (iend - ip) && length + 8 <= (UINTN) (oend - op)) {
+            for (; op < copyEnd; op += 8, ip += 8)
+                *(UNALIGNED_UINT64 *) op = *(const UNALIGNED_UINT64 *) ip;
+            ip -= op - copyEnd;
+        } else {
+            while (op < copyEnd)
+                *op++ = *ip++;
+        }
+        op = copyEnd;
+
+        /* the last sequence of a block has literals only */
+        if (ip == iend)
+            break;
+        if (iend - ip < 2)
+            return EFI_LOAD_ERROR;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (UINTN) (op - Output))
+            return EFI_LOAD_ERROR;
+
+        length = token & 15;
+        if (length == 15 && !readLength(&ip, iend, &length))
+            return EFI_LOAD_ERROR;
+        length += MIN_MATCH;
+        if (length > (UINTN) (oend - op))
+            return EFI_BUFFER_TOO_SMALL;
+        match = op - offset;
+        copyEnd = op + length;
+        /* with offset >= 8 every 8 byte read lies in output that is already written */
+        if (offset >= 8 && length + 8 <= (UINTN) (oend - op)) {
+            for (; op < copyEnd; op += 8, match += 8)
+                *(UNALIGNED_UINT64 *) op = *(const UNALIGNED_UINT64 *) match;
+        } else {
+            while (op < copyEnd)
+                *op++ = *match++;
+        }
+        op = copyEnd;
+    }
+    *End = op - Output;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS readHeader(LZ4_FRAME *Frame, const UINT8 *Input, UINTN Available) {
+    UINTN pos = Frame->InputOffset, size;
+    UINT8 bd;
+
+    /* skippable frames may precede the image */
+    while (Available - pos >= 8 && (readLE32(Input + pos) & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+        size = readLE32(Input + pos + 4);
+        if (Available - pos - 8 < size)
+            return EFI_NOT_READY;
+        pos += 8 + size;
+        Frame->InputOffset = pos;
+    }
+    if (Available - pos < 7)
+        return EFI_NOT_READY;
+    if (readLE32(Input + pos) != LZ4_MAGIC)
+        return EFI_LOAD_ERROR;
+    Frame->Flags = Input[pos + 4];
+    bd = Input[pos + 5];
+    if ((Frame->Flags & FLG_VERSION_MASK) != FLG_VERSION || (Frame->Flags & FLG_DICT_ID) != 0 ||
+            ((bd >> 4) & 7) < 4)
+        return EFI_LOAD_ERROR;
+    Frame->BlockMaxSize = 1 << (8 + 2 * ((bd >> 4) & 7));
+    pos += 6;
+    if (Frame->Flags & FLG_CONTENT_SIZE) {
+        if (Available - pos < 9)
+            return EFI_NOT_READY;
+        Frame->ContentSize = readLE32(Input + pos) | ((UINT64) readLE32(Input + pos + 4) << 32);
+        pos += 8;
+    }
+    /* header checksum byte */
+    Frame->InputOffset = pos + 1;
+    Frame->HeaderDone = TRUE;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS lz4Decode(LZ4_FRAME *Frame, const UINT8 *Input, UINTN Available, UINT8 *Output, UINTN OutputSize) {
+    UINTN pos, size, end, trailer;
+    EFI_STATUS status;
+    UINT32 header;
+
+    if (Frame->Done)
+        return EFI_SUCCESS;
+    if (!Frame->HeaderDone) {
+        status = readHeader(Frame, Input, Available);
+        if (status != EFI_SUCCESS)
+            return status;
+    }
+    trailer = (Frame->Flags & FLG_BLOCK_CHECKSUM) ? 4 : 0;
+
+    for (;;) {
+        pos = Frame->InputOffset;
+        if (Available - pos < 4)
+            return EFI_NOT_READY;
+        header = readLE32(Input + pos);
+        if (header == 0) {
+            if (Frame->Flags & FLG_CONTENT_CHECKSUM) {
+                if (Available - pos < 8)
+                    return EFI_NOT_READY;
+                pos += 4;
+            }
+            Frame->InputOffset = pos + 4;
+            if (Frame->ContentSize != 0 && Frame->ContentSize != Frame->OutputOffset)
+                return EFI_LOAD_ERROR;
+            Frame->Done = TRUE;
+            return EFI_SUCCESS;
+        }
+        size = header & ~BLOCK_UNCOMPRESSED;
+        if (size > Frame->BlockMaxSize)
+            return EFI_LOAD_ERROR;
+        if (Available - pos - 4 < size + trailer)
+            return EFI_NOT_READY;
+        if (header & BLOCK_UNCOMPRESSED) {
+            if (size > OutputSize - Frame->OutputOffset)
+                return EFI_BUFFER_TOO_SMALL;
+            CopyMem(Output + Frame->OutputOffset, (VOID *) (Input + pos + 4), size);
+            end = Frame->OutputOffset + size;
+        } else {
+            status = decodeBlock(Input + pos + 4, size, Output, Frame->OutputOffset, OutputSize, &end);
+            if (status != EFI_SUCCESS)
+                return status;
+        }
+        Frame->OutputOffset = end;
+        Frame->InputOffset = pos + 4 + size + trailer;
+    }
+}
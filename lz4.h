@@ -0,0 +1,67 @@
+/*
+ * grml-plus UEFI tools - LZ4 frame decoder for compressed images
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+/*
+ * Decodes images compressed with "lz4" (LZ4 frame format) while their
+ * compressed data is still arriving: every call decodes the blocks that are
+ * complete in the input read so far and keeps its position in LZ4_FRAME.
+ * Linked blocks are supported since the whole output stays in memory.
+ * Dictionaries are not; block and content checksums are skipped, as the
+ * image is validated again by LoadImage.
+ */
+
+#define LZ4_SUFFIX L".lz4"
+
+typedef struct {
+    UINTN InputOffset;      /* start of the next block in the input */
+    UINTN OutputOffset;     /* bytes decoded so far */
+    UINT64 ContentSize;     /* from the frame header, 0 if not recorded */
+    UINTN BlockMaxSize;
+    UINT8 Flags;
+    BOOLEAN HeaderDone;
+    BOOLEAN Done;
+} LZ4_FRAME;
+
+/* TRUE if FileName ends in LZ4_SUFFIX */
+BOOLEAN lz4IsCompressed(CHAR16 *FileName);
+/*
+ * Input holds the first Available bytes of the compressed file. Returns
+ * EFI_SUCCESS once the frame is complete, EFI_NOT_READY if more input is
+ * needed, EFI_BUFFER_TOO_SMALL if the next block does not fit into Output
+ * (retry with a larger buffer holding the first OutputOffset bytes), and
+ * EFI_LOAD_ERROR for corrupt or unsupported data.
+ */
+EFI_STATUS lz4Decode(LZ4_FRAME *Frame, const UINT8 *Input, UINTN Available, UINT8 *Output, UINTN OutputSize);
+
+#endif
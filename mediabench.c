@@ -0,0 +1,219 @@
+/*
+ * grml-plus UEFI tools - boot media read throughput benchmark
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "common.h"
+#include "mediabench.h"
+#include "prefetch.h"
+
+static UINTN chunkSizes[] = {
+    4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, MEDIABENCH_MAX_CHUNK
+};
+
+#define CHUNK_SIZE_COUNT (sizeof(chunkSizes) / sizeof(chunkSizes[0]))
+
+typedef struct {
+    UINT64 Bytes;
+    UINT64 Calls;
+    UINT64 Ticks;
+    UINT64 MaxTicks;
+} BENCH_RESULT;
+
+static VOID printResult(CHAR16 *label, UINTN chunkSize, BENCH_RESULT *result) {
+    UINT64 us = perfMicroseconds(result->Ticks), tenthMBs;
+
+    if (result->Calls == 0 || us == 0) {
+        Print(L"%-14s %5ldK  no data\n", label, chunkSize / 1024);
+        return;
+    }
+    tenthMBs = result->Bytes * 10 / us;
+    Print(L"%-14s %5ldK %6ld.%ld MB/s %8ld us/call (max %ld)\n", label, chunkSize / 1024,
+        tenthMBs / 10, tenthMBs % 10, us / result->Calls, perfMicroseconds(result->MaxTicks));
+}
+
+static VOID timeCall(BENCH_RESULT *result, UINT64 start, UINTN bytes) {
+    UINT64 ticks = perfTimestamp() - start;
+
+    result->Bytes += bytes;
+    result->Calls++;
+    result->Ticks += ticks;
+    if (ticks > result->MaxTicks)
+        result->MaxTicks = ticks;
+}
+
+static VOID benchFile(EFI_FILE_HANDLE root, CHAR16 *fileName, UINT8 *buffer) {
+    EFI_FILE_HANDLE file;
+    BENCH_RESULT result;
+    EFI_STATUS status;
+    UINTN i, size;
+    UINT64 start;
+    CHAR16 *label;
+
+    for (label = fileName + StrLen(fileName); label > fileName && label[-1] != L'\\'; label--) ;
+
+    for (i = 0; i < CHUNK_SIZE_COUNT; i++) {
+        ZeroMem(&result, sizeof(result));
+        status = uefi_call_wrapper(root->Open, 5, root, &file, fileName, EFI_FILE_MODE_READ, 0);
+        if (status != EFI_SUCCESS)
+            return;
+        while (result.Bytes < MEDIABENCH_MAX_BYTES) {
+            size = chunkSizes[i];
+            start = perfTimestamp();
+            status = uefi_call_wrapper(file->Read, 3, file, &size, buffer);
+            if (status != EFI_SUCCESS || size == 0)
+                break;
+            timeCall(&result, start, size);
+        }
+        uefi_call_wrapper(file->Close, 1, file);
+        printResult(label, chunkSizes[i], &result);
+    }
+}
+
+/* reads an image the way the menus do before LoadImage, decompressing it if needed */
+static VOID benchImageLoad(EFI_FILE_HANDLE root, CHAR16 *fileName) {
+    PREFETCH prefetch = { EFI_NOT_STARTED };
+    UINT64 start, us, tenthMBs;
+    UINTN imageSize;
+    CHAR16 *label;
+
+    for (label = fileName + StrLen(fileName); label > fileName && label[-1] != L'\\'; label--) ;
+
+    start = perfTimestamp();
+    if (prefetchStart(&prefetch, root, fileName, 0) != EFI_SUCCESS || prefetchFinish(&prefetch) != EFI_SUCCESS) {
+        Print(L"%-18s load failed: %r\n", label, prefetch.Status);
+        prefetchFree(&prefetch);
+        return;
+    }
+    us = perfMicroseconds(perfTimestamp() - start);
+    imageSize = prefetch.Compressed ? prefetch.Frame.OutputOffset : prefetch.Size;
+    tenthMBs = us ? imageSize * 10 / us : 0;
+    Print(L"%-18s %6ldK -> %6ldK %6ld ms (decode %ld ms) %6ld.%ld MB/s\n", label, prefetch.Size / 1024,
+        imageSize / 1024, us / 1000, perfMicroseconds(prefetch.DecodeTicks) / 1000, tenthMBs / 10, tenthMBs % 10);
+    prefetchFree(&prefetch);
+}
+
+/* compares an image with its compressed or uncompressed counterpart, if there is one */
+static VOID benchImageVariants(EFI_FILE_HANDLE root, CHAR16 *fileName) {
+    CHAR16 *other;
+
+    benchImageLoad(root, fileName);
+    other = StrDuplicate(fileName);
+    if (other == NULL)
+        return;
+    if (lz4IsCompressed(other)) {
+        other[StrLen(other) - StrLen(LZ4_SUFFIX)] = L'\0';
+    } else {
+        FreePool(other);
+        other = PoolPrint(L"%s%s", fileName, LZ4_SUFFIX);
+    }
+    if (other && fileExists(root, other))
+        benchImageLoad(root, other);
+    if (other)
+        FreePool(other);
+}
+
+static VOID benchBlockIo(EFI_HANDLE DeviceHandle, UINT8 *buffer) {
+    EFI_GUID blockIoProtocol = BLOCK_IO_PROTOCOL;
+    EFI_BLOCK_IO *blockIo;
+    BENCH_RESULT result;
+    EFI_STATUS status;
+    EFI_LBA lba, lastBlock;
+    UINTN i, size;
+    UINT64 start;
+
+    status = uefi_call_wrapper(BS->HandleProtocol, 3, DeviceHandle, &blockIoProtocol, (VOID **) &blockIo);
+    if (status != EFI_SUCCESS || !blockIo->Media->MediaPresent || blockIo->Media->BlockSize == 0) {
+        Print(L"No block device behind the boot volume.\n");
+        return;
+    }
+    lastBlock = blockIo->Media->LastBlock;
+    Print(L"Block device: %ld blocks of %d bytes\n", lastBlock + 1, blockIo->Media->BlockSize);
+
+    for (i = 0; i < CHUNK_SIZE_COUNT; i++) {
+        ZeroMem(&result, sizeof(result));
+        if (chunkSizes[i] < blockIo->Media->BlockSize)
+            continue;
+        /* use a different region for every chunk size so device caches do not help */
+        lba = (i * (UINT64) MEDIABENCH_MAX_BYTES) / blockIo->Media->BlockSize;
+        if (lba + MEDIABENCH_MAX_BYTES / blockIo->Media->BlockSize > lastBlock + 1)
+            lba = 0;
+        while (result.Bytes < MEDIABENCH_MAX_BYTES && lba <= lastBlock) {
+            size = chunkSizes[i];
+            if (size / blockIo->Media->BlockSize > lastBlock + 1 - lba)
+                size = (lastBlock + 1 - lba) * blockIo->Media->BlockSize;
+            start = perfTimestamp();
+            status = uefi_call_wrapper(blockIo->ReadBlocks, 5, blockIo, blockIo->Media->MediaId, lba, size, buffer);
+            if (status != EFI_SUCCESS)
+                break;
+            timeCall(&result, start, size);
+            lba += size / blockIo->Media->BlockSize;
+        }
+        printResult(L"BlockIo", chunkSizes[i], &result);
+    }
+}
+
+VOID mediaBenchmark(EFI_HANDLE DeviceHandle, CHAR16 **FileNames, UINTN FileCount) {
+    EFI_PHYSICAL_ADDRESS buffer;
+    EFI_INPUT_KEY key;
+    EFI_FILE_HANDLE root;
+    UINTN i;
+
+    uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_WHITE);
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    Print(L"Boot media benchmark (TSC %ld MHz, up to %d MB per run)\n\n", perfFrequency() / 1000000, MEDIABENCH_MAX_BYTES >> 20);
+
+    if (uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, EFI_SIZE_TO_PAGES(MEDIABENCH_MAX_CHUNK), &buffer) != EFI_SUCCESS) {
+        Print(L"Cannot allocate read buffer.\n");
+        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+        return;
+    }
+
+    root = LibOpenRoot(DeviceHandle);
+    if (root) {
+        for (i = 0; i < FileCount; i++)
+            benchFile(root, FileNames[i], (UINT8 *) (UINTN) buffer);
+        Print(L"\nImage load (read + decompress):\n");
+        for (i = 0; i < FileCount; i++)
+            benchImageVariants(root, FileNames[i]);
+        uefi_call_wrapper(root->Close, 1, root);
+    }
+    Print(L"\n");
+    benchBlockIo(DeviceHandle, (UINT8 *) (UINTN) buffer);
+
+    uefi_call_wrapper(BS->FreePages, 2, buffer, EFI_SIZE_TO_PAGES(MEDIABENCH_MAX_CHUNK));
+    Print(L"\nPress any key to return to the menu.\n");
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+}
@@ -0,0 +1,340 @@
+/*
+ * grml-plus UEFI tools - memory map analysis
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "acpi.h"
+#include "bootperf.h"
+#include "memmap.h"
+
+static CHAR16 *typeNames[] = {
+    L"Reserved", L"LoaderCode", L"LoaderData", L"BSCode", L"BSData", L"RTCode", L"RTData",
+    L"Conventional", L"Unusable", L"ACPIReclaim", L"ACPINVS", L"MMIO", L"MMIOPort", L"PalCode",
+    L"Persistent"
+};
+
+/* the architectural bits, so that firmware newer than our headers is decoded too */
+static struct {
+    UINT64 Bit;
+    CHAR16 *Name;
+} attributeNames[] = {
+    { 0x0000000000000001ULL, L"UC" }, { 0x0000000000000002ULL, L"WC" }, { 0x0000000000000004ULL, L"WT" },
+    { 0x0000000000000008ULL, L"WB" }, { 0x0000000000000010ULL, L"UCE" }, { 0x0000000000001000ULL, L"WP" },
+    { 0x0000000000002000ULL, L"RP" }, { 0x0000000000004000ULL, L"XP" }, { 0x0000000000008000ULL, L"NV" },
+    { 0x0000000000010000ULL, L"MR" }, { 0x0000000000020000ULL, L"RO" }, { 0x0000000000040000ULL, L"SP" },
+    { 0x0000000000080000ULL, L"CC" }, { 0x8000000000000000ULL, L"RT" }
+};
+
+static VOID siftDown(MEMMAP_RANGE *Ranges, UINTN Root, UINTN Count) {
+    MEMMAP_RANGE swap;
+    UINTN child;
+
+    while ((child = 2 * Root + 1) < Count) {
+        if (child + 1 < Count && Ranges[child + 1].Start > Ranges[child].Start)
+            child++;
+        if (Ranges[Root].Start >= Ranges[child].Start)
+            return;
+        swap = Ranges[Root];
+        Ranges[Root] = Ranges[child];
+        Ranges[child] = swap;
+        Root = child;
+    }
+}
+
+VOID memMapSort(MEMMAP_RANGE *Ranges, UINTN Count) {
+    MEMMAP_RANGE swap;
+    UINTN i;
+
+    for (i = Count / 2; i > 0; i--)
+        siftDown(Ranges, i - 1, Count);
+    for (i = Count; i > 1; i--) {
+        swap = Ranges[0];
+        Ranges[0] = Ranges[i - 1];
+        Ranges[i - 1] = swap;
+        siftDown(Ranges, 0, i - 1);
+    }
+}
+
+CHAR16 *memMapTypeName(UINTN Type) {
+    if (Type < sizeof(typeNames) / sizeof(typeNames[0]))
+        return typeNames[Type];
+    return Type < EfiMaxMemoryType ? L"?" : L"OEM/OS";
+}
+
+static UINTN typeBin(UINT32 Type) {
+    return Type < EfiMaxMemoryType ? Type : EfiMaxMemoryType;
+}
+
+static UINTN attributeBin(MEMMAP_ANALYSIS *Analysis, UINT64 Attribute) {
+    UINTN i;
+
+    for (i = 0; i < Analysis->AttributeCount; i++) {
+        if (Analysis->AttributeValues[i] == Attribute)
+            return i;
+    }
+    if (Analysis->AttributeCount == MEMMAP_MAX_ATTRIBUTES)
+        return MEMMAP_MAX_ATTRIBUTES - 1;
+    Analysis->AttributeValues[Analysis->AttributeCount] = Attribute;
+    return Analysis->AttributeCount++;
+}
+
+static VOID addRun(MEMMAP_BIN *Bin, UINT64 Pages) {
+    Bin->Runs++;
+    if (Pages > Bin->LargestRun)
+        Bin->LargestRun = Pages;
+}
+
+/* reads the map into Ranges (from the pool) and counts the descriptors */
+static EFI_STATUS readMemoryMap(MEMMAP_ANALYSIS *Analysis, MEMMAP_RANGE **Ranges) {
+    UINTN count, mapKey, descriptorSize, i;
+    UINT32 descriptorVersion;
+    EFI_MEMORY_DESCRIPTOR *map, *desc;
+
+    map = LibMemoryMap(&count, &mapKey, &descriptorSize, &descriptorVersion);
+    if (map == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    *Ranges = AllocatePool(count * sizeof(MEMMAP_RANGE));
+    if (*Ranges == NULL) {
+        FreePool(map);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    for (i = 0, desc = map; i < count; i++, desc = NextMemoryDescriptor(desc, descriptorSize)) {
+        (*Ranges)[i].Start = desc->PhysicalStart;
+        (*Ranges)[i].Pages = desc->NumberOfPages;
+        (*Ranges)[i].Attribute = desc->Attribute;
+        (*Ranges)[i].Type = desc->Type;
+        (*Ranges)[i].Reserved = 0;
+        Analysis->Types[typeBin(desc->Type)].Descriptors++;
+        Analysis->Attributes[attributeBin(Analysis, desc->Attribute)].Descriptors++;
+    }
+    Analysis->DescriptorCount = count;
+    FreePool(map);
+    return EFI_SUCCESS;
+}
+
+/* merges neighbours of the same type and attribute in the sorted Ranges, returns the new count */
+static UINTN coalesce(MEMMAP_RANGE *Ranges, UINTN Count) {
+    UINTN i, runs = 0;
+
+    for (i = 0; i < Count; i++) {
+        if (runs > 0 && Ranges[runs - 1].Type == Ranges[i].Type && Ranges[runs - 1].Attribute == Ranges[i].Attribute
+                && Ranges[runs - 1].Start + (Ranges[runs - 1].Pages << EFI_PAGE_SHIFT) == Ranges[i].Start) {
+            Ranges[runs - 1].Pages += Ranges[i].Pages;
+        } else {
+            Ranges[runs++] = Ranges[i];
+        }
+    }
+    return runs;
+}
+
+/* the enabled memory ranges of the SRAT, sorted, with the node bin in Type */
+static UINTN readSrat(MEMMAP_ANALYSIS *Analysis, MEMMAP_RANGE **Ranges) {
+    ACPI_SRAT *srat = (ACPI_SRAT *) acpiFindTable(ACPI_SRAT_SIGNATURE);
+    SRAT_STRUCTURE_HEADER *entry;
+    SRAT_MEMORY_AFFINITY *memory;
+    UINTN offset, count = 0, node;
+
+    *Ranges = NULL;
+    if (srat == NULL || srat->Header.Length < sizeof(ACPI_SRAT))
+        return 0;
+    for (offset = sizeof(ACPI_SRAT); offset + sizeof(SRAT_STRUCTURE_HEADER) <= srat->Header.Length; offset += entry->Length) {
+        entry = (SRAT_STRUCTURE_HEADER *) ((UINT8 *) srat + offset);
+        if (entry->Length < sizeof(SRAT_STRUCTURE_HEADER))
+            break;
+        if (entry->Type == SRAT_MEMORY_AFFINITY_TYPE && entry->Length >= sizeof(SRAT_MEMORY_AFFINITY))
+            count++;
+    }
+    if (count == 0 || (*Ranges = AllocatePool(count * sizeof(MEMMAP_RANGE))) == NULL)
+        return 0;
+
+    count = 0;
+    for (offset = sizeof(ACPI_SRAT); offset + sizeof(SRAT_STRUCTURE_HEADER) <= srat->Header.Length; offset += entry->Length) {
+        entry = (SRAT_STRUCTURE_HEADER *) ((UINT8 *) srat + offset);
+        if (entry->Length < sizeof(SRAT_STRUCTURE_HEADER))
+            break;
+        if (entry->Type != SRAT_MEMORY_AFFINITY_TYPE || entry->Length < sizeof(SRAT_MEMORY_AFFINITY))
+            continue;
+        memory = (SRAT_MEMORY_AFFINITY *) entry;
+        if (!(memory->Flags & SRAT_MEMORY_ENABLED) || memory->Length == 0)
+            continue;
+        for (node = 0; node < Analysis->NodeCount && Analysis->NodeDomains[node] != memory->ProximityDomain; node++) ;
+        if (node == Analysis->NodeCount && node < MEMMAP_MAX_NODES)
+            Analysis->NodeDomains[Analysis->NodeCount++] = memory->ProximityDomain;
+        (*Ranges)[count].Start = memory->BaseAddress;
+        (*Ranges)[count].Pages = EFI_SIZE_TO_PAGES(memory->Length);
+        (*Ranges)[count].Attribute = 0;
+        (*Ranges)[count].Type = node;
+        (*Ranges)[count].Reserved = 0;
+        count++;
+    }
+    memMapSort(*Ranges, count);
+    return count;
+}
+
+/* walks the sorted runs and SRAT ranges side by side */
+static VOID countNodes(MEMMAP_ANALYSIS *Analysis, MEMMAP_RANGE *Runs, UINTN RunCount, MEMMAP_RANGE *Nodes, UINTN NodeCount) {
+    UINTN i, first = 0, j, type;
+    UINT64 pos, end, nodeEnd;
+
+    for (i = 0; i < RunCount; i++) {
+        type = typeBin(Runs[i].Type);
+        pos = Runs[i].Start;
+        end = pos + (Runs[i].Pages << EFI_PAGE_SHIFT);
+        while (first < NodeCount && Nodes[first].Start + (Nodes[first].Pages << EFI_PAGE_SHIFT) <= pos)
+            first++;
+        for (j = first; pos < end; j++) {
+            if (j == NodeCount || Nodes[j].Start >= end) {
+                Analysis->NodePages[MEMMAP_MAX_NODES][type] += EFI_SIZE_TO_PAGES(end - pos);
+                break;
+            }
+            if (Nodes[j].Start > pos) {
+                Analysis->NodePages[MEMMAP_MAX_NODES][type] += EFI_SIZE_TO_PAGES(Nodes[j].Start - pos);
+                pos = Nodes[j].Start;
+            }
+            nodeEnd = Nodes[j].Start + (Nodes[j].Pages << EFI_PAGE_SHIFT);
+            if (nodeEnd <= pos)
+                continue;
+            nodeEnd = nodeEnd < end ? nodeEnd : end;
+            Analysis->NodePages[Nodes[j].Type][type] += EFI_SIZE_TO_PAGES(nodeEnd - pos);
+            pos = nodeEnd;
+        }
+    }
+}
+
+EFI_STATUS memMapAnalyze(MEMMAP_ANALYSIS *Analysis) {
+    MEMMAP_RANGE *runs, *nodes;
+    UINTN i, nodeCount;
+    EFI_STATUS status;
+    UINT64 start;
+
+    ZeroMem(Analysis, sizeof(*Analysis));
+    start = perfTimestamp();
+    status = readMemoryMap(Analysis, &runs);
+    Analysis->ReadTicks = perfTimestamp() - start;
+    if (status != EFI_SUCCESS)
+        return status;
+
+    start = perfTimestamp();
+    memMapSort(runs, Analysis->DescriptorCount);
+    Analysis->SortTicks = perfTimestamp() - start;
+
+    start = perfTimestamp();
+    Analysis->RunCount = coalesce(runs, Analysis->DescriptorCount);
+    for (i = 0; i < Analysis->RunCount; i++) {
+        Analysis->Types[typeBin(runs[i].Type)].Pages += runs[i].Pages;
+        addRun(&Analysis->Types[typeBin(runs[i].Type)], runs[i].Pages);
+        Analysis->Attributes[attributeBin(Analysis, runs[i].Attribute)].Pages += runs[i].Pages;
+        addRun(&Analysis->Attributes[attributeBin(Analysis, runs[i].Attribute)], runs[i].Pages);
+    }
+    Analysis->CoalesceTicks = perfTimestamp() - start;
+
+    start = perfTimestamp();
+    nodeCount = readSrat(Analysis, &nodes);
+    countNodes(Analysis, runs, Analysis->RunCount, nodes, nodeCount);
+    if (nodes)
+        FreePool(nodes);
+    Analysis->NodeTicks = perfTimestamp() - start;
+
+    FreePool(runs);
+    return EFI_SUCCESS;
+}
+
+static VOID attributeText(UINT64 Attribute, CHAR16 *Text, UINTN Size) {
+    UINTN i, length = 0, nameLength;
+
+    Text[0] = 0;
+    for (i = 0; i < sizeof(attributeNames) / sizeof(attributeNames[0]); i++) {
+        if (!(Attribute & attributeNames[i].Bit))
+            continue;
+        nameLength = StrLen(attributeNames[i].Name);
+        if ((length + nameLength + 2) * sizeof(CHAR16) > Size)
+            break;
+        if (length > 0)
+            Text[length++] = L' ';
+        StrCpy(Text + length, attributeNames[i].Name);
+        length += nameLength;
+    }
+}
+
+/* memory sizes of the node table, in MB */
+static UINT64 megabytes(UINT64 Pages) {
+    return Pages >> (20 - EFI_PAGE_SHIFT);
+}
+
+VOID memMapReport(MEMMAP_ANALYSIS *Analysis, TEXT_LINES *Lines) {
+    CHAR16 attributes[48], node[12];
+    UINT64 *pages, total;
+    UINTN i, t;
+
+    textLinesAdd(Lines, PoolPrint(L"Memory map: %d descriptors, %d runs after sorting and coalescing",
+        Analysis->DescriptorCount, Analysis->RunCount));
+    textLinesAdd(Lines, PoolPrint(L"Took %ld us to read, %ld us to sort, %ld us to coalesce, %ld us for NUMA",
+        perfMicroseconds(Analysis->ReadTicks), perfMicroseconds(Analysis->SortTicks),
+        perfMicroseconds(Analysis->CoalesceTicks), perfMicroseconds(Analysis->NodeTicks)));
+
+    textLinesAdd(Lines, StrDuplicate(L""));
+    textLinesAdd(Lines, PoolPrint(L"%-16s %-22s %-10s %6s %5s", L"Attribute", L"", L"Pages", L"Descr", L"Runs"));
+    for (i = 0; i < Analysis->AttributeCount; i++) {
+        attributeText(Analysis->AttributeValues[i], attributes, sizeof(attributes));
+        textLinesAdd(Lines, PoolPrint(L"%016lx %-22s %010lx %6d %5d%s", Analysis->AttributeValues[i], attributes,
+            Analysis->Attributes[i].Pages, Analysis->Attributes[i].Descriptors, Analysis->Attributes[i].Runs,
+            i == MEMMAP_MAX_ATTRIBUTES - 1 ? L" and others" : L""));
+    }
+
+    textLinesAdd(Lines, StrDuplicate(L""));
+    if (Analysis->NodeCount == 0) {
+        textLinesAdd(Lines, StrDuplicate(L"No ACPI SRAT, no NUMA breakdown"));
+        return;
+    }
+    textLinesAdd(Lines, PoolPrint(L"%-10s %9s %9s %9s %9s %9s %9s", L"Node (MB)", L"Total", L"Free", L"BootSvc",
+        L"Loader", L"Runtime", L"Other"));
+    for (i = 0; i <= MEMMAP_MAX_NODES; i++) {
+        if (i >= Analysis->NodeCount && i < MEMMAP_MAX_NODES)
+            continue;
+        pages = Analysis->NodePages[i];
+        for (t = 0, total = 0; t < MEMMAP_TYPE_BINS; t++)
+            total += pages[t];
+        if (i == MEMMAP_MAX_NODES && total == 0)
+            continue;
+        if (i < MEMMAP_MAX_NODES)
+            SPrint(node, sizeof(node), L"%d", Analysis->NodeDomains[i]);
+        else
+            StrCpy(node, L"other");
+        textLinesAdd(Lines, PoolPrint(L"%-10s %9ld %9ld %9ld %9ld %9ld %9ld", node,
+            megabytes(total), megabytes(pages[EfiConventionalMemory]),
+            megabytes(pages[EfiBootServicesCode] + pages[EfiBootServicesData]),
+            megabytes(pages[EfiLoaderCode] + pages[EfiLoaderData]),
+            megabytes(pages[EfiRuntimeServicesCode] + pages[EfiRuntimeServicesData]),
+            megabytes(total - pages[EfiConventionalMemory] - pages[EfiBootServicesCode] - pages[EfiBootServicesData]
+                - pages[EfiLoaderCode] - pages[EfiLoaderData] - pages[EfiRuntimeServicesCode] - pages[EfiRuntimeServicesData])));
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * grml-plus UEFI tools - memory map analysis
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MEMMAP_H
+#define MEMMAP_H
+
+#include "common.h"
+
+/*
+ * Breaks the memory map down by type, attribute and NUMA node. On big
+ * machines the map has thousands of descriptors, so they are sorted by
+ * address (heap sort, O(n log n) without recursion) and adjacent ones of the
+ * same type and attribute are coalesced into runs before anything else is
+ * done with them. The nodes come from the memory affinity structures of the
+ * ACPI SRAT; memory that no enabled SRAT range covers, or that belongs to a
+ * node beyond MEMMAP_MAX_NODES, is counted in the last node bin.
+ */
+
+#define MEMMAP_MAX_NODES 16
+#define MEMMAP_MAX_ATTRIBUTES 16
+/* the last type bin collects OEM and OS types */
+#define MEMMAP_TYPE_BINS (EfiMaxMemoryType + 1)
+
+typedef struct {
+    UINT64 Start;
+    UINT64 Pages;
+    UINT64 Attribute;
+    UINT32 Type;          /* node index for SRAT ranges */
+    UINT32 Reserved;
+} MEMMAP_RANGE;
+
+typedef struct {
+    UINT64 Pages;
+    UINTN Descriptors;    /* as reported by the firmware */
+    UINTN Runs;           /* after coalescing */
+    UINT64 LargestRun;    /* pages */
+} MEMMAP_BIN;
+
+typedef struct {
+    UINTN DescriptorCount;
+    UINTN RunCount;
+    MEMMAP_BIN Types[MEMMAP_TYPE_BINS];
+    /* the last attribute bin collects the values that did not get one */
+    UINT64 AttributeValues[MEMMAP_MAX_ATTRIBUTES];
+    MEMMAP_BIN Attributes[MEMMAP_MAX_ATTRIBUTES];
+    UINTN AttributeCount;
+    UINT32 NodeDomains[MEMMAP_MAX_NODES];
+    UINTN NodeCount;      /* 0 without an SRAT */
+    UINT64 NodePages[MEMMAP_MAX_NODES + 1][MEMMAP_TYPE_BINS];
+    UINT64 ReadTicks, SortTicks, CoalesceTicks, NodeTicks;
+} MEMMAP_ANALYSIS;
+
+/* sorts Ranges by start address */
+VOID memMapSort(MEMMAP_RANGE *Ranges, UINTN Count);
+EFI_STATUS memMapAnalyze(MEMMAP_ANALYSIS *Analysis);
+CHAR16 *memMapTypeName(UINTN Type);
+/* adds the summary, timing, attribute and node tables */
+VOID memMapReport(MEMMAP_ANALYSIS *Analysis, TEXT_LINES *Lines);
+
+#endif
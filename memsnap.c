@@ -0,0 +1,207 @@
+/*
+ * grml-plus UEFI tools - memory map snapshots around started images
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "memsnap.h"
+
+static EFI_GUID memoryTypeInformationGUID = { 0x4c19049f,0x4137,0x4dd3, { 0x9c,0x10,0x8b,0x97,0xa8,0x3f,0xfd,0xfa } };
+
+static UINTN snapshotSize(UINTN Descriptors, UINTN TypeInfos) {
+    return sizeof(MEMSNAP_HEADER) + Descriptors * sizeof(MEMSNAP_DESCRIPTOR)
+        + 2 * TypeInfos * sizeof(MEMSNAP_TYPE_INFO);
+}
+
+/* returns the number of pairs variable Name holds now */
+static UINTN probeTypeInfo(CHAR16 *Name) {
+    UINTN size = 0, dummy;
+
+    if (uefi_call_wrapper(RT->GetVariable, 5, Name, &memoryTypeInformationGUID, NULL, &size, &dummy) != EFI_BUFFER_TOO_SMALL)
+        return 0;
+    return (size + sizeof(MEMSNAP_TYPE_INFO) - 1) / sizeof(MEMSNAP_TYPE_INFO);
+}
+
+/*
+ * appends the pairs of variable Name, none if it is missing or has grown
+ * beyond the room probed in memSnapBegin, which sets Truncated in its Flags
+ */
+static UINT32 readTypeInfo(MEMSNAP *Snap, CHAR16 *Name, MEMSNAP_HEADER *Header, UINT32 Truncated) {
+    UINTN size = Snap->TypeInfos * sizeof(MEMSNAP_TYPE_INFO);
+    EFI_STATUS status;
+
+    status = uefi_call_wrapper(RT->GetVariable, 5, Name, &memoryTypeInformationGUID, NULL, &size,
+        Snap->Buffer + Snap->Size);
+    if (status == EFI_BUFFER_TOO_SMALL)
+        Header->Flags |= Truncated;
+    if (status != EFI_SUCCESS)
+        return 0;
+    size /= sizeof(MEMSNAP_TYPE_INFO);
+    Snap->Size += size * sizeof(MEMSNAP_TYPE_INFO);
+    return size;
+}
+
+/* no allocations in here, the map goes to the scratch area */
+static EFI_STATUS takeSnapshot(MEMSNAP *Snap) {
+    MEMSNAP_HEADER *header = (MEMSNAP_HEADER *) (Snap->Buffer + Snap->Size);
+    MEMSNAP_DESCRIPTOR *out = (MEMSNAP_DESCRIPTOR *) (header + 1);
+    EFI_MEMORY_DESCRIPTOR *desc = (EFI_MEMORY_DESCRIPTOR *) Snap->Scratch;
+    UINTN mapSize = Snap->ScratchSize, mapKey, descriptorSize, count, i;
+    UINT32 descriptorVersion;
+    EFI_STATUS status;
+
+    header->Tsc = perfTimestamp();
+    status = uefi_call_wrapper(BS->GetMemoryMap, 5, &mapSize, desc, &mapKey, &descriptorSize, &descriptorVersion);
+    if (status != EFI_SUCCESS)
+        return status;
+    count = mapSize / descriptorSize;
+    if (Snap->Size + snapshotSize(count, Snap->TypeInfos) > Snap->Capacity)
+        return EFI_BUFFER_TOO_SMALL;
+    for (i = 0; i < count; i++, desc = NextMemoryDescriptor(desc, descriptorSize)) {
+        out[i].Type = desc->Type;
+        out[i].Reserved = 0;
+        out[i].PhysicalStart = desc->PhysicalStart;
+        out[i].NumberOfPages = desc->NumberOfPages;
+        out[i].Attribute = desc->Attribute;
+    }
+    header->DescriptorCount = count;
+    header->Flags = 0;
+    Snap->Size += sizeof(MEMSNAP_HEADER) + count * sizeof(MEMSNAP_DESCRIPTOR);
+    header->InfoCount = readTypeInfo(Snap, L"MemoryTypeInformation", header, MEMSNAP_INFO_TRUNCATED);
+    header->BackupCount = readTypeInfo(Snap, L"MemoryTypeInformationBackup", header, MEMSNAP_BACKUP_TRUNCATED);
+    return EFI_SUCCESS;
+}
+
+static VOID freeBuffer(MEMSNAP *Snap) {
+    if (Snap->Buffer)
+        FreePool(Snap->Buffer);
+    Snap->Buffer = Snap->Scratch = NULL;
+    Snap->Size = Snap->Capacity = Snap->ScratchSize = Snap->TypeInfos = 0;
+}
+
+EFI_STATUS memSnapBegin(MEMSNAP *Snap, CHAR16 *ImageName) {
+    UINTN mapSize = 0, mapKey, descriptorSize, slots, infos, i;
+    UINT32 descriptorVersion;
+    MEMSNAP_LAUNCH *launch;
+    EFI_STATUS status;
+
+    freeBuffer(Snap);
+    status = uefi_call_wrapper(BS->GetMemoryMap, 5, &mapSize, NULL, &mapKey, &descriptorSize, &descriptorVersion);
+    if (status != EFI_BUFFER_TOO_SMALL)
+        return status == EFI_SUCCESS ? EFI_DEVICE_ERROR : status;
+    slots = mapSize / descriptorSize + MEMSNAP_SPARE_DESCRIPTORS;
+    /* the variables are read at whatever size the firmware stored them */
+    Snap->TypeInfos = MEMSNAP_MIN_TYPE_INFOS;
+    for (i = 0; i < 2; i++) {
+        infos = probeTypeInfo(i ? L"MemoryTypeInformationBackup" : L"MemoryTypeInformation");
+        if (infos > Snap->TypeInfos)
+            Snap->TypeInfos = infos;
+    }
+    Snap->Capacity = sizeof(MEMSNAP_LAUNCH) + 2 * snapshotSize(slots, Snap->TypeInfos);
+    Snap->ScratchSize = slots * descriptorSize;
+    Snap->Buffer = AllocatePool(Snap->Capacity + Snap->ScratchSize);
+    if (Snap->Buffer == NULL) {
+        freeBuffer(Snap);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Snap->Scratch = Snap->Buffer + Snap->Capacity;
+
+    launch = (MEMSNAP_LAUNCH *) Snap->Buffer;
+    ZeroMem(launch, sizeof(MEMSNAP_LAUNCH));
+    launch->Signature = MEMSNAP_SIGNATURE;
+    launch->Version = MEMSNAP_VERSION;
+    launch->HeaderSize = sizeof(MEMSNAP_LAUNCH);
+    launch->Launch = ++Snap->Launches;
+    launch->TscFrequency = perfFrequency();
+    for (i = 0; ImageName[i] != 0 && i < MEMSNAP_NAME_LENGTH - 1; i++)
+        launch->Name[i] = ImageName[i] < 0x80 ? (CHAR8) ImageName[i] : '?';
+    Snap->Size = sizeof(MEMSNAP_LAUNCH);
+
+    status = takeSnapshot(Snap);
+    if (status != EFI_SUCCESS)
+        freeBuffer(Snap);
+    return status;
+}
+
+/* one Write per launch, appended to the file of this run */
+static EFI_STATUS appendRecord(MEMSNAP *Snap, EFI_FILE_HANDLE Root) {
+    EFI_FILE_HANDLE file;
+    EFI_STATUS status;
+    EFI_TIME now;
+    UINTN size = Snap->Size;
+
+    if (Root == NULL)
+        return EFI_NO_MEDIA;
+    if (Snap->FileName == NULL) {
+        if (uefi_call_wrapper(RT->GetTime, 2, &now, NULL) == EFI_SUCCESS)
+            Snap->FileName = PoolPrint(L"\\memsnap-%04d%02d%02d-%02d%02d%02d.bin", now.Year, now.Month, now.Day,
+                now.Hour, now.Minute, now.Second);
+        else
+            Snap->FileName = StrDuplicate(L"\\memsnap.bin");
+        if (Snap->FileName == NULL)
+            return EFI_OUT_OF_RESOURCES;
+    }
+    status = uefi_call_wrapper(Root->Open, 5, Root, &file, Snap->FileName,
+        EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+    if (status != EFI_SUCCESS)
+        return status;
+    status = uefi_call_wrapper(file->SetPosition, 2, file, 0xFFFFFFFFFFFFFFFFULL);
+    if (status == EFI_SUCCESS)
+        status = uefi_call_wrapper(file->Write, 3, file, &size, Snap->Buffer);
+    if (status == EFI_SUCCESS && size != Snap->Size)
+        status = EFI_VOLUME_FULL;
+    uefi_call_wrapper(file->Close, 1, file);
+    return status;
+}
+
+EFI_STATUS memSnapEnd(MEMSNAP *Snap, EFI_STATUS StartStatus, EFI_FILE_HANDLE Root) {
+    MEMSNAP_LAUNCH *launch = (MEMSNAP_LAUNCH *) Snap->Buffer;
+    EFI_STATUS status;
+
+    if (launch == NULL)
+        return EFI_NOT_STARTED;
+    status = takeSnapshot(Snap);
+    if (status == EFI_SUCCESS) {
+        launch->Status = StartStatus;
+        launch->Size = Snap->Size;
+        status = appendRecord(Snap, Root);
+    }
+    freeBuffer(Snap);
+    return status;
+}
+
+VOID memSnapFree(MEMSNAP *Snap) {
+    freeBuffer(Snap);
+    if (Snap->FileName)
+        FreePool(Snap->FileName);
+    Snap->FileName = NULL;
+}
@@ -0,0 +1,117 @@
+/*
+ * grml-plus UEFI tools - memory map snapshots around started images
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MEMSNAP_H
+#define MEMSNAP_H
+
+/*
+ * Takes a compact snapshot of the memory map and of the
+ * MemoryTypeInformation/MemoryTypeInformationBackup variables right before
+ * an image is started and right after it returns, so the image itself is in
+ * both, and appends both to \memsnap-YYYYMMDD-HHMMSS.bin on the boot volume
+ * with a single Write per launch. tools/memsnap-diff decodes and compares
+ * them.
+ *
+ * Layout (little endian, version 1): one record per launch, a MEMSNAP_LAUNCH
+ * followed by two snapshots (before, after), each a MEMSNAP_HEADER followed
+ * by DescriptorCount MEMSNAP_DESCRIPTOR entries, InfoCount and then
+ * BackupCount MEMSNAP_TYPE_INFO entries. Size covers the whole record, so
+ * unknown versions can be skipped. A variable that is too large for the
+ * room reserved for it is recorded with no entries and a Flags bit set.
+ *
+ * Everything is laid out in a buffer that is allocated before the first
+ * snapshot and large enough for both, so that nothing we allocate shows up
+ * as growth of the started image.
+ */
+
+#define MEMSNAP_SIGNATURE 0x534d5247 /* "GRMS" */
+#define MEMSNAP_VERSION 1
+#define MEMSNAP_NAME_LENGTH 64
+/* room for descriptors that appear while the image runs */
+#define MEMSNAP_SPARE_DESCRIPTORS 256
+/* room for at least this many pairs per variable, more if it is larger */
+#define MEMSNAP_MIN_TYPE_INFOS 64
+
+/* MEMSNAP_HEADER.Flags */
+#define MEMSNAP_INFO_TRUNCATED 1
+#define MEMSNAP_BACKUP_TRUNCATED 2
+
+typedef struct {
+    UINT32 Signature;
+    UINT16 Version;
+    UINT16 HeaderSize;
+    UINT32 Size;
+    UINT32 Launch;
+    UINT64 TscFrequency;
+    UINT64 Status;        /* of StartImage */
+    CHAR8 Name[MEMSNAP_NAME_LENGTH];
+} __attribute__((packed)) MEMSNAP_LAUNCH;
+
+typedef struct {
+    UINT64 Tsc;
+    UINT32 DescriptorCount;
+    UINT32 InfoCount;
+    UINT32 BackupCount;
+    UINT32 Flags;
+} __attribute__((packed)) MEMSNAP_HEADER;
+
+typedef struct {
+    UINT32 Type;
+    UINT32 Reserved;
+    UINT64 PhysicalStart;
+    UINT64 NumberOfPages;
+    UINT64 Attribute;
+} __attribute__((packed)) MEMSNAP_DESCRIPTOR;
+
+/* as stored in the MemoryTypeInformation variables */
+typedef struct {
+    UINT32 Type;
+    UINT32 NumberOfPages;
+} __attribute__((packed)) MEMSNAP_TYPE_INFO;
+
+typedef struct {
+    UINT8 *Buffer;
+    UINTN Size;
+    UINTN Capacity;
+    UINT8 *Scratch;       /* for the firmware's memory map, after the record */
+    UINTN ScratchSize;
+    UINTN TypeInfos;      /* room for pairs per variable */
+    UINT32 Launches;
+    CHAR16 *FileName;     /* from the pool, chosen on the first write */
+} MEMSNAP;
+
+/* allocates the buffer and takes the snapshot before the launch of ImageName */
+EFI_STATUS memSnapBegin(MEMSNAP *Snap, CHAR16 *ImageName);
+/* takes the snapshot after it, appends the record to Root and frees the buffer */
+EFI_STATUS memSnapEnd(MEMSNAP *Snap, EFI_STATUS StartStatus, EFI_FILE_HANDLE Root);
+VOID memSnapFree(MEMSNAP *Snap);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * grml-plus UEFI tools - multi-core scaling benchmark
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "mpbench.h"
+#include "sha256.h"
+#include "workpool.h"
+
+#define CHUNK_COUNT (MPBENCH_BYTES / MPBENCH_CHUNK)
+
+typedef struct {
+    WORK_ITEM Work;
+    const UINT8 *Data;
+    UINT8 Digest[32];
+} HASH_CHUNK;
+
+static WORK_POOL pool;
+static HASH_CHUNK chunks[CHUNK_COUNT];
+
+static VOID hashChunk(VOID *Context) {
+    HASH_CHUNK *chunk = Context;
+
+    sha256(chunk->Data, MPBENCH_CHUNK, chunk->Digest);
+}
+
+/* hashes all chunks with the given number of workers besides the BSP */
+static UINT64 timeRun(UINTN Workers, UINT8 (*Digests)[32]) {
+    UINT64 start, ticks;
+    UINTN i;
+
+    workPoolStart(&pool, Workers);
+    start = perfTimestamp();
+    for (i = 0; i < CHUNK_COUNT; i++)
+        workPoolSubmit(&pool, &chunks[i].Work, hashChunk, &chunks[i]);
+    for (i = 0; i < CHUNK_COUNT; i++)
+        workPoolWait(&pool, &chunks[i].Work);
+    ticks = perfTimestamp() - start;
+    workPoolStop(&pool);
+    for (i = 0; i < CHUNK_COUNT; i++)
+        CopyMem(Digests[i], chunks[i].Digest, 32);
+    return ticks;
+}
+
+static VOID runScaling(UINT8 (*Reference)[32], UINT8 (*Digests)[32]) {
+    UINT64 us, single = 0, tenthMBs, tenthSpeedup;
+    UINTN total, cores;
+
+    if (workPoolStart(&pool, WORK_POOL_MAX_WORKERS) != EFI_SUCCESS)
+        Print(L"No MP services or no other processor, everything runs on the BSP.\n\n");
+    total = pool.WorkerCount + 1;
+    workPoolStop(&pool);
+
+    Print(L"cores       MB/s  speedup\n");
+    for (cores = 1; ; cores *= 2) {
+        if (cores > total)
+            cores = total;
+        us = perfMicroseconds(timeRun(cores - 1, cores == 1 ? Reference : Digests));
+        if (cores == 1)
+            single = us;
+        tenthMBs = us ? (UINT64) MPBENCH_BYTES * 10 / us : 0;
+        tenthSpeedup = us ? single * 10 / us : 0;
+        Print(L"%5d %6ld.%ld %6ld.%ldx", cores, tenthMBs / 10, tenthMBs % 10, tenthSpeedup / 10, tenthSpeedup % 10);
+        if (cores != 1 && CompareMem(Reference, Digests, CHUNK_COUNT * 32) != 0)
+            Print(L"  digest mismatch");
+        Print(L"\n");
+        if (cores == total)
+            break;
+    }
+}
+
+VOID mpBenchmark(VOID) {
+    EFI_PHYSICAL_ADDRESS buffer;
+    EFI_INPUT_KEY key;
+    UINT8 (*reference)[32], (*digests)[32];
+    UINTN i;
+
+    uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_WHITE);
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    Print(L"Multi-core benchmark (SHA-256 of %d MB in %d KB chunks, %s)\n\n", MPBENCH_BYTES >> 20,
+        MPBENCH_CHUNK >> 10, sha256HaveShaNi() ? L"SHA-NI" : L"scalar");
+
+    reference = AllocatePool(CHUNK_COUNT * 32);
+    digests = AllocatePool(CHUNK_COUNT * 32);
+    if (reference && digests &&
+            uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, EFI_SIZE_TO_PAGES(MPBENCH_BYTES), &buffer) == EFI_SUCCESS) {
+        for (i = 0; i < MPBENCH_BYTES / sizeof(UINT32); i++)
+            ((UINT32 *) (UINTN) buffer)[i] = (UINT32) (i * 0x9e3779b1);
+        for (i = 0; i < CHUNK_COUNT; i++)
+            chunks[i].Data = (UINT8 *) (UINTN) buffer + i * MPBENCH_CHUNK;
+        runScaling(reference, digests);
+        uefi_call_wrapper(BS->FreePages, 2, buffer, EFI_SIZE_TO_PAGES(MPBENCH_BYTES));
+    } else {
+        Print(L"Cannot allocate the test data.\n");
+    }
+    if (reference)
+        FreePool(reference);
+    if (digests)
+        FreePool(digests);
+
+    Print(L"\nPress any key to return to the menu.\n");
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+}
@@ -0,0 +1,194 @@
+/*
+ * grml-plus UEFI tools - PE/COFF well-formedness check
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "pecoff.h"
+
+#define PE_MAX_SECTIONS 96
+#define PE_DIRECTORY_SECURITY 4
+#define PE_DIRECTORY_BASERELOC 5
+
+#define REL_BASED_ABSOLUTE 0
+#define REL_BASED_HIGHLOW 3
+#define REL_BASED_DIR64 10
+/* the machines whose images only need the relocation types above */
+#define MACHINE_I386 0x014c
+#define MACHINE_X64 0x8664
+#define MACHINE_ARM64 0xaa64
+
+static UINT16 read16(const UINT8 *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static UINT32 read32(const UINT8 *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((UINT32) p[3] << 24);
+}
+
+static BOOLEAN isPowerOfTwo(UINT32 value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/* map an RVA range to a file offset through the section table */
+static BOOLEAN rvaToOffset(const UINT8 *sections, UINTN count, UINT32 rva, UINT32 size, UINT64 *offset) {
+    UINTN i;
+    const UINT8 *s;
+
+    for (i = 0; i < count; i++) {
+        s = sections + i * 40;
+        if (rva >= read32(s + 12) && (UINT64) rva + size <= (UINT64) read32(s + 12) + read32(s + 16)) {
+            *offset = (UINT64) read32(s + 20) + (rva - read32(s + 12));
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+EFI_STATUS peValidate(const VOID *Buffer, UINTN Size) {
+    const UINT8 *image = Buffer, *coff, *opt, *sections, *s, *dir, *block;
+    UINT32 peOffset, sizeOfImage, sizeOfHeaders, sectionAlignment, fileAlignment, dirCount, dirBase;
+    UINT32 relocRva, relocSize, blockRva, blockSize, virtualAddress, virtualSize, rawSize, lastEnd = 0;
+    UINT16 machine, sectionCount, optSize, magic, subsystem, entry;
+    UINT64 rawOffset, relocOffset, pos;
+    UINTN i, j, width;
+
+    if (image == NULL || Size < 0x40 || read16(image) != 0x5a4d)
+        return EFI_UNSUPPORTED;
+    peOffset = read32(image + 0x3c);
+    if ((UINT64) peOffset + 4 + 20 > Size || read32(image + peOffset) != 0x00004550)
+        return EFI_LOAD_ERROR;
+
+    coff = image + peOffset + 4;
+    machine = read16(coff);
+    sectionCount = read16(coff + 2);
+    optSize = read16(coff + 16);
+    if (machine != MACHINE_X64 && machine != MACHINE_I386 && machine != MACHINE_ARM64)
+        return EFI_UNSUPPORTED;
+    if (sectionCount == 0 || sectionCount > PE_MAX_SECTIONS)
+        return EFI_LOAD_ERROR;
+
+    opt = coff + 20;
+    if ((UINT64) peOffset + 4 + 20 + optSize + (UINT64) sectionCount * 40 > Size || optSize < 2)
+        return EFI_LOAD_ERROR;
+    magic = read16(opt);
+    if (magic == 0x20b) {
+        if (optSize < 112)
+            return EFI_LOAD_ERROR;
+        dirCount = read32(opt + 108);
+        dirBase = 112;
+    } else if (magic == 0x10b) {
+        if (optSize < 96)
+            return EFI_LOAD_ERROR;
+        dirCount = read32(opt + 92);
+        dirBase = 96;
+    } else {
+        return EFI_LOAD_ERROR;
+    }
+    if (dirCount > 16 || dirBase + dirCount * 8 > optSize)
+        return EFI_LOAD_ERROR;
+
+    sectionAlignment = read32(opt + 32);
+    fileAlignment = read32(opt + 36);
+    sizeOfImage = read32(opt + 56);
+    sizeOfHeaders = read32(opt + 60);
+    subsystem = read16(opt + 68);
+    if (!isPowerOfTwo(sectionAlignment) || !isPowerOfTwo(fileAlignment) || fileAlignment > sectionAlignment)
+        return EFI_LOAD_ERROR;
+    if (subsystem < 10 || subsystem > 13)
+        return EFI_UNSUPPORTED;
+    sections = opt + optSize;
+    if (sizeOfHeaders > Size || sizeOfHeaders > sizeOfImage || (UINT64) (sections - image) + sectionCount * 40 > sizeOfHeaders)
+        return EFI_LOAD_ERROR;
+    if (read32(opt + 16) >= sizeOfImage)
+        return EFI_LOAD_ERROR;
+
+    /* sections: ascending, non-overlapping, inside SizeOfImage and the file */
+    for (i = 0; i < sectionCount; i++) {
+        s = sections + i * 40;
+        virtualSize = read32(s + 8);
+        virtualAddress = read32(s + 12);
+        rawSize = read32(s + 16);
+        rawOffset = read32(s + 20);
+        if (virtualAddress < lastEnd || virtualAddress < sizeOfHeaders)
+            return EFI_LOAD_ERROR;
+        if ((UINT64) virtualAddress + (virtualSize > rawSize ? virtualSize : rawSize) > sizeOfImage)
+            return EFI_LOAD_ERROR;
+        if (rawSize != 0 && rawOffset + rawSize > Size)
+            return EFI_LOAD_ERROR;
+        lastEnd = virtualAddress + (virtualSize > rawSize ? virtualSize : rawSize);
+    }
+
+    dir = opt + dirBase;
+    /* the certificate table is addressed by file offset, not RVA */
+    if (dirCount > PE_DIRECTORY_SECURITY && read32(dir + PE_DIRECTORY_SECURITY * 8 + 4) != 0) {
+        if ((UINT64) read32(dir + PE_DIRECTORY_SECURITY * 8) + read32(dir + PE_DIRECTORY_SECURITY * 8 + 4) > Size)
+            return EFI_LOAD_ERROR;
+    }
+
+    if (dirCount <= PE_DIRECTORY_BASERELOC)
+        return EFI_SUCCESS;
+    relocRva = read32(dir + PE_DIRECTORY_BASERELOC * 8);
+    relocSize = read32(dir + PE_DIRECTORY_BASERELOC * 8 + 4);
+    if (relocSize == 0)
+        return EFI_SUCCESS;
+    if (!rvaToOffset(sections, sectionCount, relocRva, relocSize, &relocOffset) || relocOffset + relocSize > Size)
+        return EFI_LOAD_ERROR;
+
+    for (pos = 0; pos < relocSize; pos += blockSize) {
+        /* some linkers pad the directory to a multiple of 4 or 8 */
+        if (relocSize - pos < 8)
+            break;
+        block = image + relocOffset + pos;
+        blockRva = read32(block);
+        blockSize = read32(block + 4);
+        if (blockSize < 8 || (blockSize & 1) || blockSize > relocSize - pos)
+            return EFI_LOAD_ERROR;
+        for (j = 8; j < blockSize; j += 2) {
+            entry = read16(block + j);
+            switch (entry >> 12) {
+                case REL_BASED_ABSOLUTE:
+                    continue;
+                case REL_BASED_HIGHLOW:
+                    width = 4;
+                    break;
+                case REL_BASED_DIR64:
+                    width = 8;
+                    break;
+                default:
+                    return EFI_LOAD_ERROR;
+            }
+            if ((UINT64) blockRva + (entry & 0xfff) + width > sizeOfImage)
+                return EFI_LOAD_ERROR;
+        }
+    }
+    return EFI_SUCCESS;
+}
@@ -0,0 +1,317 @@
+/*
+ * grml-plus UEFI tools - read the default boot image while the menu is shown
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "prefetch.h"
+
+static WORK_POOL *workPool;
+
+VOID prefetchSetWorkPool(WORK_POOL *Pool) {
+    workPool = Pool;
+}
+
+EFI_STATUS prefetchStart(PREFETCH *Prefetch, EFI_FILE_HANDLE Root, CHAR16 *FileName, UINT64 FileSize) {
+    EFI_FILE_INFO *info;
+    EFI_PHYSICAL_ADDRESS buffer;
+    EFI_STATUS status;
+
+    ZeroMem(Prefetch, sizeof(PREFETCH));
+    Prefetch->Status = EFI_NOT_STARTED;
+    status = uefi_call_wrapper(Root->Open, 5, Root, &Prefetch->File, FileName, EFI_FILE_MODE_READ, 0);
+    if (status != EFI_SUCCESS) {
+        Prefetch->File = NULL;
+        Prefetch->Status = status;
+        return status;
+    }
+
+    if (FileSize == 0) {
+        info = LibFileInfo(Prefetch->File);
+        if (info) {
+            FileSize = info->FileSize;
+            FreePool(info);
+        }
+    }
+    if (FileSize == 0) {
+        uefi_call_wrapper(Prefetch->File->Close, 1, Prefetch->File);
+        Prefetch->File = NULL;
+        Prefetch->Status = EFI_LOAD_ERROR;
+        return EFI_LOAD_ERROR;
+    }
+    Prefetch->Size = FileSize;
+    Prefetch->ChunkSize = PREFETCH_CHUNK_SIZE;
+    Prefetch->Compressed = lz4IsCompressed(FileName);
+    Prefetch->DecodeStatus = EFI_NOT_READY;
+
+    Prefetch->Pages = EFI_SIZE_TO_PAGES(Prefetch->Size);
+    status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, Prefetch->Pages, &buffer);
+    if (status != EFI_SUCCESS) {
+        uefi_call_wrapper(Prefetch->File->Close, 1, Prefetch->File);
+        Prefetch->File = NULL;
+        Prefetch->Status = status;
+        return status;
+    }
+    Prefetch->Buffer = (UINT8 *) (UINTN) buffer;
+
+    if (Prefetch->File->Revision >= EFI_FILE_PROTOCOL_REVISION2 &&
+            uefi_call_wrapper(BS->CreateEvent, 5, 0, 0, NULL, NULL, &Prefetch->Token.Event) == EFI_SUCCESS)
+        Prefetch->Async = TRUE;
+
+    Prefetch->Status = EFI_NOT_READY;
+    return EFI_SUCCESS;
+}
+
+/* runs on an AP when there is a work pool, so no firmware calls in here */
+static VOID decodeWork(VOID *Context) {
+    PREFETCH *Prefetch = Context;
+
+    Prefetch->DecodeStart = perfTimestamp();
+    Prefetch->DecodeStatus = lz4Decode(&Prefetch->Frame, Prefetch->Buffer, Prefetch->DecodeInput, Prefetch->Image,
+        Prefetch->ImagePages * EFI_PAGE_SIZE);
+    Prefetch->DecodeRunTicks = perfTimestamp() - Prefetch->DecodeStart;
+}
+
+/*
+ * The output is allocated at the size recorded in the frame, or grown by
+ * doubling from a guess if the frame does not record it.
+ */
+static EFI_STATUS prefetchGrowImage(PREFETCH *Prefetch) {
+    EFI_PHYSICAL_ADDRESS image;
+    EFI_STATUS status;
+    UINTN pages;
+
+    if (Prefetch->Frame.ContentSize != 0)
+        pages = EFI_SIZE_TO_PAGES(Prefetch->Frame.ContentSize);
+    else if (Prefetch->ImagePages != 0)
+        pages = Prefetch->ImagePages * 2;
+    else
+        pages = EFI_SIZE_TO_PAGES(Prefetch->Size * 3);
+    if (pages <= Prefetch->ImagePages)
+        return EFI_LOAD_ERROR;
+    status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, pages, &image);
+    if (status != EFI_SUCCESS)
+        return status;
+    if (Prefetch->Image) {
+        CopyMem((UINT8 *) (UINTN) image, Prefetch->Image, Prefetch->Frame.OutputOffset);
+        uefi_call_wrapper(BS->FreePages, 2, (EFI_PHYSICAL_ADDRESS) (UINTN) Prefetch->Image, Prefetch->ImagePages);
+    }
+    Prefetch->Image = (UINT8 *) (UINTN) image;
+    Prefetch->ImagePages = pages;
+    return EFI_SUCCESS;
+}
+
+/*
+ * Advances the decoding of a compressed file: collects the last decode,
+ * grows the output if it was too small, and hands whatever input arrived
+ * since to the next one. With a work pool, the decode runs on an AP while
+ * the BSP goes on reading.
+ */
+static VOID prefetchDecode(PREFETCH *Prefetch) {
+    EFI_STATUS status;
+
+    while (TRUE) {
+        if (Prefetch->Decoding) {
+            if (!workPoolDone(workPool, &Prefetch->DecodeWork))
+                return;
+            Prefetch->Decoding = FALSE;
+            Prefetch->DecodeTicks += Prefetch->DecodeRunTicks;
+            perfTallyTicks(PERF_DECOMPRESS, Prefetch->DecodeStart, Prefetch->DecodeRunTicks);
+        }
+        status = Prefetch->DecodeStatus;
+        if (status == EFI_BUFFER_TOO_SMALL) {
+            status = prefetchGrowImage(Prefetch);
+        } else if (status == EFI_SUCCESS || (status == EFI_NOT_READY && Prefetch->DecodeInput == Prefetch->Offset)) {
+            /* the frame is complete, or it needs input that has not arrived yet */
+            if (Prefetch->Offset >= Prefetch->Size)
+                Prefetch->Status = status == EFI_SUCCESS ? EFI_SUCCESS : EFI_LOAD_ERROR;
+            return;
+        } else if (status == EFI_NOT_READY) {
+            status = EFI_SUCCESS;
+        }
+        if (status != EFI_SUCCESS) {
+            Prefetch->Status = status;
+            return;
+        }
+        Prefetch->DecodeInput = Prefetch->Offset;
+        Prefetch->Decoding = TRUE;
+        workPoolSubmit(workPool, &Prefetch->DecodeWork, decodeWork, Prefetch);
+    }
+}
+
+static VOID prefetchComplete(PREFETCH *Prefetch, EFI_STATUS Status, UINTN Read) {
+    Prefetch->Pending = FALSE;
+    if (Status != EFI_SUCCESS || Read == 0) {
+        Prefetch->Status = Status != EFI_SUCCESS ? Status : EFI_LOAD_ERROR;
+    } else {
+        Prefetch->Offset += Read;
+        if (Prefetch->Compressed)
+            prefetchDecode(Prefetch);
+        else if (Prefetch->Offset >= Prefetch->Size)
+            Prefetch->Status = EFI_SUCCESS;
+    }
+    if (Prefetch->File && (Prefetch->Status != EFI_NOT_READY || Prefetch->Offset >= Prefetch->Size)) {
+        uefi_call_wrapper(Prefetch->File->Close, 1, Prefetch->File);
+        Prefetch->File = NULL;
+    }
+}
+
+/* advance by one chunk; returns FALSE once there is nothing left to do */
+BOOLEAN prefetchStep(PREFETCH *Prefetch) {
+    EFI_STATUS status;
+    UINTN size;
+
+    if (Prefetch->Status != EFI_NOT_READY)
+        return FALSE;
+
+    if (Prefetch->Pending) {
+        if (uefi_call_wrapper(BS->CheckEvent, 1, Prefetch->Token.Event) == EFI_SUCCESS)
+            prefetchComplete(Prefetch, Prefetch->Token.Status, Prefetch->Token.BufferSize);
+        return Prefetch->Status == EFI_NOT_READY;
+    }
+
+    /* everything is read, but a compressed file may still be decoding */
+    if (Prefetch->Offset >= Prefetch->Size) {
+        prefetchDecode(Prefetch);
+        return Prefetch->Status == EFI_NOT_READY;
+    }
+
+    size = Prefetch->Size - Prefetch->Offset;
+    if (size > Prefetch->ChunkSize)
+        size = Prefetch->ChunkSize;
+
+    if (Prefetch->Async) {
+        Prefetch->Token.Status = EFI_SUCCESS;
+        Prefetch->Token.BufferSize = size;
+        Prefetch->Token.Buffer = Prefetch->Buffer + Prefetch->Offset;
+        status = uefi_call_wrapper(Prefetch->File->ReadEx, 2, Prefetch->File, &Prefetch->Token);
+        if (status == EFI_SUCCESS) {
+            Prefetch->Pending = TRUE;
+            return TRUE;
+        }
+        /* driver claims revision 2 but cannot do it, use synchronous reads */
+        Prefetch->Async = FALSE;
+        uefi_call_wrapper(BS->CloseEvent, 1, Prefetch->Token.Event);
+        Prefetch->Token.Event = NULL;
+    }
+
+    status = uefi_call_wrapper(Prefetch->File->Read, 3, Prefetch->File, &size, Prefetch->Buffer + Prefetch->Offset);
+    prefetchComplete(Prefetch, status, size);
+    return Prefetch->Status == EFI_NOT_READY;
+}
+
+EFI_STATUS prefetchFinish(PREFETCH *Prefetch) {
+    Prefetch->ChunkSize = PREFETCH_FINISH_CHUNK_SIZE;
+    while (Prefetch->Status == EFI_NOT_READY) {
+        /* waiting resets the event, so a CheckEvent in prefetchStep would miss it */
+        if (Prefetch->Pending) {
+            WaitForSingleEvent(Prefetch->Token.Event, 0);
+            prefetchComplete(Prefetch, Prefetch->Token.Status, Prefetch->Token.BufferSize);
+        } else if (Prefetch->Decoding && Prefetch->Offset >= Prefetch->Size) {
+            workPoolWait(workPool, &Prefetch->DecodeWork);
+            prefetchDecode(Prefetch);
+        } else {
+            prefetchStep(Prefetch);
+        }
+    }
+    return Prefetch->Status;
+}
+
+VOID prefetchFree(PREFETCH *Prefetch) {
+    /* the decode may still be using the buffers */
+    if (Prefetch->Decoding)
+        workPoolWait(workPool, &Prefetch->DecodeWork);
+    if (Prefetch->Pending)
+        WaitForSingleEvent(Prefetch->Token.Event, 0);
+    if (Prefetch->Token.Event)
+        uefi_call_wrapper(BS->CloseEvent, 1, Prefetch->Token.Event);
+    if (Prefetch->File)
+        uefi_call_wrapper(Prefetch->File->Close, 1, Prefetch->File);
+    if (Prefetch->Buffer)
+        uefi_call_wrapper(BS->FreePages, 2, (EFI_PHYSICAL_ADDRESS) (UINTN) Prefetch->Buffer, Prefetch->Pages);
+    if (Prefetch->Image)
+        uefi_call_wrapper(BS->FreePages, 2, (EFI_PHYSICAL_ADDRESS) (UINTN) Prefetch->Image, Prefetch->ImagePages);
+    ZeroMem(Prefetch, sizeof(PREFETCH));
+    Prefetch->Status = EFI_NOT_STARTED;
+}
+
+/* TRUE once ConIn or KeyEvent (may be NULL) has something */
+static BOOLEAN keyWaiting(EFI_EVENT KeyEvent) {
+    return uefi_call_wrapper(BS->CheckEvent, 1, ST->ConIn->WaitForKey) == EFI_SUCCESS ||
+        (KeyEvent != NULL && uefi_call_wrapper(BS->CheckEvent, 1, KeyEvent) == EFI_SUCCESS);
+}
+
+/* replacement for WaitForSingleEvent(ST->ConIn->WaitForKey, 0), also woken by KeyEvent */
+VOID prefetchWaitForKey(PREFETCH *Prefetch, EFI_EVENT KeyEvent) {
+    EFI_EVENT events[3];
+    UINTN index, count;
+
+    while (!keyWaiting(KeyEvent)) {
+        events[0] = ST->ConIn->WaitForKey;
+        count = 1;
+        if (KeyEvent != NULL)
+            events[count++] = KeyEvent;
+        if (Prefetch->Status != EFI_NOT_READY) {
+            uefi_call_wrapper(BS->WaitForEvent, 3, count, events, &index);
+            return;
+        }
+        if (Prefetch->Pending) {
+            events[count++] = Prefetch->Token.Event;
+            uefi_call_wrapper(BS->WaitForEvent, 3, count, events, &index);
+            if (index < count - 1)
+                return;
+            prefetchComplete(Prefetch, Prefetch->Token.Status, Prefetch->Token.BufferSize);
+        } else {
+            prefetchStep(Prefetch);
+        }
+    }
+}
+
+/* load from the prefetched buffer if possible; the buffer is released afterwards */
+EFI_STATUS prefetchLoadImage(PREFETCH *Prefetch, EFI_HANDLE ParentImage, EFI_DEVICE_PATH *FilePath, EFI_HANDLE *NewImage) {
+    EFI_STATUS status;
+
+    if (Prefetch != NULL && Prefetch->Status != EFI_NOT_STARTED && prefetchFinish(Prefetch) == EFI_SUCCESS) {
+        if (Prefetch->Compressed)
+            status = uefi_call_wrapper(BS->LoadImage, 6, FALSE, ParentImage, FilePath, Prefetch->Image,
+                Prefetch->Frame.OutputOffset, NewImage);
+        else
+            status = uefi_call_wrapper(BS->LoadImage, 6, FALSE, ParentImage, FilePath, Prefetch->Buffer, Prefetch->Size, NewImage);
+    } else if (Prefetch != NULL && Prefetch->Compressed) {
+        status = Prefetch->Status;
+    } else {
+        status = uefi_call_wrapper(BS->LoadImage, 6, FALSE, ParentImage, FilePath, NULL, 0, NewImage);
+    }
+    if (Prefetch != NULL)
+        prefetchFree(Prefetch);
+    return status;
+}
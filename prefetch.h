@@ -0,0 +1,93 @@
+/*
+ * grml-plus UEFI tools - read the default boot image while the menu is shown
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "lz4.h"
+#include "workpool.h"
+
+/*
+ * The file is read in PREFETCH_CHUNK_SIZE pieces from the menu's key wait
+ * loop. On EFI_FILE_PROTOCOL revision 2 drivers, each chunk is issued with
+ * ReadEx and an event token, so asynchronous capable stacks can overlap the
+ * transfer with the wait; otherwise plain Read is used between key checks.
+ *
+ * Status is EFI_NOT_STARTED before prefetchStart, EFI_NOT_READY while data
+ * is outstanding and EFI_SUCCESS once Buffer holds the whole file. Any other
+ * status means the prefetch failed and LoadImage will read from disk.
+ *
+ * Files ending in LZ4_SUFFIX are decompressed as their chunks arrive into
+ * Image, which is what LoadImage gets; the firmware cannot read them by
+ * itself, so they have to be prefetched to be loaded at all. Once nothing
+ * else is waiting (prefetchFinish), the rest of a file is read in
+ * PREFETCH_FINISH_CHUNK_SIZE pieces. Given a work pool, the blocks are
+ * decoded on an AP while the BSP issues the next read.
+ */
+
+#define PREFETCH_CHUNK_SIZE (256 * 1024)
+#define PREFETCH_FINISH_CHUNK_SIZE (4 * 1024 * 1024)
+
+typedef struct {
+    EFI_STATUS Status;
+    EFI_FILE_HANDLE File;
+    UINT8 *Buffer;
+    UINTN Size;
+    UINTN Offset;
+    UINTN Pages;
+    UINTN ChunkSize;
+    BOOLEAN Async;
+    BOOLEAN Pending;
+    EFI_FILE_IO_TOKEN Token;
+    BOOLEAN Compressed;
+    LZ4_FRAME Frame;
+    UINT8 *Image;
+    UINTN ImagePages;
+    UINT64 DecodeTicks;
+    BOOLEAN Decoding;
+    WORK_ITEM DecodeWork;
+    UINTN DecodeInput;
+    EFI_STATUS DecodeStatus;
+    UINT64 DecodeStart;
+    UINT64 DecodeRunTicks;
+} PREFETCH;
+
+/* decode compressed files on Pool (NULL: on the BSP) from now on */
+VOID prefetchSetWorkPool(WORK_POOL *Pool);
+/* FileSize may be 0 if the caller does not know it yet */
+EFI_STATUS prefetchStart(PREFETCH *Prefetch, EFI_FILE_HANDLE Root, CHAR16 *FileName, UINT64 FileSize);
+BOOLEAN prefetchStep(PREFETCH *Prefetch);
+EFI_STATUS prefetchFinish(PREFETCH *Prefetch);
+VOID prefetchFree(PREFETCH *Prefetch);
+VOID prefetchWaitForKey(PREFETCH *Prefetch, EFI_EVENT KeyEvent);
+EFI_STATUS prefetchLoadImage(PREFETCH *Prefetch, EFI_HANDLE ParentImage, EFI_DEVICE_PATH *FilePath, EFI_HANDLE *NewImage);
+
+#endif
@@ -32,31 +32,106 @@
 #include <efi.h>
 #include <efilib.h>
 
-static void printColor(UINTN color, CHAR16* string) {
-    uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, color);
-    Print(string);
+#include "bootperf.h"
+#include "prefetch.h"
+#include "common.h"
+#include "alloctrack.h"
+#include "hotkey.h"
+#include "timeline.h"
+#include "memmap.h"
+#include "memsnap.h"
+#include "arena.h"
+#include "screen.h"
+
+static BOOLEAN trackAllocations = FALSE;
+static BOOLEAN takeSnapshots = FALSE;
+static MEMSNAP memSnap;
+static EFI_STATUS snapStatus = EFI_SUCCESS;
+static ARENA arena;
+static EFI_FILE_HANDLE root;
+static UINTN launches = 0;
+static UINT64 startPages[EfiMaxMemoryType];
+/* before root, arena and screen were set up, to check a soft restart against */
+static UINT64 entryPages[EfiMaxMemoryType];
+
+/* load options of a soft restarted copy that must not offer Quit either */
+#define NO_QUIT_OPTION L"noquit"
+
+static SCREEN screen;
+static HOTKEYS hotkeys;
+
+/* the menu actions; W, D and F are toggles and fine with polling */
+static EFI_INPUT_KEY menuKeys[] = {
+    { SCAN_NULL, L'C' }, { SCAN_NULL, L'c' }, { SCAN_NULL, L'M' }, { SCAN_NULL, L'm' },
+    { SCAN_NULL, L'E' }, { SCAN_NULL, L'e' }, { SCAN_NULL, L'U' }, { SCAN_NULL, L'u' },
+    { SCAN_NULL, L'S' }, { SCAN_NULL, L's' }, { SCAN_NULL, L'R' }, { SCAN_NULL, L'r' },
+    { SCAN_NULL, L'H' }, { SCAN_NULL, L'h' }, { SCAN_NULL, L'G' }, { SCAN_NULL, L'T' },
+    { SCAN_NULL, L'Q' }, { SCAN_NULL, L'q' }
+};
+
+static void readStoredPages(INT32 StoredPages[2][EfiMaxMemoryType]);
+
+static void menuLine(UINTN row, CHAR16 *key, CHAR16 *text) {
+    screenPrint(&screen, screenPrint(&screen, 0, row, EFI_LIGHTCYAN, key), row, EFI_WHITE, text);
+}
+
+/* path of a child image next to ours, preferring its compressed variant */
+static CHAR16 *childImagePath(EFI_LOADED_IMAGE *li, CHAR16 *filename) {
+    CHAR16 *pathname = arenaChildPath(&arena, li->FilePath, filename), *compressed;
+
+    if (pathname == NULL || root == NULL)
+        return pathname;
+    compressed = arenaAlloc(&arena, StrSize(pathname) + StrLen(LZ4_SUFFIX) * sizeof(CHAR16));
+    if (compressed == NULL)
+        return pathname;
+    StrCpy(compressed, pathname);
+    StrCat(compressed, LZ4_SUFFIX);
+    return fileExists(root, compressed) ? compressed : pathname;
 }
 
-static void runImage(EFI_HANDLE ImageHandle, CHAR16* filename) {
+static void runImage(EFI_HANDLE ImageHandle, CHAR16* filename, PREFETCH *prefetch) {
     EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
     EFI_LOADED_IMAGE *li;
     EFI_HANDLE newImage;
-    CHAR16 *pathname = NULL;
-    CHAR16 *myname;
-    INTN i;
+    EFI_INPUT_KEY key;
+    EFI_STATUS status;
+    CHAR16 *pathname;
+    INT32 stored[2][EfiMaxMemoryType];
+    PREFETCH compressed = { EFI_NOT_STARTED };
 
+    launches++;
     uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (void **)&li);
-    myname = DevicePathToStr(li->FilePath);
-    for (i = StrLen(myname); i > 0 && myname[i] != L'\\'; i--) ;
-    if (i > 0 && myname[i-1] != L'\\') i++;
-    myname[i] = '\0';
-    pathname = AllocateZeroPool(StrLen(myname) + StrLen(filename) + 1);
-    StrCat(pathname, myname);
-    StrCat(pathname, filename);
-    uefi_call_wrapper(BS->LoadImage, 6, FALSE, ImageHandle, FileDevicePath(li->DeviceHandle, pathname), NULL, 0, &newImage);
-    uefi_call_wrapper(BS->StartImage, 3, newImage, NULL, NULL);
-    FreePool(myname);
-    FreePool(pathname);
+    pathname = childImagePath(li, filename);
+    /* the firmware cannot read compressed images, they always go through a prefetch */
+    if (pathname && lz4IsCompressed(pathname) && (prefetch == NULL || prefetch->Status == EFI_NOT_STARTED)) {
+        if (prefetch == NULL)
+            prefetch = &compressed;
+        prefetchStart(prefetch, root, pathname, 0);
+    }
+    if (loadChildImage(ImageHandle, arenaFileDevicePath(&arena, li->DeviceHandle, pathname), prefetch, &newImage) != EFI_SUCCESS)
+        return;
+    /* a menu key pressed while the image was loading wins over starting it */
+    if (hotkeys.Count != 0) {
+        unloadImage(newImage);
+        return;
+    }
+    /* the child reads ConIn itself */
+    hotkeyStop(&hotkeys);
+    if (takeSnapshots)
+        snapStatus = memSnapBegin(&memSnap, filename);
+    if (trackAllocations)
+        allocTrackStart();
+    status = startChildImage(newImage);
+    allocTrackStop();
+    if (takeSnapshots && snapStatus == EFI_SUCCESS)
+        snapStatus = memSnapEnd(&memSnap, status, root);
+    if (trackAllocations) {
+        readStoredPages(stored);
+        allocTrackReport(filename, stored[0]);
+        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+    }
+    unloadImage(newImage);
+    hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
 }
 
 static BOOLEAN memoryTypeInformationVariableFound() {
@@ -67,78 +142,202 @@ static BOOLEAN memoryTypeInformationVariableFound() {
     return status != EFI_NOT_FOUND;
 }
 
-static void guruScreen() {
+static void readStoredPages(INT32 StoredPages[2][EfiMaxMemoryType]) {
     EFI_GUID memoryTypeInformationGUID = { 0x4c19049f,0x4137,0x4dd3, { 0x9c,0x10,0x8b,0x97,0xa8,0x3f,0xfd,0xfa } };
-    UINTN i, j, DescriptorSize;
-    UINT32 DescriptorVersion;
-    UINT64 NoPages[EfiMaxMemoryType];
-    INT32 StoredPages[2][EfiMaxMemoryType];
-    UINT32 buffer[40];
-    EFI_MEMORY_DESCRIPTOR *Desc, *MemMap;
+    UINTN i, j;
+    UINT32 *buffer;
     UINTN dataSize;
-    EFI_STATUS status;
 
     for(i = 0; i < EfiMaxMemoryType; i++) {
-        NoPages[i] = 0;
         StoredPages[0][i] = -1;
         StoredPages[1][i] = -1;
     }
 
+    /* one { Type, NumberOfPages } pair per bin, as many as the firmware keeps */
     for(j = 0; j < 2; j++) {
-        dataSize = 160;
-        status = uefi_call_wrapper(RT->GetVariable, 5, 
-            j ? L"MemoryTypeInformationBackup" : L"MemoryTypeInformation",
-            &memoryTypeInformationGUID, NULL, &dataSize, &buffer);
-        if (status == EFI_SUCCESS) {
-            for(i = 0; i < (dataSize >> 2); i += 2) {
-                if(buffer[i] >= 0 && buffer[i] < EfiMaxMemoryType) {
-                    StoredPages[j][buffer[i]] = buffer[i+1];
-                }
+        buffer = LibGetVariableAndSize(j ? L"MemoryTypeInformationBackup" : L"MemoryTypeInformation",
+            &memoryTypeInformationGUID, &dataSize);
+        if (buffer == NULL)
+            continue;
+        for(i = 0; i + 1 < (dataSize >> 2); i += 2) {
+            if(buffer[i] < EfiMaxMemoryType) {
+                StoredPages[j][buffer[i]] = buffer[i+1];
             }
         }
+        FreePool(buffer);
     }
+}
 
-    MemMap = LibMemoryMap (&j, &i, &DescriptorSize, &DescriptorVersion);
-    Desc = MemMap;
-    for (i = 0; i < j; i++) {
-        NoPages[Desc->Type] += Desc->NumberOfPages;
-        Desc = NextMemoryDescriptor(Desc, DescriptorSize);
+static void guruScreen() {
+    UINTN i;
+    UINT64 NoPages[EfiMaxMemoryType];
+    INT32 StoredPages[2][EfiMaxMemoryType];
+    MEMMAP_ANALYSIS *analysis = AllocatePool(sizeof(MEMMAP_ANALYSIS));
+    TEXT_LINES lines = { NULL, 0, 0 };
+    EFI_STATUS status = EFI_OUT_OF_RESOURCES;
+
+    readStoredPages(StoredPages);
+    if (analysis)
+        status = memMapAnalyze(analysis);
+    if (status == EFI_SUCCESS) {
+        for (i = 0; i < EfiMaxMemoryType; i++)
+            NoPages[i] = analysis->Types[i].Pages;
+    } else {
+        memoryMapUsage(NoPages);
     }
-    Print(L"Type  Used      Stored    Backup\n");
+    textLinesAdd(&lines, PoolPrint(L"Launches: %d  Arena: %d/%d bytes used, %d high water, %d failed",
+          launches, arena.Used, arena.Pages * EFI_PAGE_SIZE, arena.HighWater, arena.Failed));
+    textLinesAdd(&lines, PoolPrint(L"Console: %dx%d (%s)  Slowest key-to-paint: %ld us",
+          screen.Columns, screen.Rows + 1, screen.FrameBuffer ? L"framebuffer" : L"ConOut",
+          perfMicroseconds(screen.MaxKeyTicks)));
+    textLinesAdd(&lines, PoolPrint(L"Hotkeys: %s, %d notified, %d polled  Slowest key-to-action: %ld us",
+          hotkeys.InputEx ? L"notifications" : L"ConIn only", hotkeys.Notified, hotkeys.Polled,
+          perfMicroseconds(hotkeys.MaxTicks)));
+    textLinesAdd(&lines, PoolPrint(L"Left behind by started images: %ld pages (tracked with W, not freed)", allocTrackLeftoverPages()));
+    textLinesAdd(&lines, StrDuplicate(L""));
+    textLinesAdd(&lines, StrDuplicate(L"Type               Used      Stored    Backup    Growth  Descr  Runs"));
     for (i = 0; i < EfiMaxMemoryType; i++) {
         if (NoPages[i] != 0 || StoredPages[0][i] != -1 || StoredPages[1][i] != -1) {
-            Print(L"%04x  %08lx  %08x  %08x\n", i, NoPages[i], StoredPages[0][i], StoredPages[1][i]);
+            textLinesAdd(&lines, PoolPrint(L"%04x %-12s  %08lx  %08x  %08x  %6ld  %5d %5d", i, memMapTypeName(i),
+                  NoPages[i], StoredPages[0][i], StoredPages[1][i], (INT64)(NoPages[i] - startPages[i]),
+                  status == EFI_SUCCESS ? analysis->Types[i].Descriptors : 0, status == EFI_SUCCESS ? analysis->Types[i].Runs : 0));
         }
     }
-    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    textLinesAdd(&lines, StrDuplicate(L""));
+    if (status == EFI_SUCCESS)
+        memMapReport(analysis, &lines);
+    else
+        textLinesAdd(&lines, PoolPrint(L"Memory map analysis failed: %r", status));
+    if (analysis)
+        FreePool(analysis);
+    /* it reads the keys itself, also those of the menu */
+    hotkeyStop(&hotkeys);
+    textLinesShow(&lines, L"Guru screen");
+    hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+    textLinesFree(&lines);
+}
+
+static void setUp(EFI_LOADED_IMAGE *li) {
+    root = LibOpenRoot(li->DeviceHandle);
+    arenaInit(&arena, ARENA_PAGES);
+    screenInit(&screen, 80, 25);
+    hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+}
+
+static void tearDown(PREFETCH *prefetch) {
+    hotkeyStop(&hotkeys);
+    memSnapFree(&memSnap);
+    prefetchFree(prefetch);
+    if (root)
+        uefi_call_wrapper(root->Close, 1, root);
+    root = NULL;
+    screenFree(&screen);
+    arenaFree(&arena);
+}
+
+/*
+ * Gives back everything this copy still holds, reports what the images it
+ * started left behind, and starts a fresh copy from disk. The firmware
+ * cannot replace a running image, so ours stays loaded underneath until the
+ * fresh copy returns. Restarted is FALSE if the fresh copy could not be
+ * loaded; we are set up again then.
+ */
+static EFI_STATUS softRestart(EFI_HANDLE ImageHandle, EFI_LOADED_IMAGE *li, PREFETCH *prefetch, BOOLEAN mayExit,
+        BOOLEAN *Restarted) {
+    EFI_INPUT_KEY key;
+    EFI_STATUS status;
+    UINT64 leftover = allocTrackLeftoverPages();
+
+    tearDown(prefetch);
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    /* they may still be in use by what the images installed, so they stay */
+    if (leftover)
+        Print(L"Started images left %ld pages of loader memory allocated\n", leftover);
+    if (!memoryMapCheck(entryPages)) {
+        Print(L"\nMemory map not back to its starting state, press any key to restart anyway\n");
+        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+    }
+    status = restartImage(ImageHandle, mayExit ? NULL : NO_QUIT_OPTION, Restarted);
+    if (!*Restarted) {
+        Print(L"Cannot reload protector: %r\n", status);
+        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+        setUp(li);
+    }
+    return status;
 }
 
-EFI_STATUS EFIAPI efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
+EFI_STATUS efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
+    EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
+    EFI_LOADED_IMAGE *li;
     EFI_INPUT_KEY key;
-    BOOLEAN mayExit = TRUE, imageStarted;
+    BOOLEAN mayExit = TRUE, imageStarted, restarted;
+    PREFETCH prefetch = { EFI_NOT_STARTED };
+    CHAR16 *pathname;
+    UINTN record, row;
+    UINT64 waitStart, keyTsc;
+    EFI_STATUS status;
 
+    perfInit(L"BootPerfProtector");
+    record = perfBegin(PERF_INITIALIZE_LIB);
     InitializeLib(ImageHandle, SystemTable);
+    perfEnd(record);
+
+    uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (void **)&li);
+    if (li->LoadOptions != NULL && li->LoadOptionsSize == sizeof(NO_QUIT_OPTION) &&
+            StrCmp(li->LoadOptions, NO_QUIT_OPTION) == 0)
+        mayExit = FALSE;
+    memoryMapUsage(entryPages);
+    setUp(li);
+    memoryMapUsage(startPages);
 
     while(TRUE) {
-        uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
-        printColor(EFI_LIGHTRED, L"grml-plus UEFI Protector\n");
-        printColor(EFI_LIGHTBLUE, L"(c) 2014 Michael Schierl\n\n");
-        printColor(EFI_LIGHTCYAN, L"C"); printColor(EFI_WHITE, L"ontinue booting to GRUB bootloader\n\n");
-        printColor(EFI_LIGHTCYAN, L"M"); printColor(EFI_WHITE, L"emtest\n");
-        printColor(EFI_LIGHTCYAN, L"E"); printColor(EFI_WHITE, L"FI Shell\n");
-        printColor(EFI_LIGHTCYAN, L"U"); printColor(EFI_WHITE, L"EFI Shell\n\n");
-        printColor(EFI_LIGHTCYAN, L"R"); printColor(EFI_WHITE, L"eboot\n");
-        printColor(EFI_LIGHTCYAN, L"H"); printColor(EFI_WHITE, L"alt\n\n");
+        /* nothing allocated in the previous iteration outlives it */
+        arenaReset(&arena);
+        screenClear(&screen);
+        screenPrint(&screen, 0, 0, EFI_LIGHTRED, L"grml-plus UEFI Protector");
+        screenPrint(&screen, 0, 1, EFI_LIGHTBLUE, L"(c) 2014 Michael Schierl");
+        menuLine(3, L"C", L"ontinue booting to GRUB bootloader");
+        menuLine(5, L"M", L"emtest");
+        menuLine(6, L"E", L"FI Shell");
+        menuLine(7, L"U", L"EFI Shell");
+        menuLine(9, L"S", L"oft restart");
+        menuLine(10, L"R", L"eboot");
+        menuLine(11, L"H", L"alt");
+        row = 13;
+
+        if (trackAllocations) {
+            screenPrint(&screen, 0, row++, EFI_YELLOW, L"(Reporting allocations of started images)");
+        }
+        if (takeSnapshots) {
+            screenPrint(&screen, 0, row++, EFI_YELLOW, snapStatus == EFI_SUCCESS
+                ? L"(Writing memory map snapshots of started images)" : L"(Writing memory map snapshots failed)");
+        }
 
         if (mayExit) {
-            printColor(EFI_LIGHTCYAN, L"Q"); printColor(EFI_WHITE, L"uit\n\n\n");
+            menuLine(row, L"Q", L"uit");
+            row += 3;
         } else {
-            printColor(EFI_YELLOW, L"\n(Quit command disabled to avoid bricking memory map)\n");
-            printColor(EFI_WHITE, L"\n");
+            screenPrint(&screen, 0, row + 1, EFI_YELLOW, L"(Quit command disabled to avoid bricking memory map)");
+            row += 3;
         }
+        screenFlush(&screen, 0, row);
 
-        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
-        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+        /* GRUB is the default, so read it while the user makes up their mind */
+        if (root && prefetch.Status == EFI_NOT_STARTED) {
+            pathname = childImagePath(li, L"grub.efi");
+            if (pathname)
+                prefetchStart(&prefetch, root, pathname, 0);
+        }
+
+        waitStart = perfTimestamp();
+        prefetchWaitForKey(&prefetch, hotkeys.Event);
+        perfAccumulate(PERF_MENU_WAIT, waitStart);
+        /* woken by a press that was already acted on */
+        if (hotkeyReadKey(&hotkeys, &key, &keyTsc) != EFI_SUCCESS)
+            continue;
+        screenKeyPressed(&screen, keyTsc);
 
         if (key.UnicodeChar == 0 && key.ScanCode == SCAN_ESC) {
             key.UnicodeChar = L'Q';
@@ -152,25 +351,36 @@ EFI_STATUS EFIAPI efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTabl
             case L'\r':
             case L' ':
                 imageStarted = TRUE;
-                runImage(ImageHandle, L"grub.efi");
+                runImage(ImageHandle, L"grub.efi", &prefetch);
                 break;
 
             case L'M':
             case L'm':
                 imageStarted = TRUE;
-                runImage(ImageHandle, L"memtest.efi");
+                prefetchFree(&prefetch);
+                runImage(ImageHandle, L"memtest.efi", NULL);
                 break;
 
             case L'E':
             case L'e':
                 imageStarted = TRUE;
-                runImage(ImageHandle, L"efi-shell.efi");
+                prefetchFree(&prefetch);
+                runImage(ImageHandle, L"efi-shell.efi", NULL);
                 break;
 
             case L'u':
             case L'U':
                 imageStarted = TRUE;
-                runImage(ImageHandle, L"uefi-shell.efi");
+                prefetchFree(&prefetch);
+                runImage(ImageHandle, L"uefi-shell.efi", NULL);
+                break;
+
+            case L's':
+            case L'S':
+                imageStarted = TRUE;
+                status = softRestart(ImageHandle, li, &prefetch, mayExit, &restarted);
+                if (restarted)
+                    return status;
                 break;
 
             case L'r':
@@ -190,12 +400,38 @@ EFI_STATUS EFIAPI efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTabl
                 guruScreen();
                 break;
 
+            case L'T':
+                imageStarted = TRUE;
+                hotkeyStop(&hotkeys);
+                timelineScreen(root);
+                hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+                break;
+
+            case L'W':
+                trackAllocations = !trackAllocations;
+                break;
+
+            case L'D':
+                takeSnapshots = !takeSnapshots;
+                snapStatus = EFI_SUCCESS;
+                break;
+
+            case L'F':
+                screenUseGraphics(&screen, screen.FrameBuffer == NULL);
+                break;
+
             case L'q':
             case L'Q':
-                if (mayExit)
+                if (mayExit) {
+                    tearDown(&prefetch);
+                    perfPublish();
                     return EFI_SUCCESS;
+                }
         }
 
+        if (imageStarted)
+            screenInvalidate(&screen);
+
         if (imageStarted && mayExit && memoryTypeInformationVariableFound()) {
             mayExit = FALSE;
         }
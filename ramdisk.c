@@ -0,0 +1,211 @@
+/*
+ * grml-plus UEFI tools - boot tool images from a RAM disk
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "common.h"
+#include "ramdisk.h"
+
+#define ISO_SUFFIX L".iso"
+#define IMG_SUFFIX L".img"
+#define CD_BLOCK_SIZE 2048
+#define DISK_BLOCK_SIZE 512
+
+static BOOLEAN hasSuffix(CHAR16 *FileName, CHAR16 *Suffix) {
+    UINTN len = StrLen(FileName), suffixLen = StrLen(Suffix);
+
+    return len > suffixLen && StriCmp(FileName + len - suffixLen, Suffix) == 0;
+}
+
+BOOLEAN ramDiskIsImage(CHAR16 *FileName) {
+    return hasSuffix(FileName, ISO_SUFFIX) || hasSuffix(FileName, IMG_SUFFIX);
+}
+
+/* one key per chunk, so that keys typed ahead are not all swallowed */
+static BOOLEAN escapePressed(VOID) {
+    EFI_INPUT_KEY key;
+
+    return uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key) == EFI_SUCCESS && key.ScanCode == SCAN_ESC;
+}
+
+static VOID showProgress(CHAR16 *Label, UINT64 Done, UINT64 Total, UINT64 StartTsc) {
+    UINT64 us = perfMicroseconds(perfTimestamp() - StartTsc), tenthMBs = us ? Done * 10 / us : 0;
+
+    Print(L"\r%s: %ld of %ld MB, %ld.%ld MB/s   ", Label, (Done + (1 << 20) - 1) >> 20, (Total + (1 << 20) - 1) >> 20,
+        tenthMBs / 10, tenthMBs % 10);
+}
+
+static EFI_STATUS readImage(RAM_DISK *Disk, EFI_FILE_HANDLE Root, CHAR16 *FileName, UINT64 *FileSize) {
+    EFI_FILE_HANDLE file;
+    EFI_FILE_INFO *info;
+    EFI_STATUS status;
+    UINT64 done = 0, start;
+    UINTN size, blockSize = hasSuffix(FileName, ISO_SUFFIX) ? CD_BLOCK_SIZE : DISK_BLOCK_SIZE;
+    CHAR16 *label;
+
+    for (label = FileName + StrLen(FileName); label > FileName && label[-1] != L'\\'; label--) ;
+
+    status = uefi_call_wrapper(Root->Open, 5, Root, &file, FileName, EFI_FILE_MODE_READ, 0);
+    if (status != EFI_SUCCESS)
+        return status;
+    info = LibFileInfo(file);
+    if (info == NULL) {
+        uefi_call_wrapper(file->Close, 1, file);
+        return EFI_DEVICE_ERROR;
+    }
+    *FileSize = info->FileSize;
+    FreePool(info);
+    if (*FileSize == 0) {
+        uefi_call_wrapper(file->Close, 1, file);
+        return EFI_END_OF_FILE;
+    }
+    Disk->Size = (*FileSize + blockSize - 1) / blockSize * blockSize;
+    Disk->Pages = (Disk->Size + EFI_PAGE_SIZE - 1) >> EFI_PAGE_SHIFT;
+    status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiReservedMemoryType, Disk->Pages, &Disk->Base);
+    if (status != EFI_SUCCESS) {
+        Disk->Base = 0;
+        Disk->Pages = 0;
+        uefi_call_wrapper(file->Close, 1, file);
+        return status;
+    }
+
+    start = perfTimestamp();
+    while (done < *FileSize) {
+        size = *FileSize - done < RAM_DISK_CHUNK ? (UINTN) (*FileSize - done) : RAM_DISK_CHUNK;
+        status = uefi_call_wrapper(file->Read, 3, file, &size, (UINT8 *) (UINTN) Disk->Base + done);
+        if (status == EFI_SUCCESS && size == 0)
+            status = EFI_END_OF_FILE;
+        if (status != EFI_SUCCESS)
+            break;
+        done += size;
+        showProgress(label, done, *FileSize, start);
+        if (escapePressed()) {
+            status = EFI_ABORTED;
+            break;
+        }
+    }
+    uefi_call_wrapper(file->Close, 1, file);
+    Print(L"\n");
+    /* the last block and the rest of the last page read as zeros */
+    if (status == EFI_SUCCESS)
+        ZeroMem((UINT8 *) (UINTN) Disk->Base + *FileSize, (Disk->Pages << EFI_PAGE_SHIFT) - *FileSize);
+    return status;
+}
+
+/*
+ * The partition driver puts the file system of a CD or a partition on a
+ * child of the RAM disk, a superfloppy image has it on the RAM disk itself;
+ * either way its device path starts with the RAM disk's.
+ */
+static EFI_HANDLE findFileSystem(EFI_DEVICE_PATH *DiskPath) {
+    EFI_HANDLE *handles = NULL, found = NULL;
+    EFI_DEVICE_PATH *path;
+    EFI_FILE_HANDLE root;
+    UINTN count = 0, i, prefix = DevicePathSize(DiskPath) - END_DEVICE_PATH_LENGTH;
+
+    if (LibLocateHandle(ByProtocol, &FileSystemProtocol, NULL, &count, &handles) != EFI_SUCCESS)
+        return NULL;
+    for (i = 0; i < count && found == NULL; i++) {
+        path = DevicePathFromHandle(handles[i]);
+        if (path == NULL || DevicePathSize(path) < prefix + END_DEVICE_PATH_LENGTH || CompareMem(path, DiskPath, prefix) != 0)
+            continue;
+        root = LibOpenRoot(handles[i]);
+        if (root == NULL)
+            continue;
+        if (fileExists(root, RAM_DISK_BOOT_FILE))
+            found = handles[i];
+        uefi_call_wrapper(root->Close, 1, root);
+    }
+    if (handles)
+        FreePool(handles);
+    return found;
+}
+
+EFI_STATUS ramDiskLoad(RAM_DISK *Disk, EFI_FILE_HANDLE Root, CHAR16 *FileName) {
+    EFI_GUID ramDiskProtocol = EFI_RAM_DISK_PROTOCOL_GUID;
+    EFI_GUID virtualDisk = EFI_VIRTUAL_DISK_GUID, virtualCd = EFI_VIRTUAL_CD_GUID;
+    EFI_RAM_DISK_PROTOCOL *ramDisk;
+    EFI_DEVICE_PATH *path;
+    EFI_HANDLE device;
+    EFI_STATUS status;
+    UINT64 fileSize;
+    UINTN record;
+
+    ZeroMem(Disk, sizeof(RAM_DISK));
+    /* before reading hundreds of megabytes for nothing */
+    status = LibLocateProtocol(&ramDiskProtocol, (VOID **) &ramDisk);
+    if (status != EFI_SUCCESS) {
+        Print(L"This firmware has no RAM disk support.\n");
+        return status;
+    }
+
+    record = perfBegin(PERF_RAM_DISK_LOAD);
+    status = readImage(Disk, Root, FileName, &fileSize);
+    perfEnd(record);
+    if (status != EFI_SUCCESS)
+        return status;
+
+    status = uefi_call_wrapper(ramDisk->Register, 5, Disk->Base, Disk->Size,
+        hasSuffix(FileName, ISO_SUFFIX) ? &virtualCd : &virtualDisk, NULL, &Disk->DevicePath);
+    if (status != EFI_SUCCESS) {
+        Disk->DevicePath = NULL;
+        return status;
+    }
+    /* the driver connects the RAM disk itself, but not every version does so recursively */
+    path = Disk->DevicePath;
+    if (uefi_call_wrapper(BS->LocateDevicePath, 3, &BlockIoProtocol, &path, &device) == EFI_SUCCESS)
+        uefi_call_wrapper(BS->ConnectController, 4, device, NULL, NULL, TRUE);
+    Disk->FileSystem = findFileSystem(Disk->DevicePath);
+    if (Disk->FileSystem == NULL) {
+        Print(L"No file system with %s on the RAM disk.\n", RAM_DISK_BOOT_FILE);
+        return EFI_NOT_FOUND;
+    }
+    return EFI_SUCCESS;
+}
+
+VOID ramDiskFree(RAM_DISK *Disk) {
+    EFI_GUID ramDiskProtocol = EFI_RAM_DISK_PROTOCOL_GUID;
+    EFI_RAM_DISK_PROTOCOL *ramDisk;
+    EFI_STATUS status = EFI_SUCCESS;
+
+    if (Disk->DevicePath != NULL) {
+        status = LibLocateProtocol(&ramDiskProtocol, (VOID **) &ramDisk);
+        if (status == EFI_SUCCESS)
+            status = uefi_call_wrapper(ramDisk->Unregister, 1, Disk->DevicePath);
+        FreePool(Disk->DevicePath);
+    }
+    /* pages still behind a block device are left alone */
+    if (Disk->Base != 0 && status == EFI_SUCCESS)
+        uefi_call_wrapper(BS->FreePages, 2, Disk->Base, Disk->Pages);
+    ZeroMem(Disk, sizeof(RAM_DISK));
+}
@@ -0,0 +1,85 @@
+/*
+ * grml-plus UEFI tools - boot tool images from a RAM disk
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RAMDISK_H
+#define RAMDISK_H
+
+#include "efiabi.h"
+
+/*
+ * See the UEFI specification (RAM Disk Protocol) for this
+ */
+#define EFI_RAM_DISK_PROTOCOL_GUID { 0xab38a0df, 0x6873, 0x44a9, { 0x87, 0xe6, 0xd4, 0xeb, 0x56, 0x14, 0x84, 0x49 } }
+#define EFI_VIRTUAL_DISK_GUID { 0x77ab535a, 0x45fc, 0x624b, { 0x55, 0x60, 0xf7, 0xb2, 0x81, 0xd1, 0xf9, 0x6e } }
+#define EFI_VIRTUAL_CD_GUID { 0x3d5abd30, 0x4175, 0x87ce, { 0x6d, 0x64, 0xd2, 0xad, 0xe5, 0x23, 0xc4, 0xbb } }
+
+typedef EFI_STATUS (EFIAPI *EFI_RAM_DISK_REGISTER_RAMDISK) (UINT64 RamDiskBase, UINT64 RamDiskSize, EFI_GUID *RamDiskType,
+        EFI_DEVICE_PATH *ParentDevicePath, EFI_DEVICE_PATH **DevicePath);
+typedef EFI_STATUS (EFIAPI *EFI_RAM_DISK_UNREGISTER_RAMDISK) (EFI_DEVICE_PATH *DevicePath);
+
+typedef struct {
+    EFI_RAM_DISK_REGISTER_RAMDISK Register;
+    EFI_RAM_DISK_UNREGISTER_RAMDISK Unregister;
+} EFI_RAM_DISK_PROTOCOL;
+
+/*
+ * Boots a whole disk or CD image from memory.
+ *
+ * ramDiskLoad reads the image file in RAM_DISK_CHUNK sized reads straight
+ * into pages of EfiReservedMemoryType, showing progress and throughput
+ * (Esc cancels), and registers them with the firmware's RAM disk driver, a
+ * .iso as a virtual CD and anything else as a virtual disk. The reserved
+ * type keeps the pages away from an OS that is booted from the RAM disk;
+ * the driver describes them to it in the ACPI NFIT. Then the file system
+ * on the RAM disk that holds RAM_DISK_BOOT_FILE is looked up. From then on
+ * nothing is read from the boot medium any more.
+ *
+ * ramDiskFree unregisters the RAM disk and frees its pages; it is safe to
+ * call on a RAM_DISK that was only partly set up.
+ */
+
+#define RAM_DISK_CHUNK (4 * 1024 * 1024)
+#define RAM_DISK_BOOT_FILE L"\\EFI\\BOOT\\BOOTX64.EFI"
+
+typedef struct {
+    EFI_PHYSICAL_ADDRESS Base;
+    UINTN Pages;
+    UINT64 Size;                    /* registered size, the file rounded up to whole blocks */
+    EFI_DEVICE_PATH *DevicePath;    /* of the RAM disk, from the driver's pool */
+    EFI_HANDLE FileSystem;
+} RAM_DISK;
+
+/* TRUE for .iso and .img files */
+BOOLEAN ramDiskIsImage(CHAR16 *FileName);
+EFI_STATUS ramDiskLoad(RAM_DISK *Disk, EFI_FILE_HANDLE Root, CHAR16 *FileName);
+VOID ramDiskFree(RAM_DISK *Disk);
+
+#endif
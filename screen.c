@@ -0,0 +1,307 @@
+/*
+ * grml-plus UEFI tools - incrementally redrawn text screen
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "font.h"
+#include "screen.h"
+
+static EFI_GUID graphicsOutputProtocol = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
+
+/* the sixteen EFI text colours as 0xRRGGBB */
+static const UINT32 textColors[16] = {
+    0x000000, 0x0000aa, 0x00aa00, 0x00aaaa, 0xaa0000, 0xaa00aa, 0xaa5500, 0xaaaaaa,
+    0x555555, 0x5555ff, 0x55ff55, 0x55ffff, 0xff5555, 0xff55ff, 0xffff55, 0xffffff
+};
+
+static VOID selectMode(UINTN Columns, UINTN Rows) {
+    SIMPLE_TEXT_OUTPUT_INTERFACE *conOut = ST->ConOut;
+    UINTN mode, best = conOut->Mode->Mode, bestCells = (UINTN) -1, cols, rows;
+
+    for (mode = 0; mode < (UINTN) conOut->Mode->MaxMode; mode++) {
+        if (uefi_call_wrapper(conOut->QueryMode, 4, conOut, mode, &cols, &rows) != EFI_SUCCESS)
+            continue;
+        if (cols >= Columns && rows >= Rows && cols * rows < bestCells) {
+            best = mode;
+            bestCells = cols * rows;
+        }
+    }
+    if (best != (UINTN) conOut->Mode->Mode)
+        uefi_call_wrapper(conOut->SetMode, 2, conOut, best);
+}
+
+EFI_STATUS screenInit(SCREEN *Screen, UINTN Columns, UINTN Rows) {
+    UINTN cells;
+
+    ZeroMem(Screen, sizeof(SCREEN));
+    selectMode(Columns, Rows);
+    if (uefi_call_wrapper(ST->ConOut->QueryMode, 4, ST->ConOut, ST->ConOut->Mode->Mode, &Screen->Columns, &Screen->Rows) != EFI_SUCCESS) {
+        Screen->Columns = 80;
+        Screen->Rows = 25;
+    }
+    Screen->Rows--;
+    cells = Screen->Columns * Screen->Rows;
+    Screen->Text = AllocatePool(2 * cells * sizeof(CHAR16));
+    Screen->Attributes = AllocatePool(2 * cells);
+    Screen->Run = AllocatePool((Screen->Columns + 1) * sizeof(CHAR16));
+    if (Screen->Text == NULL || Screen->Attributes == NULL || Screen->Run == NULL) {
+        screenFree(Screen);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Screen->NextText = Screen->Text + cells;
+    Screen->NextAttributes = Screen->Attributes + cells;
+    screenClear(Screen);
+    return EFI_SUCCESS;
+}
+
+VOID screenFree(SCREEN *Screen) {
+    if (Screen->FrameBuffer) {
+        uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+        uefi_call_wrapper(ST->ConOut->EnableCursor, 2, ST->ConOut, TRUE);
+    }
+    if (Screen->Text)
+        FreePool(Screen->Text);
+    if (Screen->Attributes)
+        FreePool(Screen->Attributes);
+    if (Screen->Run)
+        FreePool(Screen->Run);
+    ZeroMem(Screen, sizeof(SCREEN));
+}
+
+VOID screenClear(SCREEN *Screen) {
+    UINTN i;
+
+    for (i = 0; i < Screen->Columns * Screen->Rows; i++) {
+        Screen->NextText[i] = L' ';
+        Screen->NextAttributes[i] = SCREEN_DEFAULT_ATTRIBUTE;
+    }
+}
+
+UINTN screenPrint(SCREEN *Screen, UINTN Column, UINTN Row, UINTN Attribute, CHAR16 *Text) {
+    UINTN cell = Row * Screen->Columns + Column;
+
+    if (Row >= Screen->Rows)
+        return Column;
+    for (; *Text && Column < Screen->Columns; Text++, Column++, cell++) {
+        Screen->NextText[cell] = *Text;
+        Screen->NextAttributes[cell] = (UINT8) Attribute;
+    }
+    return Column;
+}
+
+static VOID setAttribute(SCREEN *Screen, UINTN Attribute) {
+    if (Screen->Attribute != Attribute) {
+        uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, Attribute);
+        Screen->Attribute = Attribute;
+    }
+}
+
+/*
+ * Checks the current GOP mode again, since a started image may have
+ * switched it; returns FALSE if the grid cannot be drawn into it.
+ */
+static BOOLEAN mapFrameBuffer(SCREEN *Screen) {
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *info;
+    UINTN width, height, i;
+    UINT32 color;
+
+    Screen->FrameBuffer = NULL;
+    if (Screen->Gop == NULL || Screen->Gop->Mode == NULL || Screen->Gop->Mode->FrameBufferBase == 0)
+        return FALSE;
+    info = Screen->Gop->Mode->Info;
+    if (info->PixelFormat != PixelRedGreenBlueReserved8BitPerColor &&
+            info->PixelFormat != PixelBlueGreenRedReserved8BitPerColor)
+        return FALSE;
+    width = Screen->Columns * FONT_CELL_WIDTH;
+    height = (Screen->Rows + 1) * FONT_CELL_HEIGHT;
+    if (width > info->HorizontalResolution || height > info->VerticalResolution)
+        return FALSE;
+
+    for (i = 0; i < 16; i++) {
+        color = textColors[i];
+        if (info->PixelFormat == PixelRedGreenBlueReserved8BitPerColor)
+            color = ((color & 0xff) << 16) | (color & 0xff00) | (color >> 16);
+        Screen->Palette[i] = color;
+    }
+    Screen->PixelsPerScanLine = info->PixelsPerScanLine;
+    Screen->OriginX = (info->HorizontalResolution - width) / 2;
+    Screen->OriginY = (info->VerticalResolution - height) / 2;
+    Screen->FrameBuffer = (UINT32 *) (UINTN) Screen->Gop->Mode->FrameBufferBase;
+    return TRUE;
+}
+
+/* writes whole 64 bit words (two pixels) wherever the scan line allows it */
+static VOID fillRect(SCREEN *Screen, UINTN X, UINTN Y, UINTN Width, UINTN Height, UINT32 Color) {
+    UINT64 wide = ((UINT64) Color << 32) | Color;
+    UINT32 *line = Screen->FrameBuffer + Y * Screen->PixelsPerScanLine + X, *pixel, *end;
+    UINT64 *word;
+
+    for (; Height > 0; Height--, line += Screen->PixelsPerScanLine) {
+        pixel = line;
+        end = line + Width;
+        if (((UINTN) pixel & 7) != 0 && pixel < end)
+            *pixel++ = Color;
+        for (word = (UINT64 *) pixel; (UINT32 *) (word + 1) <= end; word++)
+            *word = wide;
+        pixel = (UINT32 *) word;
+        if (pixel < end)
+            *pixel = Color;
+    }
+}
+
+static VOID drawGlyph(SCREEN *Screen, UINTN Column, UINTN Row, CHAR16 Char, UINT32 Color) {
+    UINTN pitch = Screen->PixelsPerScanLine, x, y;
+    UINT32 *pixel;
+    const UINT8 *glyph;
+
+    if (Char == L' ')
+        return;
+    if (Char < FONT_FIRST || Char > FONT_LAST)
+        Char = L'?';
+    glyph = fontGlyphs[Char - FONT_FIRST];
+    pixel = Screen->FrameBuffer + (Screen->OriginY + Row * FONT_CELL_HEIGHT + 1) * pitch +
+            Screen->OriginX + Column * FONT_CELL_WIDTH + 1;
+    for (y = 0; y < FONT_GLYPH_ROWS; y++, pixel += 2 * pitch) {
+        for (x = 0; x < FONT_GLYPH_WIDTH; x++) {
+            if (glyph[y] & (1 << (FONT_GLYPH_WIDTH - 1 - x))) {
+                pixel[x] = Color;
+                pixel[x + pitch] = Color;
+            }
+        }
+    }
+}
+
+/* the damaged rectangle is cells First to Last of Row */
+static VOID drawLine(SCREEN *Screen, UINTN Row, UINTN First, UINTN Last) {
+    UINTN line = Row * Screen->Columns, attribute, i, end;
+
+    for (i = First; i <= Last; i = end) {
+        attribute = Screen->NextAttributes[line + i];
+        for (end = i; end <= Last && Screen->NextAttributes[line + end] == attribute; end++)
+            ;
+        fillRect(Screen, Screen->OriginX + i * FONT_CELL_WIDTH, Screen->OriginY + Row * FONT_CELL_HEIGHT,
+                 (end - i) * FONT_CELL_WIDTH, FONT_CELL_HEIGHT, Screen->Palette[(attribute >> 4) & 7]);
+        for (; i < end; i++)
+            drawGlyph(Screen, i, Row, Screen->NextText[line + i], Screen->Palette[attribute & 15]);
+    }
+}
+
+static VOID writeLine(SCREEN *Screen, UINTN Row, UINTN First, UINTN Last) {
+    UINTN line = Row * Screen->Columns, i, end;
+
+    uefi_call_wrapper(ST->ConOut->SetCursorPosition, 3, ST->ConOut, First, Row);
+    for (i = First; i <= Last; i = end) {
+        for (end = i; end <= Last && Screen->NextAttributes[line + end] == Screen->NextAttributes[line + i]; end++)
+            Screen->Run[end - i] = Screen->NextText[line + end];
+        Screen->Run[end - i] = L'\0';
+        setAttribute(Screen, Screen->NextAttributes[line + i]);
+        uefi_call_wrapper(ST->ConOut->OutputString, 2, ST->ConOut, Screen->Run);
+    }
+}
+
+VOID screenFlush(SCREEN *Screen, UINTN CursorColumn, UINTN CursorRow) {
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *info;
+    UINTN row, first, last, i, line;
+    UINT64 ticks;
+
+    if (Screen->Text == NULL)
+        return;
+    if (!Screen->Valid) {
+        if (Screen->FrameBuffer != NULL && mapFrameBuffer(Screen)) {
+            info = Screen->Gop->Mode->Info;
+            fillRect(Screen, 0, 0, info->HorizontalResolution, info->VerticalResolution, Screen->Palette[0]);
+        } else {
+            Screen->Attribute = (UINTN) -1;
+            setAttribute(Screen, SCREEN_DEFAULT_ATTRIBUTE);
+            uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+        }
+        uefi_call_wrapper(ST->ConOut->EnableCursor, 2, ST->ConOut, Screen->FrameBuffer == NULL);
+        for (i = 0; i < Screen->Columns * Screen->Rows; i++) {
+            Screen->Text[i] = L' ';
+            Screen->Attributes[i] = SCREEN_DEFAULT_ATTRIBUTE;
+        }
+        Screen->Valid = TRUE;
+    }
+
+    for (row = 0; row < Screen->Rows; row++) {
+        line = row * Screen->Columns;
+        for (first = 0; first < Screen->Columns; first++) {
+            if (Screen->Text[line + first] != Screen->NextText[line + first] ||
+                    Screen->Attributes[line + first] != Screen->NextAttributes[line + first])
+                break;
+        }
+        if (first == Screen->Columns)
+            continue;
+        for (last = Screen->Columns - 1; last > first; last--) {
+            if (Screen->Text[line + last] != Screen->NextText[line + last] ||
+                    Screen->Attributes[line + last] != Screen->NextAttributes[line + last])
+                break;
+        }
+
+        if (Screen->FrameBuffer != NULL)
+            drawLine(Screen, row, first, last);
+        else
+            writeLine(Screen, row, first, last);
+        CopyMem(Screen->Text + line + first, Screen->NextText + line + first, (last - first + 1) * sizeof(CHAR16));
+        CopyMem(Screen->Attributes + line + first, Screen->NextAttributes + line + first, last - first + 1);
+    }
+    if (Screen->FrameBuffer == NULL)
+        uefi_call_wrapper(ST->ConOut->SetCursorPosition, 3, ST->ConOut, CursorColumn, CursorRow);
+
+    if (Screen->KeyTsc != 0) {
+        ticks = perfTimestamp() - Screen->KeyTsc;
+        if (ticks > Screen->MaxKeyTicks)
+            Screen->MaxKeyTicks = ticks;
+        perfTally(PERF_KEY_TO_PAINT, Screen->KeyTsc);
+        Screen->KeyTsc = 0;
+    }
+}
+
+VOID screenInvalidate(SCREEN *Screen) {
+    Screen->Valid = FALSE;
+}
+
+VOID screenKeyPressed(SCREEN *Screen, UINT64 KeyTsc) {
+    Screen->KeyTsc = KeyTsc;
+}
+
+BOOLEAN screenUseGraphics(SCREEN *Screen, BOOLEAN Enable) {
+    if (Enable && Screen->Gop == NULL)
+        LibLocateProtocol(&graphicsOutputProtocol, (VOID **) &Screen->Gop);
+    if (Enable)
+        mapFrameBuffer(Screen);
+    else
+        Screen->FrameBuffer = NULL;
+    Screen->Valid = FALSE;
+    return Screen->FrameBuffer != NULL;
+}
@@ -0,0 +1,87 @@
+/*
+ * grml-plus UEFI tools - incrementally redrawn text screen
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+/*
+ * Menus are composed into a shadow copy of the console (screenClear and
+ * screenPrint) and screenFlush only sends what differs from the previous
+ * frame: each changed line is rewritten from its first to its last changed
+ * cell, with one SetAttribute and one OutputString per run of cells in the
+ * same colour. On serial consoles and slow GOP text drivers, moving the
+ * highlight therefore repaints two lines instead of the whole screen.
+ *
+ * The last console row is never written, so output cannot scroll.
+ *
+ * With screenUseGraphics the same grid is drawn straight into the GOP
+ * framebuffer with the built-in font instead, centered on the screen:
+ * backgrounds are filled 64 bits at a time and only the damaged rectangle
+ * of each changed line is touched. Only linear 32 bit RGB and BGR
+ * framebuffers are used; without one the screen stays on ConOut.
+ */
+
+#define SCREEN_DEFAULT_ATTRIBUTE EFI_LIGHTGRAY
+
+typedef struct {
+    UINTN Columns;
+    UINTN Rows;
+    CHAR16 *Text;         /* what is on the console */
+    UINT8 *Attributes;
+    CHAR16 *NextText;     /* the frame being composed */
+    UINT8 *NextAttributes;
+    CHAR16 *Run;
+    UINTN Attribute;      /* current console attribute */
+    BOOLEAN Valid;        /* FALSE if somebody else wrote to the console */
+    UINT64 KeyTsc;        /* when the key being answered was pressed */
+    UINT64 MaxKeyTicks;
+    EFI_GRAPHICS_OUTPUT_PROTOCOL *Gop;
+    UINT32 *FrameBuffer;  /* NULL when drawing through ConOut */
+    UINTN PixelsPerScanLine;
+    UINTN OriginX, OriginY;
+    UINT32 Palette[16];
+} SCREEN;
+
+/* switches to the console mode with the fewest cells of at least Columns x Rows */
+EFI_STATUS screenInit(SCREEN *Screen, UINTN Columns, UINTN Rows);
+VOID screenFree(SCREEN *Screen);
+VOID screenClear(SCREEN *Screen);
+/* returns the column after the text; text beyond the right edge is cut */
+UINTN screenPrint(SCREEN *Screen, UINTN Column, UINTN Row, UINTN Attribute, CHAR16 *Text);
+VOID screenFlush(SCREEN *Screen, UINTN CursorColumn, UINTN CursorRow);
+/* the next flush clears the console and repaints everything */
+VOID screenInvalidate(SCREEN *Screen);
+/* call right after reading a key pressed at KeyTsc; the next flush records the key-to-paint latency */
+VOID screenKeyPressed(SCREEN *Screen, UINT64 KeyTsc);
+/* returns whether the framebuffer renderer is active afterwards */
+BOOLEAN screenUseGraphics(SCREEN *Screen, BOOLEAN Enable);
+
+#endif
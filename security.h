@@ -0,0 +1,61 @@
+/*
+ * grml-plus UEFI tools - shared security policy override
+ *
+ * Copyright 2014, 2017 Michael Schierl <schierlm@gmx.de>
+ *
+ * Based on the Linux Foundation's PreLoader, which is
+ *
+ * Copyright 2012 <James.Bottomley@HansenPartnership.com>
+ *
+ * Licensed under version 2 of the GNU General Public Licence.
+ *
+ * For details see <http://git.kernel.org/cgit/linux/kernel/git/jejb/efitools.git/tree/COPYING>
+ */
+
+#ifndef SECURITY_H
+#define SECURITY_H
+
+#include "efiabi.h"
+
+#ifndef EFI_SECURITY_VIOLATION
+#define EFI_SECURITY_VIOLATION EFIERR(26)
+#endif
+
+extern EFI_GUID SECURITY_PROTOCOL_GUID;
+extern EFI_GUID SECURITY2_PROTOCOL_GUID;
+
+/*
+ * See the UEFI Platform Initialization manual (Vol2: DXE) for this
+ */
+struct _EFI_SECURITY2_PROTOCOL;
+struct _EFI_SECURITY_PROTOCOL;
+typedef struct _EFI_SECURITY2_PROTOCOL EFI_SECURITY2_PROTOCOL;
+typedef struct _EFI_SECURITY_PROTOCOL EFI_SECURITY_PROTOCOL;
+typedef EFI_DEVICE_PATH EFI_DEVICE_PATH_PROTOCOL;
+typedef EFI_STATUS (EFIAPI *EFI_SECURITY_FILE_AUTHENTICATION_STATE) (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
+        const EFI_DEVICE_PATH_PROTOCOL *File);
+typedef EFI_STATUS (EFIAPI *EFI_SECURITY2_FILE_AUTHENTICATION) (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy);
+
+struct _EFI_SECURITY2_PROTOCOL {
+    EFI_SECURITY2_FILE_AUTHENTICATION FileAuthentication;
+};
+
+struct _EFI_SECURITY_PROTOCOL {
+    EFI_SECURITY_FILE_AUTHENTICATION_STATE  FileAuthenticationState;
+};
+
+/* the original firmware policy, while the override is installed */
+extern EFI_SECURITY_FILE_AUTHENTICATION_STATE esfas;
+extern EFI_SECURITY2_FILE_AUTHENTICATION es2fa;
+
+/* the override itself, provided by each tool */
+EFI_STATUS EFI_CALLBACK security_policy_authentication(const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
+        const EFI_DEVICE_PATH_PROTOCOL *DevicePathConst);
+EFI_STATUS EFI_CALLBACK security2_policy_authentication(const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy);
+
+EFI_STATUS security_policy_install(void);
+EFI_STATUS security_policy_uninstall(void);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * grml-plus UEFI tools - SHA-256
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+#include <cpuid.h>
+#include <immintrin.h>
+
+#include "sha256.h"
+
+typedef VOID (*SHA256_BLOCKS)(UINT32 *State, const UINT8 *Data, UINTN Blocks);
+
+static const UINT32 roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const UINT32 initialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static VOID scalarBlocks(UINT32 *State, const UINT8 *Data, UINTN Blocks) {
+    UINT32 w[64], a, b, c, d, e, f, g, h, t1, t2;
+    UINTN i;
+
+    for (; Blocks > 0; Blocks--, Data += 64) {
+        for (i = 0; i < 16; i++)
+            w[i] = (UINT32) Data[4 * i] << 24 | (UINT32) Data[4 * i + 1] << 16 | (UINT32) Data[4 * i + 2] << 8 | Data[4 * i + 3];
+        for (i = 16; i < 64; i++)
+            w[i] = w[i - 16] + (ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+                   w[i - 7] + (ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+        a = State[0]; b = State[1]; c = State[2]; d = State[3];
+        e = State[4]; f = State[5]; g = State[6]; h = State[7];
+        for (i = 0; i < 64; i++) {
+            t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + roundConstants[i] + w[i];
+            t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        State[0] += a; State[1] += b; State[2] += c; State[3] += d;
+        State[4] += e; State[5] += f; State[6] += g; State[7] += h;
+    }
+}
+
+/*
+ * Four rounds with the message words in Msg: sha256rnds2 does two rounds on
+ * the low half of its message operand, so the high half is moved down for
+ * the second call.
+ */
+#define SHANI_ROUNDS(Msg, Index) do { \
+        __m128i wk = _mm_add_epi32(Msg, _mm_loadu_si128((const __m128i *) &roundConstants[Index])); \
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk); \
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e)); \
+    } while (0)
+
+/* the next four message words from the previous sixteen, kept in m0 to m3 */
+#define SHANI_SCHEDULE(m0, m1, m2, m3) \
+    m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)), m3)
+
+__attribute__((target("sha,sse4.1")))
+static VOID shaNiBlocks(UINT32 *State, const UINT8 *Data, UINTN Blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i abef, cdgh, abefSaved, cdghSaved, m0, m1, m2, m3, tmp;
+    UINTN i;
+
+    /* the instructions want the state as ABEF and CDGH */
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &State[0]), 0xb1);  /* CDAB */
+    cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &State[4]), 0x1b); /* EFGH */
+    abef = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+    for (; Blocks > 0; Blocks--, Data += 64) {
+        abefSaved = abef;
+        cdghSaved = cdgh;
+
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (Data + 0)), byteSwap);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (Data + 16)), byteSwap);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (Data + 32)), byteSwap);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (Data + 48)), byteSwap);
+        SHANI_ROUNDS(m0, 0);
+        SHANI_ROUNDS(m1, 4);
+        SHANI_ROUNDS(m2, 8);
+        SHANI_ROUNDS(m3, 12);
+        for (i = 16; i < 64; i += 16) {
+            SHANI_SCHEDULE(m0, m1, m2, m3);
+            SHANI_ROUNDS(m0, i);
+            SHANI_SCHEDULE(m1, m2, m3, m0);
+            SHANI_ROUNDS(m1, i + 4);
+            SHANI_SCHEDULE(m2, m3, m0, m1);
+            SHANI_ROUNDS(m2, i + 8);
+            SHANI_SCHEDULE(m3, m0, m1, m2);
+            SHANI_ROUNDS(m3, i + 12);
+        }
+
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    tmp = _mm_shuffle_epi32(abef, 0x1b);  /* FEBA */
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1); /* DCHG */
+    _mm_storeu_si128((__m128i *) &State[0], _mm_blend_epi16(tmp, cdgh, 0xf0));
+    _mm_storeu_si128((__m128i *) &State[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+static VOID sha256Run(SHA256_BLOCKS Blocks, const VOID *Data, UINTN Size, UINT8 *Digest) {
+    UINT32 state[8];
+    UINT8 tail[128];
+    UINTN full = Size / 64, rest = Size % 64, tailSize, i;
+    UINT64 bits = (UINT64) Size * 8;
+
+    CopyMem(state, (VOID *) initialState, sizeof(state));
+    Blocks(state, Data, full);
+
+    /* padding: 0x80, zeros, and the length in bits, in one or two blocks */
+    tailSize = rest < 56 ? 64 : 128;
+    ZeroMem(tail, tailSize);
+    CopyMem(tail, (const UINT8 *) Data + full * 64, rest);
+    tail[rest] = 0x80;
+    for (i = 0; i < 8; i++)
+        tail[tailSize - 1 - i] = (UINT8) (bits >> (8 * i));
+    Blocks(state, tail, tailSize / 64);
+
+    for (i = 0; i < 8; i++) {
+        Digest[4 * i] = (UINT8) (state[i] >> 24);
+        Digest[4 * i + 1] = (UINT8) (state[i] >> 16);
+        Digest[4 * i + 2] = (UINT8) (state[i] >> 8);
+        Digest[4 * i + 3] = (UINT8) state[i];
+    }
+}
+
+BOOLEAN sha256HaveShaNi(VOID) {
+    static INTN haveShaNi = -1;
+    UINT32 eax, ebx, ecx, edx;
+
+    if (haveShaNi < 0) {
+        haveShaNi = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) && (ecx & bit_SSSE3) &&
+                __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA))
+            haveShaNi = 1;
+    }
+    return haveShaNi;
+}
+
+VOID sha256Scalar(const VOID *Data, UINTN Size, UINT8 *Digest) {
+    sha256Run(scalarBlocks, Data, Size, Digest);
+}
+
+VOID sha256ShaNi(const VOID *Data, UINTN Size, UINT8 *Digest) {
+    sha256Run(shaNiBlocks, Data, Size, Digest);
+}
+
+VOID sha256(const VOID *Data, UINTN Size, UINT8 *Digest) {
+    sha256Run(sha256HaveShaNi() ? shaNiBlocks : scalarBlocks, Data, Size, Digest);
+}
@@ -16,268 +16,429 @@
 #include <efilib.h>
 #include <efierr.h>
 
-#ifndef EFI_SECURITY_VIOLATION
-#define EFI_SECURITY_VIOLATION EFIERR(26)
-#endif
-
-EFI_GUID SECURITY_PROTOCOL_GUID = { 0xA46423E3, 0x4617, 0x49f1, {0xB9, 0xFF, 0xD1, 0xBF, 0xA9, 0x11, 0x58, 0x39 } };
-EFI_GUID SECURITY2_PROTOCOL_GUID = { 0x94ab2f58, 0x1438, 0x4ef1, {0x91, 0x52, 0x18, 0x94, 0x1a, 0x3a, 0x0e, 0x68 } };
+#include "bootperf.h"
+#include "efiabi.h"
+#include "security.h"
+#include "common.h"
+#include "pecoff.h"
+#include "arena.h"
+#include "sha256.h"
+#include "allowlist.h"
+
+/* options from skipsign.cfg */
+#define MAX_BENCH_FILES 8
+#define VALIDATE_BENCH_ROUNDS 100
+#define FIRMWARE_BENCH_ROUNDS 3
+#define HASH_BENCH_ROUNDS 10
+#define LOOKUP_BENCH_ROUNDS 10000
+
+static BOOLEAN validateImages = FALSE;
+static CHAR16 *benchFiles[MAX_BENCH_FILES];
+static UINTN benchFileCount = 0;
+static ARENA arena;
+
+/* SHA-256 digests of the images that may be started in allowlist mode */
+static BOOLEAN allowlistMode = FALSE;
+static ALLOWLIST allowlist;
 
 /*
- * See the UEFI Platform Initialization manual (Vol2: DXE) for this
+ * GRUB loads lots of modules through LoadImage, and for every one of them the
+ * original policy hashes the whole image only for us to ignore the result.
+ * Accepted verdicts are therefore cached, keyed by device path and a cheap
+ * fingerprint (size, head, tail and some samples in between) of the image.
+ * Errors other than the overridden ones are never cached.
  */
-struct _EFI_SECURITY2_PROTOCOL;
-struct _EFI_SECURITY_PROTOCOL;
-typedef struct _EFI_SECURITY2_PROTOCOL EFI_SECURITY2_PROTOCOL;
-typedef struct _EFI_SECURITY_PROTOCOL EFI_SECURITY_PROTOCOL;
-typedef EFI_DEVICE_PATH EFI_DEVICE_PATH_PROTOCOL;
-typedef EFI_STATUS (EFIAPI *EFI_SECURITY_FILE_AUTHENTICATION_STATE) (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
-        const EFI_DEVICE_PATH_PROTOCOL *File);
-typedef EFI_STATUS (EFIAPI *EFI_SECURITY2_FILE_AUTHENTICATION) (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
-        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy);
-
-struct _EFI_SECURITY2_PROTOCOL {
-    EFI_SECURITY2_FILE_AUTHENTICATION FileAuthentication;
-};
-
-struct _EFI_SECURITY_PROTOCOL {
-    EFI_SECURITY_FILE_AUTHENTICATION_STATE  FileAuthenticationState;
-};
-
-static EFI_SECURITY_FILE_AUTHENTICATION_STATE esfas = NULL;
-static EFI_SECURITY2_FILE_AUTHENTICATION es2fa = NULL;
-
-static EFI_STATUS thunk_security_policy_authentication(const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
-        const EFI_DEVICE_PATH_PROTOCOL *DevicePath)
-__attribute__((unused));
-
-static EFI_STATUS thunk_security2_policy_authentication(const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
-        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy)
-__attribute__((unused));
-
-static __attribute__((used)) EFI_STATUS security2_policy_authentication (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+#define VERDICT_CACHE_SIZE 64
+#define FINGERPRINT_EDGE 4096
+#define FINGERPRINT_SAMPLES 32
+#define FINGERPRINT_SAMPLE_SIZE 64
+
+typedef struct {
+    UINT64 PathHash;
+    UINT64 Fingerprint;
+    UINT64 FileSize;
+    UINT32 AuthenticationStatus;
+    BOOLEAN Valid;
+} VERDICT;
+
+static VERDICT verdictCache[VERDICT_CACHE_SIZE];
+static UINTN verdictNext = 0;
+static UINT64 verdictStats[2] = {0, 0}; /* hits, misses */
+
+static UINT64 fnv1a(UINT64 hash, const VOID *data, UINTN size) {
+    const UINT8 *p = data;
+
+    while (size--) {
+        hash ^= *p++;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static UINT64 devicePathHash(const EFI_DEVICE_PATH_PROTOCOL *DevicePath) {
+    if (DevicePath == NULL)
+        return 0;
+    return fnv1a(0xcbf29ce484222325ULL, DevicePath, DevicePathSize((EFI_DEVICE_PATH *) DevicePath));
+}
+
+static UINT64 imageFingerprint(const UINT8 *FileBuffer, UINTN FileSize) {
+    UINT64 hash = fnv1a(0xcbf29ce484222325ULL, &FileSize, sizeof(FileSize));
+    UINTN i, step;
+
+    if (FileBuffer == NULL)
+        return hash;
+    if (FileSize <= 2 * FINGERPRINT_EDGE)
+        return fnv1a(hash, FileBuffer, FileSize);
+
+    hash = fnv1a(hash, FileBuffer, FINGERPRINT_EDGE);
+    hash = fnv1a(hash, FileBuffer + FileSize - FINGERPRINT_EDGE, FINGERPRINT_EDGE);
+    step = (FileSize - 2 * FINGERPRINT_EDGE) / FINGERPRINT_SAMPLES;
+    if (step >= FINGERPRINT_SAMPLE_SIZE) {
+        for (i = 0; i < FINGERPRINT_SAMPLES; i++)
+            hash = fnv1a(hash, FileBuffer + FINGERPRINT_EDGE + i * step, FINGERPRINT_SAMPLE_SIZE);
+    } else {
+        hash = fnv1a(hash, FileBuffer + FINGERPRINT_EDGE, FileSize - 2 * FINGERPRINT_EDGE);
+    }
+    return hash;
+}
+
+/* a variable write costs more than the checks the cache saves, so this only runs around StartImage */
+static VOID publishVerdictStats(void) {
+    EFI_GUID bootPerfGUID = BOOTPERF_VARIABLE_GUID;
+
+    uefi_call_wrapper(RT->SetVariable, 5, L"SkipSignVerdictCache", &bootPerfGUID,
+        EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS, sizeof(verdictStats), verdictStats);
+}
+
+static BOOLEAN verdictCached(UINT64 PathHash, UINT64 Fingerprint, UINT64 FileSize, UINT32 AuthenticationStatus) {
+    UINTN i;
+
+    for (i = 0; i < VERDICT_CACHE_SIZE; i++) {
+        if (verdictCache[i].Valid && verdictCache[i].PathHash == PathHash && verdictCache[i].Fingerprint == Fingerprint &&
+                verdictCache[i].FileSize == FileSize && verdictCache[i].AuthenticationStatus == AuthenticationStatus) {
+            verdictStats[0]++;
+            return TRUE;
+        }
+    }
+    verdictStats[1]++;
+    return FALSE;
+}
+
+static VOID verdictStore(UINT64 PathHash, UINT64 Fingerprint, UINT64 FileSize, UINT32 AuthenticationStatus) {
+    verdictCache[verdictNext].PathHash = PathHash;
+    verdictCache[verdictNext].Fingerprint = Fingerprint;
+    verdictCache[verdictNext].FileSize = FileSize;
+    verdictCache[verdictNext].AuthenticationStatus = AuthenticationStatus;
+    verdictCache[verdictNext].Valid = TRUE;
+    verdictNext = (verdictNext + 1) % VERDICT_CACHE_SIZE;
+}
+
+static BOOLEAN allowlisted(const VOID *FileBuffer, UINTN FileSize) {
+    UINT8 digest[SHA256_DIGEST_SIZE];
+    UINT64 start = perfTimestamp();
+
+    sha256(FileBuffer, FileSize, digest);
+    perfTally(PERF_IMAGE_HASH, start);
+    return allowlistContains(&allowlist, digest);
+}
+
+__attribute__((used)) EFI_STATUS EFI_CALLBACK security2_policy_authentication (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
         VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy) {
     EFI_STATUS status;
+    UINT64 pathHash, fingerprint;
+
+    /*
+     * listed images are accepted, all others get the firmware's verdict;
+     * the verdict cache is bypassed since its fingerprint only samples the image
+     */
+    if (allowlistMode) {
+        if (FileBuffer != NULL && allowlisted(FileBuffer, FileSize))
+            return EFI_SUCCESS;
+        return uefi_call_wrapper(es2fa, 5, This, DevicePath, FileBuffer, FileSize, BootPolicy);
+    }
+
+    /* well-formed images are accepted anyway, so there is no need to have them hashed */
+    if (validateImages && FileBuffer != NULL)
+        return peValidate(FileBuffer, FileSize) == EFI_SUCCESS ? EFI_SUCCESS : EFI_ACCESS_DENIED;
+
+    pathHash = devicePathHash(DevicePath);
+    fingerprint = imageFingerprint(FileBuffer, FileSize);
+    if (verdictCached(pathHash, fingerprint, FileSize, 0))
+        return EFI_SUCCESS;
 
     status = uefi_call_wrapper(es2fa, 5, This, DevicePath, FileBuffer, FileSize, BootPolicy);
 
     if (status == EFI_SECURITY_VIOLATION || status == EFI_ACCESS_DENIED)
         status = EFI_SUCCESS;
 
+    if (status == EFI_SUCCESS)
+        verdictStore(pathHash, fingerprint, FileSize, 0);
+
     return status;
 }
 
-static __attribute__((used)) EFI_STATUS security_policy_authentication (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
+__attribute__((used)) EFI_STATUS EFI_CALLBACK security_policy_authentication (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
         const EFI_DEVICE_PATH_PROTOCOL *DevicePathConst) {
     EFI_STATUS status;
+    /* no content available here; the fingerprint ~0 keeps these apart from Security2 entries */
+    UINT64 pathHash = devicePathHash(DevicePathConst);
+
+    if (allowlistMode)
+        return uefi_call_wrapper(esfas, 3, This, AuthenticationStatus, DevicePathConst);
+
+    if (verdictCached(pathHash, ~0ULL, 0, AuthenticationStatus))
+        return EFI_SUCCESS;
 
     status = uefi_call_wrapper(esfas, 3, This, AuthenticationStatus, DevicePathConst);
 
     if (status == EFI_SECURITY_VIOLATION || status == EFI_ACCESS_DENIED)
         status = EFI_SUCCESS;
 
+    if (status == EFI_SUCCESS)
+        verdictStore(pathHash, ~0ULL, 0, AuthenticationStatus);
+
     return status;
 }
 
+static VOID *readFile(EFI_FILE_HANDLE root, CHAR16 *pathname, UINTN *size) {
+    EFI_FILE_HANDLE file;
+    EFI_FILE_INFO *info;
+    VOID *data = NULL;
+
+    if (uefi_call_wrapper(root->Open, 5, root, &file, pathname, EFI_FILE_MODE_READ, 0) != EFI_SUCCESS)
+        return NULL;
+    info = LibFileInfo(file);
+    if (info != NULL) {
+        *size = info->FileSize;
+        data = AllocatePool(*size + 1);
+        if (data != NULL && uefi_call_wrapper(file->Read, 3, file, size, data) != EFI_SUCCESS) {
+            FreePool(data);
+            data = NULL;
+        }
+        FreePool(info);
+    }
+    uefi_call_wrapper(file->Close, 1, file);
+    return data;
+}
 
-/* Nasty: ELF and EFI have different calling conventions.  Here is the map for
- * calling ELF -> EFI
- *
- *   1) rdi -> rcx (32 saved)
- *   2) rsi -> rdx (32 saved)
- *   3) rdx -> r8 ( 32 saved)
- *   4) rcx -> r9 (32 saved)
- *   5) r8 -> 32(%rsp) (48 saved)
- *   6) r9 -> 40(%rsp) (48 saved)
- *   7) pad+0(%rsp) -> 48(%rsp) (64 saved)
- *   8) pad+8(%rsp) -> 56(%rsp) (64 saved)
- *   9) pad+16(%rsp) -> 64(%rsp) (80 saved)
- *  10) pad+24(%rsp) -> 72(%rsp) (80 saved)
- *  11) pad+32(%rsp) -> 80(%rsp) (96 saved)
-
- *
- * So for a five argument callback, the map is ignore the first two arguments
- * and then map (EFI -> ELF) assuming pad = 0.
- *
- * ARG4  -> ARG1
- * ARG3  -> ARG2
- * ARG5  -> ARG3
- * ARG6  -> ARG4
- * ARG11 -> ARG5
+/*
+ * skipsign.cfg (next to skipsign.efi) holds one option per line:
  *
- * Calling conventions also differ over volatile and preserved registers in
- * MS: RBX, RBP, RDI, RSI, R12, R13, R14, and R15 are considered nonvolatile .
- * In ELF: Registers %rbp, %rbx and %r12 through %r15 “belong” to the calling
- * function and the called function is required to preserve their values.
+ *   validate       accept well-formed images without asking the firmware,
+ *                  reject malformed ones
+ *   bench <file>   time validation against the firmware policy for <file>
+ *   allowlist <file>
+ *                  accept only images whose SHA-256 is listed in <file>
+ *                  (sha256sum output or an index built by
+ *                  tools/allowlist-index), leave all others to the firmware
  *
- * This means when accepting a function callback from MS -> ELF, we have to do
- * separate preservation on %rdi, %rsi before swizzling the arguments and
- * handing off to the ELF function.
+ * File names are relative to skipsign.efi unless they start with a backslash.
  */
-
-asm (
-".type security2_policy_authentication,@function\n"
-"thunk_security2_policy_authentication:\n\t"
-    "mov    0x28(%rsp), %r10    # ARG5\n\t"
-    "push    %rdi\n\t"
-    "push    %rsi\n\t"
-    "mov    %r10, %rdi\n\t"
-    "subq    $8, %rsp    # space for storing stack pad\n\t"
-    "mov    $0x08, %rax\n\t"
-    "mov    $0x10, %r10\n\t"
-    "and    %rsp, %rax\n\t"
-    "cmovnz    %rax, %r11\n\t"
-    "cmovz    %r10, %r11\n\t"
-    "subq    %r11, %rsp\n\t"
-    "addq    $8, %r11\n\t"
-    "mov    %r11, (%rsp)\n\t"
-"# five argument swizzle\n\t"
-    "mov    %rdi, %r10\n\t"
-    "mov    %rcx, %rdi\n\t"
-    "mov    %rdx, %rsi\n\t"
-    "mov    %r8, %rdx\n\t"
-    "mov    %r9, %rcx\n\t"
-    "mov    %r10, %r8\n\t"
-    "callq    security2_policy_authentication@PLT\n\t"
-    "mov    (%rsp), %r11\n\t"
-    "addq    %r11, %rsp\n\t"
-    "pop    %rsi\n\t"
-    "pop    %rdi\n\t"
-    "ret\n"
-);
-
-asm (
-".type security_policy_authentication,@function\n"
-"thunk_security_policy_authentication:\n\t"
-    "push    %rdi\n\t"
-    "push    %rsi\n\t"
-    "subq    $8, %rsp    # space for storing stack pad\n\t"
-    "mov    $0x08, %rax\n\t"
-    "mov    $0x10, %r10\n\t"
-    "and    %rsp, %rax\n\t"
-    "cmovnz    %rax, %r11\n\t"
-    "cmovz    %r10, %r11\n\t"
-    "subq    %r11, %rsp\n\t"
-    "addq    $8, %r11\n\t"
-    "mov    %r11, (%rsp)\n\t"
-"# three argument swizzle\n\t"
-    "mov    %rcx, %rdi\n\t"
-    "mov    %rdx, %rsi\n\t"
-    "mov    %r8, %rdx\n\t"
-    "callq    security_policy_authentication@PLT\n\t"
-    "mov    (%rsp), %r11\n\t"
-    "addq    %r11, %rsp\n\t"
-    "pop    %rsi\n\t"
-    "pop    %rdi\n\t"
-    "ret\n"
-);
-
-EFI_STATUS security_policy_install(void) {
-    EFI_SECURITY_PROTOCOL *security_protocol;
-    EFI_SECURITY2_PROTOCOL *security2_protocol = NULL;
-    EFI_STATUS status;
-
-    if (esfas)
-        /* Already Installed */
-        return EFI_ALREADY_STARTED;
-
-    /* Don't bother with status here.  The call is allowed
-     * to fail, since SECURITY2 was introduced in PI 1.2.1
-     * If it fails, use security2_protocol == NULL as indicator */
-    LibLocateProtocol(&SECURITY2_PROTOCOL_GUID, &security2_protocol);
-
-    status = LibLocateProtocol(&SECURITY_PROTOCOL_GUID, &security_protocol);
-    if (status != EFI_SUCCESS)
-        /* This one is mandatory, so there's a serious problem */
-        return status;
-
-    if (security2_protocol) {
-        es2fa = security2_protocol->FileAuthentication;
-        security2_protocol->FileAuthentication = thunk_security2_policy_authentication;
-        /* check for security policy in write protected memory */
-        if (security2_protocol->FileAuthentication != thunk_security2_policy_authentication)
-            return EFI_ACCESS_DENIED;
-    }
-
-    esfas = security_protocol->FileAuthenticationState;
-    security_protocol->FileAuthenticationState = thunk_security_policy_authentication;
-    /* check for security policy in write protected memory */
-    if (security_protocol->FileAuthenticationState != thunk_security_policy_authentication)
-        return EFI_ACCESS_DENIED;
-
-    return EFI_SUCCESS;
+static CHAR16 *configPath(EFI_LOADED_IMAGE *li, CHAR8 *arg) {
+    CHAR16 *name;
+    UINTN i;
+
+    name = arenaAlloc(&arena, (strlena(arg) + 1) * sizeof(CHAR16));
+    if (name == NULL)
+        return NULL;
+    for (i = 0; arg[i]; i++)
+        name[i] = arg[i];
+    name[i] = L'\0';
+    if (name[0] != L'\\')
+        name = arenaChildPath(&arena, li->FilePath, name);
+    return name;
 }
 
-EFI_STATUS security_policy_uninstall(void) {
-    EFI_STATUS status;
-
-    if (esfas) {
-        EFI_SECURITY_PROTOCOL *security_protocol;
-
-        status = LibLocateProtocol(&SECURITY_PROTOCOL_GUID, &security_protocol);
-
-        if (status != EFI_SUCCESS)
-            return status;
+/*
+ * <file> is either an index built by tools/allowlist-index or the output of
+ * sha256sum. Without a readable file, allowlist mode still applies and only
+ * images the firmware accepts can be started.
+ */
+static VOID readAllowlist(EFI_FILE_HANDLE root, CHAR16 *pathname) {
+    VOID *data;
+    UINTN size;
+
+    allowlistMode = TRUE;
+    data = readFile(root, pathname, &size);
+    if (data == NULL || allowlistOpen(&allowlist, data, size) != EFI_SUCCESS)
+        Print(L"%s: cannot read allowlist\n", pathname);
+}
 
-        security_protocol->FileAuthenticationState = esfas;
-        esfas = NULL;
-    } else {
-        /* nothing installed */
-        return EFI_NOT_STARTED;
+static VOID readConfig(EFI_LOADED_IMAGE *li, EFI_FILE_HANDLE root) {
+    CHAR8 *data, *line, *end, *arg;
+    CHAR16 *pathname, *name;
+    UINTN size, i;
+
+    pathname = arenaChildPath(&arena, li->FilePath, L"skipsign.cfg");
+    data = pathname ? readFile(root, pathname, &size) : NULL;
+    if (data == NULL)
+        return;
+    data[size] = '\0';
+
+    for (line = data; line < data + size; line = end + 1) {
+        for (end = line; *end && *end != '\n' && *end != '\r' && *end != '#'; end++) ;
+        if (*end == '#') {
+            *end = '\0';
+            while (end < data + size && *end != '\n') end++;
+        }
+        *end = '\0';
+        while (*line == ' ' || *line == '\t') line++;
+        for (arg = line; *arg && *arg != ' ' && *arg != '\t'; arg++) ;
+        if (*arg) {
+            *arg++ = '\0';
+            while (*arg == ' ' || *arg == '\t') arg++;
+        }
+        for (i = strlena(arg); i > 0 && (arg[i-1] == ' ' || arg[i-1] == '\t'); i--)
+            arg[i-1] = '\0';
+
+        if (strcmpa(line, (CHAR8 *) "validate") == 0) {
+            validateImages = TRUE;
+        } else if (strcmpa(line, (CHAR8 *) "bench") == 0 && *arg && benchFileCount < MAX_BENCH_FILES) {
+            name = configPath(li, arg);
+            if (name)
+                benchFiles[benchFileCount++] = name;
+        } else if (strcmpa(line, (CHAR8 *) "allowlist") == 0 && *arg && !allowlistMode) {
+            name = configPath(li, arg);
+            if (name)
+                readAllowlist(root, name);
+        }
     }
+    FreePool(data);
+}
 
-    if (es2fa) {
-        EFI_SECURITY2_PROTOCOL *security2_protocol;
+static VOID benchmarkHash(CHAR16 *Name, VOID (*Hash)(const VOID *, UINTN, UINT8 *), VOID *Data, UINTN Size) {
+    UINT8 digest[SHA256_DIGEST_SIZE];
+    UINT64 start, us;
+    UINTN round;
 
-        status = LibLocateProtocol(&SECURITY2_PROTOCOL_GUID, &security2_protocol);
+    start = perfTimestamp();
+    for (round = 0; round < HASH_BENCH_ROUNDS; round++)
+        Hash(Data, Size, digest);
+    us = perfMicroseconds((perfTimestamp() - start) / HASH_BENCH_ROUNDS);
+    Print(L"  %s%ld us, %ld MB/s\n", Name, us, us ? Size / us : 0);
+}
 
-        if (status != EFI_SUCCESS)
-            return status;
+static VOID benchmarkLookup(VOID *Data, UINTN Size) {
+    UINT8 digest[SHA256_DIGEST_SIZE];
+    BOOLEAN listed = FALSE;
+    UINT64 start, ticks;
+    UINTN round;
+
+    sha256(Data, Size, digest);
+    start = perfTimestamp();
+    for (round = 0; round < LOOKUP_BENCH_ROUNDS; round++)
+        listed = allowlistContains(&allowlist, digest);
+    ticks = perfTimestamp() - start;
+    Print(L"  allowlist of %ld: %s, %ld ns per lookup\n", (UINT64) allowlist.Count,
+        listed ? L"listed" : L"not listed", perfMicroseconds(ticks * 1000 / LOOKUP_BENCH_ROUNDS));
+}
 
-        security2_protocol->FileAuthentication = es2fa;
-        es2fa = NULL;
+static VOID benchmarkValidation(EFI_LOADED_IMAGE *li, EFI_FILE_HANDLE root) {
+    EFI_SECURITY2_PROTOCOL *security2_protocol = NULL;
+    EFI_DEVICE_PATH *dp;
+    EFI_STATUS status;
+    EFI_INPUT_KEY key;
+    UINT64 start, ticks;
+    UINTN i, round, size;
+    VOID *data;
+
+    LibLocateProtocol(&SECURITY2_PROTOCOL_GUID, (void**) &security2_protocol);
+    Print(L"Image validation benchmark (%d rounds native, %d rounds firmware policy)\n",
+        VALIDATE_BENCH_ROUNDS, FIRMWARE_BENCH_ROUNDS);
+    for (i = 0; i < benchFileCount; i++) {
+        data = readFile(root, benchFiles[i], &size);
+        if (data == NULL) {
+            Print(L"%s: cannot read\n", benchFiles[i]);
+            continue;
+        }
+        Print(L"%s (%ld KB)\n", benchFiles[i], size >> 10);
+
+        start = perfTimestamp();
+        for (round = 0; round < VALIDATE_BENCH_ROUNDS; round++)
+            status = peValidate(data, size);
+        ticks = (perfTimestamp() - start) / VALIDATE_BENCH_ROUNDS;
+        Print(L"  native validation: %ld us (%r)\n", perfMicroseconds(ticks), status);
+
+        benchmarkHash(L"SHA-256 scalar: ", sha256Scalar, data, size);
+        if (sha256HaveShaNi())
+            benchmarkHash(L"SHA-256 SHA-NI: ", sha256ShaNi, data, size);
+        if (allowlistMode)
+            benchmarkLookup(data, size);
+
+        if (es2fa && security2_protocol) {
+            dp = arenaFileDevicePath(&arena, li->DeviceHandle, benchFiles[i]);
+            if (dp == NULL)
+                break;
+            start = perfTimestamp();
+            for (round = 0; round < FIRMWARE_BENCH_ROUNDS; round++)
+                status = uefi_call_wrapper(es2fa, 5, security2_protocol, dp, data, size, FALSE);
+            ticks = (perfTimestamp() - start) / FIRMWARE_BENCH_ROUNDS;
+            Print(L"  firmware policy:   %ld us (%r)\n", perfMicroseconds(ticks), status);
+        }
+        FreePool(data);
     }
-
-    return EFI_SUCCESS;
+    Print(L"Press any key to continue.\n");
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
 }
 
 static void runImage(EFI_HANDLE ImageHandle, CHAR16* filename) {
     EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
     EFI_LOADED_IMAGE *li;
     EFI_HANDLE newImage;
-    CHAR16 *pathname = NULL;
-    CHAR16 *myname;
-    INTN i;
+    CHAR16 *pathname;
 
     uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (void **)&li);
-    myname = DevicePathToStr(li->FilePath);
-    for (i = StrLen(myname); i > 0 && myname[i] != L'\\'; i--) ;
-    if (i > 0 && myname[i-1] != L'\\') i++;
-    myname[i] = '\0';
-    pathname = AllocateZeroPool(StrLen(myname) + StrLen(filename) + 1);
-    StrCat(pathname, myname);
-    StrCat(pathname, filename);
-    uefi_call_wrapper(BS->LoadImage, 6, FALSE, ImageHandle, FileDevicePath(li->DeviceHandle, pathname), NULL, 0, &newImage);
-    uefi_call_wrapper(BS->StartImage, 3, newImage, NULL, NULL);
-    FreePool(myname);
-    FreePool(pathname);
+    pathname = arenaChildPath(&arena, li->FilePath, filename);
+    if (loadChildImage(ImageHandle, arenaFileDevicePath(&arena, li->DeviceHandle, pathname), NULL, &newImage) != EFI_SUCCESS)
+        return;
+    /* a child that boots an OS never returns, so publish before as well as after */
+    publishVerdictStats();
+    startChildImage(newImage);
+    unloadImage(newImage);
+    publishVerdictStats();
 }
 
-EFI_STATUS EFIAPI efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
+EFI_STATUS efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
+    EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
+    EFI_LOADED_IMAGE *li;
+    EFI_FILE_HANDLE root;
     EFI_STATUS status;
+    UINTN record;
 
+    perfInit(L"BootPerfSkipSign");
+    record = perfBegin(PERF_INITIALIZE_LIB);
     InitializeLib(ImageHandle, SystemTable);
+    perfEnd(record);
+
+    arenaInit(&arena, ARENA_PAGES);
+    uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (void **)&li);
+    root = LibOpenRoot(li->DeviceHandle);
+    if (root)
+        readConfig(li, root);
 
+    record = perfBegin(PERF_SECURITY_INSTALL);
     status = security_policy_install();
+    perfEnd(record);
     if (status != EFI_SUCCESS) {
         Print(L"Failed to install override security policy.");
     }
 
+    if (root) {
+        if (benchFileCount > 0)
+            benchmarkValidation(li, root);
+        uefi_call_wrapper(root->Close, 1, root);
+    }
+
     runImage(ImageHandle, L"protector.efi");
 
     status = security_policy_uninstall();
     if (status != EFI_SUCCESS)
         Print(L"Failed to uninstall override security policy.");
 
+    Print(L"Security verdict cache: %ld hits, %ld misses\n", verdictStats[0], verdictStats[1]);
+    allowlistFree(&allowlist);
+    arenaFree(&arena);
+
     return EFI_SUCCESS;
 }
@@ -0,0 +1,263 @@
+/*
+ * grml-plus UEFI tools - boot timeline from the ACPI FPDT and the BootPerf variables
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "timeline.h"
+
+static EFI_GUID bootPerfGUID = BOOTPERF_VARIABLE_GUID;
+
+/* the tools' variables, in the order they start each other */
+static struct {
+    CHAR16 *VariableName;
+    CHAR16 *Source;
+} perfSources[] = {
+    { L"BootPerfSkipSign", L"skipsign" },
+    { L"BootPerfProtector", L"protector" },
+    { L"BootPerfLoader", L"loader" }
+};
+
+static UINT64 nanoseconds(UINT64 Ticks, UINT64 Frequency) {
+    if (Frequency == 0)
+        return 0;
+    return (Ticks / Frequency) * 1000000000 + (Ticks % Frequency) * 1000000000 / Frequency;
+}
+
+/* keeps the events sorted by start time, earlier additions first on ties */
+static VOID addEvent(TIMELINE *Timeline, CHAR16 *Source, CHAR16 *Event, UINT64 StartNs, UINT64 DurationNs, UINT16 Count) {
+    UINTN i = Timeline->Count;
+
+    if (i >= TIMELINE_MAX_EVENTS)
+        return;
+    while (i > 0 && Timeline->Events[i - 1].StartNs > StartNs) {
+        Timeline->Events[i] = Timeline->Events[i - 1];
+        i--;
+    }
+    Timeline->Events[i].StartNs = StartNs;
+    Timeline->Events[i].DurationNs = DurationNs;
+    Timeline->Events[i].Count = Count;
+    Timeline->Events[i].Source = Source;
+    Timeline->Events[i].Event = Event;
+    Timeline->Count++;
+}
+
+static VOID addFirmwareEvents(TIMELINE *Timeline) {
+    ACPI_TABLE_HEADER *fpdt = acpiFindTable(ACPI_FPDT_SIGNATURE);
+    FPDT_RECORD_HEADER *record;
+    FPDT_POINTER_RECORD *pointer = NULL;
+    FPDT_FIRMWARE_BASIC_BOOT_RECORD *boot;
+    FBPT_HEADER *fbpt;
+    UINTN offset;
+
+    if (fpdt == NULL)
+        return;
+    for (offset = sizeof(ACPI_TABLE_HEADER); offset + sizeof(FPDT_RECORD_HEADER) <= fpdt->Length; offset += record->Length) {
+        record = (FPDT_RECORD_HEADER *) ((UINT8 *) fpdt + offset);
+        if (record->Length < sizeof(FPDT_RECORD_HEADER))
+            break;
+        if (record->Type == FPDT_FBPT_POINTER_TYPE && record->Length >= sizeof(FPDT_POINTER_RECORD))
+            pointer = (FPDT_POINTER_RECORD *) record;
+    }
+    if (pointer == NULL || pointer->Address == 0)
+        return;
+    fbpt = (FBPT_HEADER *) (UINTN) pointer->Address;
+    if (fbpt->Signature != ACPI_FBPT_SIGNATURE)
+        return;
+
+    for (offset = sizeof(FBPT_HEADER); offset + sizeof(FPDT_RECORD_HEADER) <= fbpt->Length; offset += record->Length) {
+        record = (FPDT_RECORD_HEADER *) ((UINT8 *) fbpt + offset);
+        if (record->Length < sizeof(FPDT_RECORD_HEADER))
+            break;
+        if (record->Type != FPDT_FIRMWARE_BASIC_BOOT_TYPE || record->Length < sizeof(FPDT_FIRMWARE_BASIC_BOOT_RECORD))
+            continue;
+        boot = (FPDT_FIRMWARE_BASIC_BOOT_RECORD *) record;
+        Timeline->Firmware = TRUE;
+        addEvent(Timeline, L"firmware", L"reset end", boot->ResetEnd, 0, 1);
+        if (boot->OsLoaderLoadImageStart != 0)
+            addEvent(Timeline, L"firmware", L"OS loader LoadImage", boot->OsLoaderLoadImageStart, 0, 1);
+        if (boot->OsLoaderStartImageStart != 0)
+            addEvent(Timeline, L"firmware", L"OS loader StartImage", boot->OsLoaderStartImageStart, 0, 1);
+        /* not reached yet during this boot, so these are left over from the previous one, if at all */
+        if (boot->ExitBootServicesEntry != 0)
+            addEvent(Timeline, L"firmware", L"ExitBootServices", boot->ExitBootServicesEntry,
+                boot->ExitBootServicesExit > boot->ExitBootServicesEntry ? boot->ExitBootServicesExit - boot->ExitBootServicesEntry : 0, 1);
+    }
+}
+
+static VOID addToolEvents(TIMELINE *Timeline, CHAR16 *VariableName, CHAR16 *Source) {
+    struct {
+        BOOTPERF_HEADER Header;
+        BOOTPERF_RECORD Records[BOOTPERF_MAX_RECORDS];
+    } __attribute__((packed)) data;
+    BOOTPERF_RECORD *rec;
+    UINTN size = sizeof(data), i;
+    UINT64 freq;
+
+    if (uefi_call_wrapper(RT->GetVariable, 5, VariableName, &bootPerfGUID, NULL, &size, &data) != EFI_SUCCESS)
+        return;
+    if (size < sizeof(BOOTPERF_HEADER) || data.Header.Signature != BOOTPERF_SIGNATURE || data.Header.Version != BOOTPERF_VERSION)
+        return;
+    freq = data.Header.TscFrequency ? data.Header.TscFrequency : perfFrequency();
+    addEvent(Timeline, Source, L"efi_main", nanoseconds(data.Header.EntryTsc, freq), 0, 1);
+    for (i = 0; i < data.Header.RecordCount && sizeof(BOOTPERF_HEADER) + (i + 1) * sizeof(BOOTPERF_RECORD) <= size; i++) {
+        rec = &data.Records[i];
+        addEvent(Timeline, Source, perfPhaseName(rec->Phase), nanoseconds(rec->StartTsc, freq), nanoseconds(rec->Ticks, freq), rec->Count);
+    }
+}
+
+VOID timelineBuild(TIMELINE *Timeline) {
+    UINTN i;
+
+    ZeroMem(Timeline, sizeof(*Timeline));
+    addFirmwareEvents(Timeline);
+    perfPublish();
+    for (i = 0; i < sizeof(perfSources) / sizeof(perfSources[0]); i++)
+        addToolEvents(Timeline, perfSources[i].VariableName, perfSources[i].Source);
+}
+
+static EFI_STATUS writeLine(EFI_FILE_HANDLE File, CHAR16 *Line) {
+    CHAR8 buffer[256];
+    UINTN i, size;
+
+    for (i = 0; Line[i] != 0 && i < sizeof(buffer) - 1; i++)
+        buffer[i] = Line[i] < 0x80 ? (CHAR8) Line[i] : '?';
+    buffer[i++] = '\n';
+    size = i;
+    return uefi_call_wrapper(File->Write, 3, File, &size, buffer);
+}
+
+EFI_STATUS timelineExport(TIMELINE *Timeline, EFI_FILE_HANDLE Root, CHAR16 **FileName) {
+    EFI_FILE_HANDLE file;
+    EFI_STATUS status;
+    EFI_TIME now;
+    CHAR16 line[256];
+    UINTN i;
+
+    if (uefi_call_wrapper(RT->GetTime, 2, &now, NULL) == EFI_SUCCESS)
+        *FileName = PoolPrint(L"\\timeline-%04d%02d%02d-%02d%02d%02d.csv", now.Year, now.Month, now.Day, now.Hour, now.Minute, now.Second);
+    else
+        *FileName = StrDuplicate(L"\\timeline.csv");
+    if (*FileName == NULL)
+        return EFI_OUT_OF_RESOURCES;
+
+    /* an older export of the same name would keep its tail otherwise */
+    if (uefi_call_wrapper(Root->Open, 5, Root, &file, *FileName, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0) == EFI_SUCCESS)
+        uefi_call_wrapper(file->Delete, 1, file);
+    status = uefi_call_wrapper(Root->Open, 5, Root, &file, *FileName, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+    if (status != EFI_SUCCESS)
+        return status;
+
+    SPrint(line, sizeof(line), L"# firmware %s, revision %08x, TSC %ld Hz%s", ST->FirmwareVendor, ST->FirmwareRevision,
+        perfFrequency(), Timeline->Firmware ? L"" : L", no FPDT");
+    status = writeLine(file, line);
+    if (status == EFI_SUCCESS)
+        status = writeLine(file, L"source,event,start_ns,duration_ns,count");
+    for (i = 0; status == EFI_SUCCESS && i < Timeline->Count; i++) {
+        SPrint(line, sizeof(line), L"%s,%s,%ld,%ld,%d", Timeline->Events[i].Source, Timeline->Events[i].Event,
+            Timeline->Events[i].StartNs, Timeline->Events[i].DurationNs, Timeline->Events[i].Count);
+        status = writeLine(file, line);
+    }
+    if (status == EFI_SUCCESS)
+        status = uefi_call_wrapper(file->Flush, 1, file);
+    uefi_call_wrapper(file->Close, 1, file);
+    return status;
+}
+
+static VOID printMilliseconds(UINT64 Ns) {
+    Print(L"%6ld.%03ld", Ns / 1000000, Ns / 1000 % 1000);
+}
+
+static VOID printEvent(TIMELINE_EVENT *Event, UINT64 PreviousNs) {
+    printMilliseconds(Event->StartNs);
+    Print(L" ");
+    printMilliseconds(Event->StartNs - PreviousNs);
+    Print(L" ");
+    if (Event->DurationNs != 0 || Event->Count > 1) {
+        printMilliseconds(Event->DurationNs);
+    } else {
+        Print(L"%10s", Event->Count ? L"" : L"(running)");
+    }
+    if (Event->Count > 1)
+        Print(L" %5dx ", Event->Count);
+    else
+        Print(L"        ");
+    Print(L"%-9s %s\n", Event->Source, Event->Event);
+}
+
+static VOID waitKey(EFI_INPUT_KEY *Key) {
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    if (uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, Key) != EFI_SUCCESS) {
+        Key->ScanCode = SCAN_ESC;
+        Key->UnicodeChar = 0;
+    }
+}
+
+VOID timelineScreen(EFI_FILE_HANDLE Root) {
+    TIMELINE *timeline = AllocatePool(sizeof(TIMELINE));
+    EFI_INPUT_KEY key;
+    EFI_STATUS status;
+    CHAR16 *fileName;
+    UINTN i = 0, line;
+
+    uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, EFI_WHITE);
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    if (timeline == NULL) {
+        Print(L"Out of memory.\n");
+        waitKey(&key);
+        return;
+    }
+    timelineBuild(timeline);
+
+    while (TRUE) {
+        uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+        Print(L"Boot timeline since reset (TSC %ld MHz)%s\n\n", perfFrequency() / 1000000,
+            timeline->Firmware ? L"" : L", no FPDT from the firmware");
+        Print(L"  start [ms]    +[ms]   took [ms]  count source    event\n");
+        for (line = 0; i < timeline->Count && line < TIMELINE_PAGE_LINES; i++, line++)
+            printEvent(&timeline->Events[i], i > 0 ? timeline->Events[i - 1].StartNs : 0);
+        Print(L"\n%sX: export to the boot volume, any other key: back\n", i < timeline->Count ? L"N: next page, " : L"");
+        waitKey(&key);
+        if ((key.UnicodeChar == L'n' || key.UnicodeChar == L'N') && i < timeline->Count)
+            continue;
+        if ((key.UnicodeChar == L'x' || key.UnicodeChar == L'X') && Root != NULL) {
+            fileName = NULL;
+            status = timelineExport(timeline, Root, &fileName);
+            Print(L"Export to %s: %r, press any key\n", fileName ? fileName : L"?", status);
+            if (fileName)
+                FreePool(fileName);
+            waitKey(&key);
+        }
+        break;
+    }
+    FreePool(timeline);
+}
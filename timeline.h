@@ -0,0 +1,107 @@
+/*
+ * grml-plus UEFI tools - boot timeline from the ACPI FPDT and the BootPerf variables
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "acpi.h"
+
+/*
+ * The ACPI Firmware Performance Data Table (FPDT) points to the Firmware
+ * Basic Boot Performance Table (FBPT), in which the firmware records when it
+ * started running and when it loaded and started the first OS loader (the
+ * first of our tools), in nanoseconds since reset. On x86 the TSC counts
+ * from reset as well, so the BootPerf records of all tools can be put on the
+ * same timeline, which shows where the time before efi_main went.
+ *
+ * The timeline can be exported as CSV (source,event,start_ns,duration_ns,
+ * count) to the root of the boot volume, one file per boot named after the
+ * firmware's clock, so that machines of a fleet can be compared.
+ */
+
+#define TIMELINE_MAX_EVENTS 128
+#define TIMELINE_PAGE_LINES 18
+
+#define ACPI_FPDT_SIGNATURE 0x54445046 /* "FPDT" */
+#define ACPI_FBPT_SIGNATURE 0x54504246 /* "FBPT" */
+#define FPDT_FBPT_POINTER_TYPE 0x0000
+#define FPDT_FIRMWARE_BASIC_BOOT_TYPE 0x0002
+
+typedef struct {
+    UINT16 Type;
+    UINT8 Length;
+    UINT8 Revision;
+} __attribute__((packed)) FPDT_RECORD_HEADER;
+
+typedef struct {
+    FPDT_RECORD_HEADER Header;
+    UINT32 Reserved;
+    UINT64 Address;
+} __attribute__((packed)) FPDT_POINTER_RECORD;
+
+typedef struct {
+    UINT32 Signature;
+    UINT32 Length;
+} __attribute__((packed)) FBPT_HEADER;
+
+/* all times in nanoseconds since reset, 0 if not reached yet */
+typedef struct {
+    FPDT_RECORD_HEADER Header;
+    UINT32 Reserved;
+    UINT64 ResetEnd;
+    UINT64 OsLoaderLoadImageStart;
+    UINT64 OsLoaderStartImageStart;
+    UINT64 ExitBootServicesEntry;
+    UINT64 ExitBootServicesExit;
+} __attribute__((packed)) FPDT_FIRMWARE_BASIC_BOOT_RECORD;
+
+typedef struct {
+    UINT64 StartNs;
+    UINT64 DurationNs;    /* 0 for points in time */
+    UINT16 Count;         /* intervals summed up in DurationNs */
+    CHAR16 *Source;
+    CHAR16 *Event;
+} TIMELINE_EVENT;
+
+typedef struct {
+    TIMELINE_EVENT Events[TIMELINE_MAX_EVENTS];
+    UINTN Count;
+    BOOLEAN Firmware;     /* an FBPT was found */
+} TIMELINE;
+
+/* collects the FBPT and all BootPerf variables, ours published first */
+VOID timelineBuild(TIMELINE *Timeline);
+/* writes it to Root as \\timeline-YYYYMMDD-HHMMSS.csv; FileName gets the name used (from the pool) */
+EFI_STATUS timelineExport(TIMELINE *Timeline, EFI_FILE_HANDLE Root, CHAR16 **FileName);
+/* shows the timeline and offers to export it to Root (may be NULL) */
+VOID timelineScreen(EFI_FILE_HANDLE Root);
+
+#endif
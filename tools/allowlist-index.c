@@ -0,0 +1,279 @@
+/*
+ * grml-plus UEFI tools - allowlist index builder
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Usage: allowlist-index [-o index] [file...]
+ *        allowlist-index -b
+ *
+ * Reads SHA-256 digests in sha256sum format (every line starting with 64 hex
+ * digits) from the files or stdin and writes the sorted index that
+ * skipsign.efi reads with "allowlist <file>" (layout in allowlist.h).
+ * Duplicates are dropped. With -b, random indexes of 10k and 100k entries
+ * are built in memory and lookups through the prefix table are timed against
+ * a plain binary search and a linear scan.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../digestline.h"
+
+#define DIGEST_SIZE 32
+#define ALLOWLIST_SIGNATURE 0x41505247
+#define ALLOWLIST_VERSION 1
+#define ALLOWLIST_MIN_PREFIX_BITS 4
+#define ALLOWLIST_MAX_PREFIX_BITS 20
+
+typedef struct {
+    uint32_t Signature;
+    uint16_t Version;
+    uint16_t HeaderSize;
+    uint32_t Count;
+    uint8_t PrefixBits;
+    uint8_t Reserved[3];
+} __attribute__((packed)) ALLOWLIST_HEADER;
+
+typedef struct {
+    uint8_t *digests;
+    size_t count, capacity;
+    uint32_t *prefixes;
+    unsigned prefixBits;
+} INDEX;
+
+static int compareDigests(const void *a, const void *b) {
+    return memcmp(a, b, DIGEST_SIZE);
+}
+
+static unsigned digestPrefix(const uint8_t *digest, unsigned bits) {
+    return ((uint32_t) digest[0] << 24 | (uint32_t) digest[1] << 16 | (uint32_t) digest[2] << 8 | digest[3]) >> (32 - bits);
+}
+
+static void addDigest(INDEX *index, const uint8_t *digest) {
+    if (index->count == index->capacity) {
+        index->capacity = index->capacity ? 2 * index->capacity : 1024;
+        index->digests = realloc(index->digests, index->capacity * DIGEST_SIZE);
+        if (!index->digests) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memcpy(index->digests + index->count++ * DIGEST_SIZE, digest, DIGEST_SIZE);
+}
+
+static void readDigests(INDEX *index, FILE *f) {
+    char line[4096];
+    uint8_t digest[DIGEST_SIZE];
+    size_t length;
+
+    while (fgets(line, sizeof(line), f)) {
+        length = strcspn(line, "\n");
+        if (parseDigestLine((const unsigned char *) line, length, digest))
+            addDigest(index, digest);
+        /* skip the rest of overlong lines */
+        while (!strchr(line, '\n') && fgets(line, sizeof(line), f))
+            ;
+    }
+}
+
+/* sorts, drops duplicates and fills the prefix table */
+static void buildIndex(INDEX *index) {
+    size_t i, out;
+    unsigned p;
+
+    qsort(index->digests, index->count, DIGEST_SIZE, compareDigests);
+    for (i = 0, out = 0; i < index->count; i++) {
+        if (out == 0 || memcmp(index->digests + (out - 1) * DIGEST_SIZE, index->digests + i * DIGEST_SIZE, DIGEST_SIZE) != 0)
+            memmove(index->digests + out++ * DIGEST_SIZE, index->digests + i * DIGEST_SIZE, DIGEST_SIZE);
+    }
+    index->count = out;
+
+    for (index->prefixBits = ALLOWLIST_MIN_PREFIX_BITS;
+         index->prefixBits < ALLOWLIST_MAX_PREFIX_BITS && (1UL << index->prefixBits) < index->count; index->prefixBits++)
+        ;
+    free(index->prefixes);
+    index->prefixes = malloc(((1UL << index->prefixBits) + 1) * sizeof(uint32_t));
+    if (!index->prefixes) {
+        perror("malloc");
+        exit(1);
+    }
+    for (p = 0, i = 0; p <= 1U << index->prefixBits; p++) {
+        while (i < index->count && digestPrefix(index->digests + i * DIGEST_SIZE, index->prefixBits) < p)
+            i++;
+        index->prefixes[p] = (uint32_t) i;
+    }
+}
+
+/* the same lookup as allowlistContains in allowlist.c */
+static int indexContains(const INDEX *index, const uint8_t *digest) {
+    unsigned p = digestPrefix(digest, index->prefixBits);
+    size_t low = index->prefixes[p], high = index->prefixes[p + 1], middle;
+    int order;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        order = memcmp(index->digests + middle * DIGEST_SIZE, digest, DIGEST_SIZE);
+        if (order == 0)
+            return 1;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return 0;
+}
+
+static int binaryContains(const INDEX *index, const uint8_t *digest) {
+    return bsearch(digest, index->digests, index->count, DIGEST_SIZE, compareDigests) != NULL;
+}
+
+static int linearContains(const INDEX *index, const uint8_t *digest) {
+    size_t i;
+
+    for (i = 0; i < index->count; i++) {
+        if (memcmp(index->digests + i * DIGEST_SIZE, digest, DIGEST_SIZE) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int writeIndex(const INDEX *index, const char *name) {
+    ALLOWLIST_HEADER hdr = { ALLOWLIST_SIGNATURE, ALLOWLIST_VERSION, sizeof(ALLOWLIST_HEADER), 0, 0, { 0, 0, 0 } };
+    FILE *f = name ? fopen(name, "wb") : stdout;
+
+    if (!f) {
+        perror(name);
+        return 1;
+    }
+    hdr.Count = (uint32_t) index->count;
+    hdr.PrefixBits = (uint8_t) index->prefixBits;
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+            fwrite(index->prefixes, sizeof(uint32_t), (1UL << index->prefixBits) + 1, f) != (1UL << index->prefixBits) + 1 ||
+            fwrite(index->digests, DIGEST_SIZE, index->count, f) != index->count ||
+            (name && fclose(f) != 0)) {
+        perror(name ? name : "stdout");
+        return 1;
+    }
+    return 0;
+}
+
+static double nanoseconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* half of the probes are listed, half are not */
+static double timeLookups(const INDEX *index, int (*contains)(const INDEX *, const uint8_t *),
+        const uint8_t *probes, size_t probeCount, size_t *found) {
+    double start = nanoseconds();
+    size_t i;
+
+    *found = 0;
+    for (i = 0; i < probeCount; i++)
+        *found += contains(index, probes + i * DIGEST_SIZE);
+    return (nanoseconds() - start) / probeCount;
+}
+
+static void benchmark(void) {
+    static const size_t sizes[] = { 10000, 100000 };
+    const size_t probeCount = 200000, linearProbes = 2000;
+    uint8_t digest[DIGEST_SIZE], *probes = malloc(probeCount * DIGEST_SIZE);
+    INDEX index;
+    size_t s, i, j, found[3];
+    double ns[3];
+
+    srand(1);
+    printf("%8s %6s %12s %12s %12s %10s\n", "entries", "bits", "index [ns]", "bsearch [ns]", "linear [ns]", "size [KB]");
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        memset(&index, 0, sizeof(index));
+        for (i = 0; i < sizes[s]; i++) {
+            for (j = 0; j < DIGEST_SIZE; j++)
+                digest[j] = (uint8_t) rand();
+            addDigest(&index, digest);
+        }
+        for (i = 0; i < probeCount; i++) {
+            if (i % 2 == 0) {
+                memcpy(probes + i * DIGEST_SIZE, index.digests + (size_t) rand() % sizes[s] * DIGEST_SIZE, DIGEST_SIZE);
+            } else {
+                for (j = 0; j < DIGEST_SIZE; j++)
+                    probes[i * DIGEST_SIZE + j] = (uint8_t) rand();
+            }
+        }
+        buildIndex(&index);
+
+        ns[0] = timeLookups(&index, indexContains, probes, probeCount, &found[0]);
+        ns[1] = timeLookups(&index, binaryContains, probes, probeCount, &found[1]);
+        ns[2] = timeLookups(&index, linearContains, probes, linearProbes, &found[2]);
+        if (found[0] != probeCount / 2 || found[1] != probeCount / 2 || found[2] != linearProbes / 2)
+            fprintf(stderr, "lookup mismatch: %zu/%zu/%zu\n", found[0], found[1], found[2]);
+        printf("%8zu %6u %12.1f %12.1f %12.1f %10zu\n", index.count, index.prefixBits, ns[0], ns[1], ns[2],
+            (sizeof(ALLOWLIST_HEADER) + ((1UL << index.prefixBits) + 1) * sizeof(uint32_t) + index.count * DIGEST_SIZE) >> 10);
+        free(index.digests);
+        free(index.prefixes);
+    }
+    free(probes);
+}
+
+int main(int argc, char **argv) {
+    INDEX index;
+    const char *output = NULL;
+    FILE *f;
+    int i = 1;
+
+    if (argc == 2 && strcmp(argv[1], "-b") == 0) {
+        benchmark();
+        return 0;
+    }
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        output = argv[2];
+        i = 3;
+    }
+
+    memset(&index, 0, sizeof(index));
+    if (i == argc)
+        readDigests(&index, stdin);
+    for (; i < argc; i++) {
+        f = fopen(argv[i], "r");
+        if (!f) {
+            perror(argv[i]);
+            return 1;
+        }
+        readDigests(&index, f);
+        fclose(f);
+    }
+    buildIndex(&index);
+    fprintf(stderr, "%zu digests, %u prefix bits\n", index.count, index.prefixBits);
+    return writeIndex(&index, output);
+}
@@ -0,0 +1,176 @@
+/*
+ * grml-plus UEFI tools - decode boot phase timestamps on the host
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Usage: bootperf-decode [-c] [file...]
+ *
+ * Without file arguments, all BootPerf* variables published by the EFI tools
+ * are read from /sys/firmware/efi/efivars. With -c, one CSV line per record
+ * (file,phase,count,start_us,duration_us) is printed for fleet collection.
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define EFIVARS_DIR "/sys/firmware/efi/efivars"
+#define BOOTPERF_GUID_SUFFIX "-1b8881b9-a2e5-43c6-bf6b-15935c813bb1"
+#define BOOTPERF_SIGNATURE 0x46505247
+#define BOOTPERF_VERSION 1
+#define BOOTPERF_MAX_RECORDS 32
+#define BOOTPERF_FLAG_OVERFLOW 0x00000001
+
+typedef struct {
+    uint32_t Signature;
+    uint16_t Version;
+    uint16_t HeaderSize;
+    uint32_t RecordCount;
+    uint32_t Flags;
+    uint64_t TscFrequency;
+    uint64_t EntryTsc;
+} __attribute__((packed)) BOOTPERF_HEADER;
+
+typedef struct {
+    uint16_t Phase;
+    uint16_t Count;
+    uint32_t Reserved;
+    uint64_t StartTsc;
+    uint64_t Ticks;
+} __attribute__((packed)) BOOTPERF_RECORD;
+
+static const char *phaseNames[] = {
+    "?", "InitializeLib", "security_policy_install", "OpenVolume",
+    "file probe", "menu wait", "LoadImage", "StartImage", "key to paint",
+    "image hash", "decompress", "key to action", "RAM disk load"
+};
+
+static int csv = 0;
+
+static double toMicroseconds(uint64_t ticks, uint64_t freq) {
+    return freq ? (double) ticks * 1000000.0 / (double) freq : 0;
+}
+
+static int decode(const char *name) {
+    unsigned char data[4 + sizeof(BOOTPERF_HEADER) + BOOTPERF_MAX_RECORDS * sizeof(BOOTPERF_RECORD)];
+    BOOTPERF_HEADER hdr;
+    BOOTPERF_RECORD rec;
+    const unsigned char *p = data;
+    size_t len, i;
+    const char *phase;
+    FILE *f = fopen(name, "rb");
+
+    if (!f) {
+        perror(name);
+        return 1;
+    }
+    len = fread(data, 1, sizeof(data), f);
+    fclose(f);
+
+    /* efivarfs prefixes the data with the 32-bit attributes */
+    if (len >= 4 + sizeof(hdr) && memcmp(data, "GRPF", 4) != 0) {
+        p += 4;
+        len -= 4;
+    }
+    if (len < sizeof(hdr)) {
+        fprintf(stderr, "%s: too short\n", name);
+        return 1;
+    }
+    memcpy(&hdr, p, sizeof(hdr));
+    if (hdr.Signature != BOOTPERF_SIGNATURE || hdr.Version != BOOTPERF_VERSION || hdr.HeaderSize < sizeof(hdr)) {
+        fprintf(stderr, "%s: unsupported record (signature %08x, version %u)\n", name, hdr.Signature, hdr.Version);
+        return 1;
+    }
+    p += hdr.HeaderSize;
+    len -= hdr.HeaderSize;
+
+    if (!csv) {
+        printf("%s: TSC %.3f MHz, entered at %.3f ms%s\n", name, hdr.TscFrequency / 1e6,
+            toMicroseconds(hdr.EntryTsc, hdr.TscFrequency) / 1000, (hdr.Flags & BOOTPERF_FLAG_OVERFLOW) ? " (records dropped)" : "");
+        printf("  %-24s %6s %12s %12s %12s\n", "phase", "count", "start [ms]", "took [ms]", "avg [us]");
+    }
+    for (i = 0; i < hdr.RecordCount && len >= sizeof(rec); i++, p += sizeof(rec), len -= sizeof(rec)) {
+        memcpy(&rec, p, sizeof(rec));
+        phase = rec.Phase < sizeof(phaseNames) / sizeof(phaseNames[0]) ? phaseNames[rec.Phase] : "?";
+        if (csv) {
+            printf("%s,%s,%u,%.0f,%.0f\n", name, phase, rec.Count,
+                toMicroseconds(rec.StartTsc - hdr.EntryTsc, hdr.TscFrequency),
+                toMicroseconds(rec.Ticks, hdr.TscFrequency));
+        } else if (rec.Count == 0) {
+            printf("  %-24s %6s %12.3f %12s\n", phase, "-",
+                toMicroseconds(rec.StartTsc - hdr.EntryTsc, hdr.TscFrequency) / 1000, "(running)");
+        } else {
+            printf("  %-24s %6u %12.3f %12.3f %12.1f\n", phase, rec.Count,
+                toMicroseconds(rec.StartTsc - hdr.EntryTsc, hdr.TscFrequency) / 1000,
+                toMicroseconds(rec.Ticks, hdr.TscFrequency) / 1000,
+                toMicroseconds(rec.Ticks, hdr.TscFrequency) / rec.Count);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    char path[512];
+    struct dirent *de;
+    DIR *dir;
+    int i = 1, rc = 0, found = 0;
+    size_t len, suffixLen = strlen(BOOTPERF_GUID_SUFFIX);
+
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        csv = 1;
+        i++;
+    }
+    if (i < argc) {
+        for (; i < argc; i++)
+            rc |= decode(argv[i]);
+        return rc;
+    }
+
+    dir = opendir(EFIVARS_DIR);
+    if (!dir) {
+        perror(EFIVARS_DIR);
+        return 1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        len = strlen(de->d_name);
+        if (strncmp(de->d_name, "BootPerf", 8) != 0 || len <= suffixLen || strcmp(de->d_name + len - suffixLen, BOOTPERF_GUID_SUFFIX) != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", EFIVARS_DIR, de->d_name);
+        rc |= decode(path);
+        found++;
+    }
+    closedir(dir);
+    if (!found) {
+        fprintf(stderr, "no BootPerf variables found\n");
+        return 1;
+    }
+    return rc;
+}
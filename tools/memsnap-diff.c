@@ -0,0 +1,394 @@
+/*
+ * grml-plus UEFI tools - decode and diff the protector's memory map snapshots
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Usage: memsnap-diff [-c] [-v] file...
+ *
+ * Decodes the memsnap-*.bin files that the protector writes to the ESP while
+ * memory map snapshots are enabled (hidden key D; layout in memsnap.h). For
+ * every launch, the pages per memory type before and after the started image
+ * ran are compared, and changed MemoryTypeInformation bins are listed; -v
+ * also lists the descriptors that appeared or went away. At the end the
+ * growth per image is summed up over all launches in all files. With -c,
+ * one CSV line per launch and changed type
+ * (file,launch,image,status,type,before,after,delta) is printed instead.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMSNAP_SIGNATURE 0x534d5247
+#define MEMSNAP_VERSION 1
+#define MEMSNAP_NAME_LENGTH 64
+#define MEMSNAP_INFO_TRUNCATED 1
+#define MEMSNAP_BACKUP_TRUNCATED 2
+#define TYPE_BINS 17
+#define MAX_IMAGES 64
+
+typedef struct {
+    uint32_t Signature;
+    uint16_t Version;
+    uint16_t HeaderSize;
+    uint32_t Size;
+    uint32_t Launch;
+    uint64_t TscFrequency;
+    uint64_t Status;
+    char Name[MEMSNAP_NAME_LENGTH];
+} __attribute__((packed)) MEMSNAP_LAUNCH;
+
+typedef struct {
+    uint64_t Tsc;
+    uint32_t DescriptorCount;
+    uint32_t InfoCount;
+    uint32_t BackupCount;
+    uint32_t Flags;
+} __attribute__((packed)) MEMSNAP_HEADER;
+
+typedef struct {
+    uint32_t Type;
+    uint32_t Reserved;
+    uint64_t PhysicalStart;
+    uint64_t NumberOfPages;
+    uint64_t Attribute;
+} __attribute__((packed)) MEMSNAP_DESCRIPTOR;
+
+typedef struct {
+    uint32_t Type;
+    uint32_t NumberOfPages;
+} __attribute__((packed)) MEMSNAP_TYPE_INFO;
+
+typedef struct {
+    MEMSNAP_HEADER Header;
+    MEMSNAP_DESCRIPTOR *Descriptors;
+    MEMSNAP_TYPE_INFO *Info, *Backup;
+    int64_t Pages[TYPE_BINS];
+} SNAPSHOT;
+
+static struct {
+    char Name[MEMSNAP_NAME_LENGTH + 1];
+    unsigned Launches;
+    int64_t Total[TYPE_BINS];
+    int64_t Max[TYPE_BINS];
+} images[MAX_IMAGES];
+static unsigned imageCount;
+
+/* the last bin collects OEM and OS types */
+static const char *typeNames[TYPE_BINS] = {
+    "Reserved", "LoaderCode", "LoaderData", "BSCode", "BSData", "RTCode", "RTData",
+    "Conventional", "Unusable", "ACPIReclaim", "ACPINVS", "MMIO", "MMIOPort", "PalCode",
+    "Persistent", "Unaccepted", "OEM/OS"
+};
+
+static int csv = 0, verbose = 0;
+
+static unsigned typeBin(uint32_t type) {
+    return type < TYPE_BINS - 1 ? type : TYPE_BINS - 1;
+}
+
+/* reads a snapshot at *p, advancing it; 0 if it does not fit before end */
+static int readSnapshot(const unsigned char **p, const unsigned char *end, SNAPSHOT *snap) {
+    size_t size;
+    uint32_t i;
+
+    if ((size_t) (end - *p) < sizeof(MEMSNAP_HEADER))
+        return 0;
+    memcpy(&snap->Header, *p, sizeof(MEMSNAP_HEADER));
+    size = sizeof(MEMSNAP_HEADER) + (size_t) snap->Header.DescriptorCount * sizeof(MEMSNAP_DESCRIPTOR)
+        + ((size_t) snap->Header.InfoCount + snap->Header.BackupCount) * sizeof(MEMSNAP_TYPE_INFO);
+    if ((size_t) (end - *p) < size)
+        return 0;
+    snap->Descriptors = malloc(snap->Header.DescriptorCount * sizeof(MEMSNAP_DESCRIPTOR) + 1);
+    snap->Info = malloc(((size_t) snap->Header.InfoCount + snap->Header.BackupCount) * sizeof(MEMSNAP_TYPE_INFO) + 1);
+    if (snap->Descriptors == NULL || snap->Info == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    *p += sizeof(MEMSNAP_HEADER);
+    memcpy(snap->Descriptors, *p, snap->Header.DescriptorCount * sizeof(MEMSNAP_DESCRIPTOR));
+    *p += snap->Header.DescriptorCount * sizeof(MEMSNAP_DESCRIPTOR);
+    memcpy(snap->Info, *p, ((size_t) snap->Header.InfoCount + snap->Header.BackupCount) * sizeof(MEMSNAP_TYPE_INFO));
+    *p += ((size_t) snap->Header.InfoCount + snap->Header.BackupCount) * sizeof(MEMSNAP_TYPE_INFO);
+    snap->Backup = snap->Info + snap->Header.InfoCount;
+    memset(snap->Pages, 0, sizeof(snap->Pages));
+    for (i = 0; i < snap->Header.DescriptorCount; i++)
+        snap->Pages[typeBin(snap->Descriptors[i].Type)] += snap->Descriptors[i].NumberOfPages;
+    return 1;
+}
+
+static void freeSnapshot(SNAPSHOT *snap) {
+    free(snap->Descriptors);
+    free(snap->Info);
+}
+
+static int compareDescriptors(const void *a, const void *b) {
+    const MEMSNAP_DESCRIPTOR *x = a, *y = b;
+
+    if (x->PhysicalStart != y->PhysicalStart)
+        return x->PhysicalStart < y->PhysicalStart ? -1 : 1;
+    if (x->NumberOfPages != y->NumberOfPages)
+        return x->NumberOfPages < y->NumberOfPages ? -1 : 1;
+    return x->Type < y->Type ? -1 : x->Type > y->Type;
+}
+
+static void printDescriptor(char sign, const MEMSNAP_DESCRIPTOR *d) {
+    printf("    %c %016llx %10llu pages %-12s attr %016llx\n", sign, (unsigned long long) d->PhysicalStart,
+        (unsigned long long) d->NumberOfPages, typeNames[typeBin(d->Type)], (unsigned long long) d->Attribute);
+}
+
+/* both sorted by address, then walked side by side */
+static void diffDescriptors(SNAPSHOT *before, SNAPSHOT *after) {
+    uint32_t i = 0, j = 0;
+    int cmp;
+
+    qsort(before->Descriptors, before->Header.DescriptorCount, sizeof(MEMSNAP_DESCRIPTOR), compareDescriptors);
+    qsort(after->Descriptors, after->Header.DescriptorCount, sizeof(MEMSNAP_DESCRIPTOR), compareDescriptors);
+    while (i < before->Header.DescriptorCount || j < after->Header.DescriptorCount) {
+        if (i == before->Header.DescriptorCount)
+            cmp = 1;
+        else if (j == after->Header.DescriptorCount)
+            cmp = -1;
+        else
+            cmp = compareDescriptors(&before->Descriptors[i], &after->Descriptors[j]);
+        if (cmp < 0) {
+            printDescriptor('-', &before->Descriptors[i++]);
+        } else if (cmp > 0) {
+            printDescriptor('+', &after->Descriptors[j++]);
+        } else {
+            if (before->Descriptors[i].Attribute != after->Descriptors[j].Attribute) {
+                printDescriptor('-', &before->Descriptors[i]);
+                printDescriptor('+', &after->Descriptors[j]);
+            }
+            i++;
+            j++;
+        }
+    }
+}
+
+static int64_t infoPages(const MEMSNAP_TYPE_INFO *info, uint32_t count, uint32_t type) {
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+        if (info[i].Type == type)
+            return info[i].NumberOfPages;
+    return -1;
+}
+
+static void diffInfo(const char *label, const MEMSNAP_TYPE_INFO *before, uint32_t beforeCount,
+        const MEMSNAP_TYPE_INFO *after, uint32_t afterCount) {
+    int64_t old, new;
+    uint32_t i;
+
+    for (i = 0; i < afterCount; i++) {
+        old = infoPages(before, beforeCount, after[i].Type);
+        new = after[i].NumberOfPages;
+        if (old != new)
+            printf("  %s %s: %lld -> %lld pages\n", label, typeNames[typeBin(after[i].Type)], (long long) old, (long long) new);
+    }
+    for (i = 0; i < beforeCount; i++) {
+        if (infoPages(after, afterCount, before[i].Type) == -1)
+            printf("  %s %s: %u pages -> gone\n", label, typeNames[typeBin(before[i].Type)], before[i].NumberOfPages);
+    }
+}
+
+/* a variable that did not fit was recorded with no pairs, which is not "missing" */
+static void truncatedInfo(const char *file, unsigned launch, const char *label, uint32_t beforeFlags,
+        uint32_t afterFlags, uint32_t flag) {
+    const char *when;
+
+    if (((beforeFlags | afterFlags) & flag) == 0)
+        return;
+    when = (beforeFlags & afterFlags & flag) ? "before and after" : (beforeFlags & flag) ? "before" : "after";
+    if (csv)
+        fprintf(stderr, "%s: launch %u: %s too large to record %s\n", file, launch, label, when);
+    else
+        printf("  %s: too large to record %s, not compared\n", label, when);
+}
+
+static void account(const char *name, SNAPSHOT *before, SNAPSHOT *after) {
+    unsigned i, t;
+    int64_t delta;
+
+    for (i = 0; i < imageCount && strcmp(images[i].Name, name) != 0; i++) ;
+    if (i == imageCount) {
+        if (imageCount == MAX_IMAGES)
+            return;
+        memset(&images[i], 0, sizeof(images[i]));
+        strncpy(images[i].Name, name, MEMSNAP_NAME_LENGTH);
+        imageCount++;
+    }
+    images[i].Launches++;
+    for (t = 0; t < TYPE_BINS; t++) {
+        delta = after->Pages[t] - before->Pages[t];
+        images[i].Total[t] += delta;
+        if (images[i].Launches == 1 || delta > images[i].Max[t])
+            images[i].Max[t] = delta;
+    }
+}
+
+static void decodeLaunch(const char *file, const MEMSNAP_LAUNCH *launch, SNAPSHOT *before, SNAPSHOT *after) {
+    char name[MEMSNAP_NAME_LENGTH + 1];
+    double ms = launch->TscFrequency ? (double) (after->Header.Tsc - before->Header.Tsc) * 1000.0 / launch->TscFrequency : 0;
+    unsigned t;
+
+    memcpy(name, launch->Name, MEMSNAP_NAME_LENGTH);
+    name[MEMSNAP_NAME_LENGTH] = 0;
+    account(name, before, after);
+    if (csv) {
+        for (t = 0; t < TYPE_BINS; t++) {
+            if (before->Pages[t] != after->Pages[t])
+                printf("%s,%u,%s,%#llx,%s,%lld,%lld,%lld\n", file, launch->Launch, name, (unsigned long long) launch->Status,
+                    typeNames[t], (long long) before->Pages[t], (long long) after->Pages[t],
+                    (long long) (after->Pages[t] - before->Pages[t]));
+        }
+        truncatedInfo(file, launch->Launch, "MemoryTypeInformation", before->Header.Flags, after->Header.Flags,
+            MEMSNAP_INFO_TRUNCATED);
+        truncatedInfo(file, launch->Launch, "MemoryTypeInformationBackup", before->Header.Flags, after->Header.Flags,
+            MEMSNAP_BACKUP_TRUNCATED);
+        return;
+    }
+    printf("%s: launch %u of %s, status %#llx, ran %.1f ms, %u -> %u descriptors\n", file, launch->Launch, name,
+        (unsigned long long) launch->Status, ms, before->Header.DescriptorCount, after->Header.DescriptorCount);
+    printf("  %-12s %12s %12s %12s\n", "type", "before", "after", "delta");
+    for (t = 0; t < TYPE_BINS; t++) {
+        if (before->Pages[t] != after->Pages[t])
+            printf("  %-12s %12lld %12lld %+12lld\n", typeNames[t], (long long) before->Pages[t],
+                (long long) after->Pages[t], (long long) (after->Pages[t] - before->Pages[t]));
+    }
+    truncatedInfo(file, launch->Launch, "MemoryTypeInformation", before->Header.Flags, after->Header.Flags,
+        MEMSNAP_INFO_TRUNCATED);
+    truncatedInfo(file, launch->Launch, "MemoryTypeInformationBackup", before->Header.Flags, after->Header.Flags,
+        MEMSNAP_BACKUP_TRUNCATED);
+    diffInfo("MemoryTypeInformation", before->Info, before->Header.InfoCount, after->Info, after->Header.InfoCount);
+    diffInfo("MemoryTypeInformationBackup", before->Backup, before->Header.BackupCount, after->Backup, after->Header.BackupCount);
+    if (verbose)
+        diffDescriptors(before, after);
+}
+
+static int decode(const char *name) {
+    const unsigned char *p, *end, *record;
+    unsigned char *data;
+    MEMSNAP_LAUNCH launch;
+    SNAPSHOT before, after;
+    long size;
+    int rc = 0;
+    FILE *f = fopen(name, "rb");
+
+    if (!f) {
+        perror(name);
+        return 1;
+    }
+    if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0
+            || (data = malloc(size + 1)) == NULL || fread(data, 1, size, f) != (size_t) size) {
+        perror(name);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    for (p = data, end = data + size; p < end; p = record + launch.Size) {
+        record = p;
+        if ((size_t) (end - p) < sizeof(launch)) {
+            fprintf(stderr, "%s: truncated at offset %ld\n", name, (long) (p - data));
+            rc = 1;
+            break;
+        }
+        memcpy(&launch, p, sizeof(launch));
+        if (launch.Signature != MEMSNAP_SIGNATURE || launch.HeaderSize < sizeof(launch) || launch.Size < launch.HeaderSize
+                || launch.Size > (size_t) (end - p)) {
+            fprintf(stderr, "%s: no launch record at offset %ld\n", name, (long) (p - data));
+            rc = 1;
+            break;
+        }
+        if (launch.Version != MEMSNAP_VERSION) {
+            fprintf(stderr, "%s: skipping launch %u (version %u)\n", name, launch.Launch, launch.Version);
+            continue;
+        }
+        p += launch.HeaderSize;
+        if (!readSnapshot(&p, record + launch.Size, &before)) {
+            fprintf(stderr, "%s: launch %u is truncated\n", name, launch.Launch);
+            rc = 1;
+            continue;
+        }
+        if (!readSnapshot(&p, record + launch.Size, &after)) {
+            fprintf(stderr, "%s: launch %u is truncated\n", name, launch.Launch);
+            freeSnapshot(&before);
+            rc = 1;
+            continue;
+        }
+        decodeLaunch(name, &launch, &before, &after);
+        freeSnapshot(&before);
+        freeSnapshot(&after);
+    }
+    free(data);
+    return rc;
+}
+
+static void summarize(void) {
+    unsigned i, t;
+
+    printf("growth per image:\n");
+    printf("  %-24s %8s %-12s %12s %12s\n", "image", "launches", "type", "total", "max");
+    for (i = 0; i < imageCount; i++) {
+        for (t = 0; t < TYPE_BINS; t++) {
+            if (images[i].Total[t] != 0 || images[i].Max[t] > 0)
+                printf("  %-24s %8u %-12s %+12lld %+12lld\n", images[i].Name, images[i].Launches, typeNames[t],
+                    (long long) images[i].Total[t], (long long) images[i].Max[t]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int i = 1, rc = 0;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-c") == 0) {
+            csv = 1;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "usage: %s [-c] [-v] file...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (i == argc) {
+        fprintf(stderr, "usage: %s [-c] [-v] file...\n", argv[0]);
+        return 2;
+    }
+    if (csv)
+        printf("file,launch,image,status,type,before,after,delta\n");
+    for (; i < argc; i++)
+        rc |= decode(argv[i]);
+    if (!csv && imageCount > 0)
+        summarize();
+    return rc;
+}
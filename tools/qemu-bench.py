@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+#
+# grml-plus UEFI tools - boot latency benchmark under QEMU and OVMF
+#
+# Copyright 2026 Michael Schierl <schierlm@gmx.de>
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#
+# Redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the
+# distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+# INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+# STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+# OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+"""
+Boots the tools from a FAT ESP image under QEMU with OVMF and measures the
+time from the first tool's entry point to the StartImage of the child that
+replaces GRUB (bootbench-child.efi). The menus are answered with Enter over
+the serial console, and the time spent waiting for that key is reported
+separately and left out of the net figure. The child then reads every
+file in \\bootbench, a few hundred small files standing in for GRUB's
+modules, fonts and themes, in 4 KB pieces.
+
+Scenarios:
+  skipsign  \\EFI\\BOOT\\BOOTX64.EFI is skipsign.efi, which starts
+            protector.efi, which starts grub.efi
+  loader    \\EFI\\BOOT\\BOOTX64.EFI is usb-modboot-loader.efi, whose first
+            entry starts \\efi\\boot\\grub.efi
+  loader-lz4  the same with LZ4 compressed images, which the loader
+              decompresses (on the other CPUs, given --smp)
+  loader-cache  the loader scenario with the loader's read cache switched
+                on (hidden key C) before the entry is started
+
+One CSV line per scenario and run is written, all times in milliseconds:
+  scenario,run,firmware_to_entry,entry_to_child,menu_wait,net,
+  load_image,start_image_to_child,child_reads
+
+With --secure-boot, OVMF is started with SMM and secure flash, which needs
+a Secure Boot capable OVMF_CODE and an OVMF_VARS with keys enrolled; the
+first stage image is signed with sbsign when --sign-key/--sign-cert are
+given, all other images are unsigned and have to get past the tools'
+security policy.
+
+With --smp N, the guest gets N virtual CPUs, so the loader's work pool has
+N - 1 application processors to decompress .lz4 images on.
+
+With --usb, the ESP is attached as a USB stick (usb-storage on an XHCI
+controller) instead of a virtio disk, where every read command costs more;
+compare child_reads of loader and loader-cache there.
+
+Needs qemu-system-x86_64, OVMF, mtools and lz4.
+"""
+
+import argparse
+import os
+import random
+import re
+import select
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+PERF_MENU_WAIT = 5
+PERF_LOAD_IMAGE = 6
+PERF_START_IMAGE = 7
+
+HEADER = struct.Struct("<IHHIIQQ")
+RECORD = struct.Struct("<HHIQQ")
+
+SCENARIOS = {
+    "skipsign": {
+        "files": {
+            "EFI/BOOT/BOOTX64.EFI": "skipsign.efi",
+            "EFI/BOOT/protector.efi": "protector.efi",
+            "EFI/BOOT/grub.efi": "bootbench-child.efi",
+        },
+        "first": "BootPerfSkipSign",
+        "menus": [("grml-plus UEFI Protector", b"\r")],
+    },
+    "loader": {
+        "files": {
+            "EFI/BOOT/BOOTX64.EFI": "usb-modboot-loader.efi",
+            "EFI/BOOT/grub.efi": "bootbench-child.efi",
+            "usb-modboot/memtest.efi": "bootbench-child.efi",
+        },
+        "first": "BootPerfLoader",
+        "menus": [("USB-ModBoot UEFI Loader", b"\r")],
+    },
+    "loader-lz4": {
+        "files": {
+            "EFI/BOOT/BOOTX64.EFI": "usb-modboot-loader.efi",
+            "EFI/BOOT/grub.efi.lz4": "bootbench-child.efi",
+            "usb-modboot/memtest.efi.lz4": "bootbench-child.efi",
+        },
+        "first": "BootPerfLoader",
+        "menus": [("USB-ModBoot UEFI Loader", b"\r")],
+    },
+    "loader-cache": {
+        "files": {
+            "EFI/BOOT/BOOTX64.EFI": "usb-modboot-loader.efi",
+            "EFI/BOOT/grub.efi": "bootbench-child.efi",
+            "usb-modboot/memtest.efi": "bootbench-child.efi",
+        },
+        "first": "BootPerfLoader",
+        "menus": [("USB-ModBoot UEFI Loader", b"c\r")],
+    },
+}
+
+# sizes of the files the child reads, about what GRUB loads from a grml stick
+READ_FILES = 300
+READ_SMALL = (1 << 10, 48 << 10)
+READ_LARGE = [2400 << 10, 600 << 10, 300 << 10]
+
+ANSI = re.compile(r"\x1b\[[0-9;?]*[A-Za-z]|\x1b[()][0-9A-Za-z]")
+
+
+def run(cmd):
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+
+
+def make_esp(path, files, builddir, sign):
+    with open(path, "wb") as f:
+        f.truncate(64 << 20)
+    run(["mformat", "-i", path, "-F", "::"])
+    dirs = sorted({os.path.dirname(dest) for dest in files})
+    for d in dirs:
+        parts = d.split("/")
+        for i in range(1, len(parts) + 1):
+            sub = "/".join(parts[:i])
+            subprocess.run(["mmd", "-i", path, "::/" + sub], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    for dest, src in files.items():
+        src = os.path.join(builddir, src)
+        if dest == "EFI/BOOT/BOOTX64.EFI" and sign:
+            signed = path + ".signed.efi"
+            run(["sbsign", "--key", sign[0], "--cert", sign[1], "--output", signed, src])
+            src = signed
+        if dest.endswith(".lz4"):
+            compressed = path + "." + os.path.basename(dest)
+            run(["lz4", "-q", "-f", "-9", "--content-size", src, compressed])
+            src = compressed
+        run(["mcopy", "-i", path, src, "::/" + dest])
+    reads = path + ".bootbench"
+    os.mkdir(reads)
+    rand = random.Random(1)
+    sizes = READ_LARGE + [rand.randint(*READ_SMALL) for _ in range(READ_FILES - len(READ_LARGE))]
+    for i, size in enumerate(sizes):
+        with open(os.path.join(reads, "f%03d.mod" % i), "wb") as f:
+            f.write(rand.randbytes(size))
+    run(["mcopy", "-i", path, "-s", reads, "::/bootbench"])
+
+
+def qemu_command(args, esp, varsfile):
+    machine = "q35,smm=on" if args.secure_boot else "q35"
+    cmd = [args.qemu, "-machine", machine, "-m", "512", "-smp", str(args.smp), "-nodefaults", "-vga", "std", "-display", "none",
+           "-serial", "stdio", "-monitor", "none",
+           "-drive", "if=pflash,format=raw,unit=0,readonly=on,file=" + args.ovmf_code,
+           "-drive", "if=pflash,format=raw,unit=1,file=" + varsfile]
+    if args.usb:
+        cmd += ["-device", "qemu-xhci", "-drive", "if=none,id=stick,format=raw,file=" + esp,
+                "-device", "usb-storage,drive=stick,removable=on"]
+    else:
+        cmd += ["-drive", "if=virtio,format=raw,file=" + esp]
+    if args.secure_boot:
+        cmd += ["-global", "driver=cfi.pflash01,property=secure,value=on"]
+    if os.access("/dev/kvm", os.R_OK | os.W_OK):
+        cmd += ["-accel", "kvm", "-cpu", "host"]
+    return cmd
+
+
+def boot(args, esp, varsfile, menus):
+    """returns the serial output lines starting with BOOTBENCH"""
+    proc = subprocess.Popen(qemu_command(args, esp, varsfile), stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL)
+    output = ""
+    pending = list(menus)
+    deadline = time.time() + args.timeout
+    try:
+        while time.time() < deadline and "BOOTBENCH end" not in output:
+            ready, _, _ = select.select([proc.stdout], [], [], 0.1)
+            if ready:
+                data = os.read(proc.stdout.fileno(), 65536)
+                if not data:
+                    break
+                output += ANSI.sub("", data.decode("latin-1")).replace("\r", "")
+            if pending and pending[0][0] in output:
+                time.sleep(args.key_delay)
+                proc.stdin.write(pending.pop(0)[1])
+                proc.stdin.flush()
+    finally:
+        try:
+            proc.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            proc.wait()
+    if "BOOTBENCH end" not in output:
+        sys.stderr.write(output[-2000:] + "\n")
+        raise RuntimeError("no benchmark output before the timeout")
+    return [line.strip() for line in output.split("\n") if line.strip().startswith("BOOTBENCH")]
+
+
+def parse(lines):
+    child = None
+    reads = None
+    dumps = {}
+    for line in lines:
+        words = line.split()
+        if words[1] == "child":
+            child = (int(words[2]), int(words[3]))
+        elif words[1] == "reads":
+            reads = int(words[4])
+        elif words[1] != "end" and len(words) == 4:
+            data = dumps.setdefault(words[1], bytearray())
+            if int(words[2]) == len(data):
+                data += bytes.fromhex(words[3])
+    perf = {}
+    for name, data in dumps.items():
+        signature, version, headersize, count, flags, freq, entry = HEADER.unpack_from(data)
+        records = [RECORD.unpack_from(data, headersize + i * RECORD.size) for i in range(count)
+                   if headersize + (i + 1) * RECORD.size <= len(data)]
+        perf[name] = (freq, entry, [(phase, cnt, start, ticks) for phase, cnt, _, start, ticks in records])
+    return child, reads, perf
+
+
+def measure(child, reads, perf, first):
+    childtsc, childfreq = child
+    freq, entry, _ = perf[first]
+    freq = freq or childfreq
+    ms = lambda ticks: ticks * 1000.0 / freq
+    records = [r for _, _, recs in perf.values() for r in recs]
+    menu = sum(ticks for phase, _, _, ticks in records if phase == PERF_MENU_WAIT)
+    load = sum(ticks for phase, cnt, _, ticks in records if phase == PERF_LOAD_IMAGE and cnt)
+    starts = [start for phase, cnt, start, _ in records if phase == PERF_START_IMAGE and cnt == 0]
+    last_start = max(starts) if starts else childtsc
+    return [ms(entry), ms(childtsc - entry), ms(menu), ms(childtsc - entry - menu), ms(load), ms(childtsc - last_start),
+            reads * 1000.0 / childfreq if reads is not None else None]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("--ovmf-code", default="/usr/share/OVMF/OVMF_CODE.fd")
+    parser.add_argument("--ovmf-vars", default="/usr/share/OVMF/OVMF_VARS.fd")
+    parser.add_argument("--secure-boot", action="store_true")
+    parser.add_argument("--sign-key")
+    parser.add_argument("--sign-cert")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--smp", type=int, default=1, help="number of virtual CPUs")
+    parser.add_argument("--usb", action="store_true", help="attach the ESP as a USB stick")
+    parser.add_argument("--scenario", action="append", choices=sorted(SCENARIOS))
+    parser.add_argument("--timeout", type=float, default=120)
+    parser.add_argument("--key-delay", type=float, default=0.5, help="seconds to wait before answering a menu")
+    parser.add_argument("--builddir", default=".")
+    parser.add_argument("-o", "--output", default="qemu-bench.csv")
+    args = parser.parse_args()
+    sign = (args.sign_key, args.sign_cert) if args.sign_key and args.sign_cert else None
+
+    tmp = tempfile.mkdtemp(prefix="qemu-bench.")
+    try:
+        with open(args.output, "w") as out:
+            out.write("scenario,run,firmware_to_entry,entry_to_child,menu_wait,net,load_image,start_image_to_child,child_reads\n")
+            for name in args.scenario or sorted(SCENARIOS):
+                scenario = SCENARIOS[name]
+                esp = os.path.join(tmp, name + ".img")
+                make_esp(esp, scenario["files"], args.builddir, sign)
+                for i in range(args.runs):
+                    varsfile = os.path.join(tmp, "vars.fd")
+                    shutil.copyfile(args.ovmf_vars, varsfile)
+                    child, reads, perf = parse(boot(args, esp, varsfile, scenario["menus"]))
+                    if child is None or scenario["first"] not in perf:
+                        raise RuntimeError("%s: incomplete benchmark output" % name)
+                    values = measure(child, reads, perf, scenario["first"])
+                    out.write("%s,%d,%s\n" % (name, i, ",".join("" if v is None else "%.3f" % v for v in values)))
+                    out.flush()
+                    print("%-8s run %d: %.1f ms net (%.1f ms in menus), %s ms reading files" % (name, i, values[3], values[2],
+                          "-" if values[6] is None else "%.1f" % values[6]))
+    finally:
+        shutil.rmtree(tmp)
+
+
+if __name__ == "__main__":
+    main()
@@ -16,337 +16,596 @@
 #include <efilib.h>
 #include <efierr.h>
 
+#include "bootperf.h"
+#include "efiabi.h"
+#include "security.h"
+#include "prefetch.h"
+#include "common.h"
+#include "mediabench.h"
+#include "callbench.h"
+#include "mpbench.h"
+#include "workpool.h"
+#include "hotkey.h"
+#include "timeline.h"
+#include "arena.h"
+#include "screen.h"
+#include "ramdisk.h"
+#include "blockcache.h"
+
 #define EFI_OS_INDICATIONS_BOOT_TO_FW_UI 0x0000000000000001
 
-EFI_GUID SECURITY_PROTOCOL_GUID = { 0xA46423E3, 0x4617, 0x49f1, {0xB9, 0xFF, 0xD1, 0xBF, 0xA9, 0x11, 0x58, 0x39 } };
-EFI_GUID SECURITY2_PROTOCOL_GUID = { 0x94ab2f58, 0x1438, 0x4ef1, {0x91, 0x52, 0x18, 0x94, 0x1a, 0x3a, 0x0e, 0x68 } };
 EFI_GUID EFI_GLOBAL_VARIABLE_GUID = { 0x8BE4DF61, 0x93CA, 0x11d2, {0xAA, 0x0D, 0x00, 0xE0, 0x98, 0x03, 0x2B, 0x8C} };
 
-/*
- * See the UEFI Platform Initialization manual (Vol2: DXE) for this
- */
-struct _EFI_SECURITY2_PROTOCOL;
-struct _EFI_SECURITY_PROTOCOL;
-typedef struct _EFI_SECURITY2_PROTOCOL EFI_SECURITY2_PROTOCOL;
-typedef struct _EFI_SECURITY_PROTOCOL EFI_SECURITY_PROTOCOL;
-typedef EFI_DEVICE_PATH EFI_DEVICE_PATH_PROTOCOL;
-typedef EFI_STATUS (EFIAPI *EFI_SECURITY_FILE_AUTHENTICATION_STATE) (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
-        const EFI_DEVICE_PATH_PROTOCOL *File);
-typedef EFI_STATUS (EFIAPI *EFI_SECURITY2_FILE_AUTHENTICATION) (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
-        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy);
-
-struct _EFI_SECURITY2_PROTOCOL {
-    EFI_SECURITY2_FILE_AUTHENTICATION FileAuthentication;
-};
-
-struct _EFI_SECURITY_PROTOCOL {
-    EFI_SECURITY_FILE_AUTHENTICATION_STATE  FileAuthenticationState;
-};
-
-static EFI_SECURITY_FILE_AUTHENTICATION_STATE esfas = NULL;
-static EFI_SECURITY2_FILE_AUTHENTICATION es2fa = NULL;
-
-static EFI_STATUS thunk_security_policy_authentication(const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
-        const EFI_DEVICE_PATH_PROTOCOL *DevicePath)
-__attribute__((unused));
-
-static EFI_STATUS thunk_security2_policy_authentication(const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
-        VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy)
-__attribute__((unused));
-
-static __attribute__((used)) EFI_STATUS security2_policy_authentication (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+__attribute__((used)) EFI_STATUS EFI_CALLBACK security2_policy_authentication (const EFI_SECURITY2_PROTOCOL *This, const EFI_DEVICE_PATH_PROTOCOL *DevicePath,
         VOID *FileBuffer, UINTN FileSize, BOOLEAN BootPolicy) {
 
     return EFI_SUCCESS;
 }
 
-static __attribute__((used)) EFI_STATUS security_policy_authentication (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
+__attribute__((used)) EFI_STATUS EFI_CALLBACK security_policy_authentication (const EFI_SECURITY_PROTOCOL *This, UINT32 AuthenticationStatus,
         const EFI_DEVICE_PATH_PROTOCOL *DevicePathConst) {
 
     return EFI_SUCCESS;
 }
 
+#define MODBOOT_DIRECTORY L"\\usb-modboot"
+#define GRUB_PATH L"\\efi\\boot\\grub.efi"
+#define MENU_WIDTH 23
+/* load options of a soft restarted copy that must not offer Exit either */
+#define NO_EXIT_OPTION L"noexit"
 
-/* Nasty: ELF and EFI have different calling conventions.  Here is the map for
- * calling ELF -> EFI
- *
- *   1) rdi -> rcx (32 saved)
- *   2) rsi -> rdx (32 saved)
- *   3) rdx -> r8 ( 32 saved)
- *   4) rcx -> r9 (32 saved)
- *   5) r8 -> 32(%rsp) (48 saved)
- *   6) r9 -> 40(%rsp) (48 saved)
- *   7) pad+0(%rsp) -> 48(%rsp) (64 saved)
- *   8) pad+8(%rsp) -> 56(%rsp) (64 saved)
- *   9) pad+16(%rsp) -> 64(%rsp) (80 saved)
- *  10) pad+24(%rsp) -> 72(%rsp) (80 saved)
- *  11) pad+32(%rsp) -> 80(%rsp) (96 saved)
+static WORK_POOL workPool;
+static HOTKEYS hotkeys;
+static BLOCK_CACHE blockCache;
 
- *
- * So for a five argument callback, the map is ignore the first two arguments
- * and then map (EFI -> ELF) assuming pad = 0.
- *
- * ARG4  -> ARG1
- * ARG3  -> ARG2
- * ARG5  -> ARG3
- * ARG6  -> ARG4
- * ARG11 -> ARG5
- *
- * Calling conventions also differ over volatile and preserved registers in
- * MS: RBX, RBP, RDI, RSI, R12, R13, R14, and R15 are considered nonvolatile .
- * In ELF: Registers %rbp, %rbx and %r12 through %r15 “belong” to the calling
- * function and the called function is required to preserve their values.
- *
- * This means when accepting a function callback from MS -> ELF, we have to do
- * separate preservation on %rdi, %rsi before swizzling the arguments and
- * handing off to the ELF function.
- */
-
-asm (
-".type security2_policy_authentication,@function\n"
-"thunk_security2_policy_authentication:\n\t"
-    "mov    0x28(%rsp), %r10    # ARG5\n\t"
-    "push    %rdi\n\t"
-    "push    %rsi\n\t"
-    "mov    %r10, %rdi\n\t"
-    "subq    $8, %rsp    # space for storing stack pad\n\t"
-    "mov    $0x08, %rax\n\t"
-    "mov    $0x10, %r10\n\t"
-    "and    %rsp, %rax\n\t"
-    "cmovnz    %rax, %r11\n\t"
-    "cmovz    %r10, %r11\n\t"
-    "subq    %r11, %rsp\n\t"
-    "addq    $8, %r11\n\t"
-    "mov    %r11, (%rsp)\n\t"
-"# five argument swizzle\n\t"
-    "mov    %rdi, %r10\n\t"
-    "mov    %rcx, %rdi\n\t"
-    "mov    %rdx, %rsi\n\t"
-    "mov    %r8, %rdx\n\t"
-    "mov    %r9, %rcx\n\t"
-    "mov    %r10, %r8\n\t"
-    "callq    security2_policy_authentication@PLT\n\t"
-    "mov    (%rsp), %r11\n\t"
-    "addq    %r11, %rsp\n\t"
-    "pop    %rsi\n\t"
-    "pop    %rdi\n\t"
-    "ret\n"
-);
-
-asm (
-".type security_policy_authentication,@function\n"
-"thunk_security_policy_authentication:\n\t"
-    "push    %rdi\n\t"
-    "push    %rsi\n\t"
-    "subq    $8, %rsp    # space for storing stack pad\n\t"
-    "mov    $0x08, %rax\n\t"
-    "mov    $0x10, %r10\n\t"
-    "and    %rsp, %rax\n\t"
-    "cmovnz    %rax, %r11\n\t"
-    "cmovz    %r10, %r11\n\t"
-    "subq    %r11, %rsp\n\t"
-    "addq    $8, %r11\n\t"
-    "mov    %r11, (%rsp)\n\t"
-"# three argument swizzle\n\t"
-    "mov    %rcx, %rdi\n\t"
-    "mov    %rdx, %rsi\n\t"
-    "mov    %r8, %rdx\n\t"
-    "callq    security_policy_authentication@PLT\n\t"
-    "mov    (%rsp), %r11\n\t"
-    "addq    %r11, %rsp\n\t"
-    "pop    %rsi\n\t"
-    "pop    %rdi\n\t"
-    "ret\n"
-);
-
-EFI_STATUS security_policy_install(void) {
-    EFI_SECURITY_PROTOCOL *security_protocol;
-    EFI_SECURITY2_PROTOCOL *security2_protocol = NULL;
-    EFI_STATUS status;
-
-    if (esfas)
-        /* Already Installed */
-        return EFI_ALREADY_STARTED;
+/* the hidden benchmark keys read ConIn themselves, they are polled */
+static EFI_INPUT_KEY menuKeys[] = {
+    { SCAN_UP, 0 }, { SCAN_DOWN, 0 }, { SCAN_NULL, CHAR_CARRIAGE_RETURN }, { SCAN_NULL, L' ' }
+};
+/* before anything was set up, to check a soft restart against */
+static UINT64 entryPages[EfiMaxMemoryType];
+
+typedef enum {
+    ACTION_BOOT,
+    ACTION_RAMDISK,
+    ACTION_TIMELINE,
+    ACTION_RESTART,
+    ACTION_EXIT,
+    ACTION_FWSETUP,
+    ACTION_REBOOT,
+    ACTION_HALT
+} MENU_ACTION;
+
+typedef struct {
+    CHAR16 *Label;
+    CHAR16 *FileName;     /* full path for ACTION_BOOT and ACTION_RAMDISK entries, from the pool */
+    UINT64 FileSize;      /* 0 if not known */
+    MENU_ACTION Action;
+    BOOLEAN Visible;
+} MENU_ENTRY;
+
+typedef struct {
+    MENU_ENTRY *Entries;
+    UINTN Count;
+    UINTN Capacity;
+} MENU;
+
+/* well-known tools keep their names and their place in the menu */
+static struct {
+    CHAR16 *FileName;
+    CHAR16 *Label;
+} knownTools[] = {
+    { L"memtest.efi", L"Memtest" },
+    { L"efi-shell.efi", L"EFI Shell" },
+    { L"uefi-shell.efi", L"UEFI Shell" }
+};
 
-    /* Don't bother with status here.  The call is allowed
-     * to fail, since SECURITY2 was introduced in PI 1.2.1
-     * If it fails, use security2_protocol == NULL as indicator */
-    LibLocateProtocol(&SECURITY2_PROTOCOL_GUID, (void**) &security2_protocol);
+/*
+ * Takes over FileName (from the pool, NULL for entries without a file). If
+ * memory runs out, the entry is left out and FileName freed; the entries
+ * added so far stay.
+ */
+static VOID addEntry(MENU *Menu, CHAR16 *Label, CHAR16 *FileName, UINT64 FileSize, MENU_ACTION Action) {
+    MENU_ENTRY *entry, *entries;
+    CHAR16 *padded;
+    UINTN i, width;
+
+    if ((Action == ACTION_BOOT || Action == ACTION_RAMDISK) && FileName == NULL)
+        return;
+    /* " Label ", padded so that the highlight bar has the same width on every line */
+    width = StrLen(Label) + 2 > MENU_WIDTH ? StrLen(Label) + 2 : MENU_WIDTH;
+    padded = AllocatePool((width + 1) * sizeof(CHAR16));
+    if (padded != NULL && Menu->Count == Menu->Capacity) {
+        /* ReallocatePool leaves the old array alone if it fails */
+        entries = ReallocatePool(Menu->Entries, Menu->Capacity * sizeof(MENU_ENTRY),
+            (Menu->Capacity + 8) * sizeof(MENU_ENTRY));
+        if (entries == NULL) {
+            FreePool(padded);
+            padded = NULL;
+        } else {
+            Menu->Entries = entries;
+            Menu->Capacity += 8;
+        }
+    }
+    if (padded == NULL) {
+        if (FileName)
+            FreePool(FileName);
+        return;
+    }
+    entry = &Menu->Entries[Menu->Count++];
+    entry->Label = padded;
+    for (i = 0; i < width; i++)
+        entry->Label[i] = L' ';
+    CopyMem(entry->Label + 1, Label, StrLen(Label) * sizeof(CHAR16));
+    entry->Label[width] = L'\0';
+    entry->FileName = FileName;
+    entry->FileSize = FileSize;
+    entry->Action = Action;
+    entry->Visible = TRUE;
+}
 
-    status = LibLocateProtocol(&SECURITY_PROTOCOL_GUID, (void**) &security_protocol);
-    if (status != EFI_SUCCESS)
-        /* This one is mandatory, so there's a serious problem */
-        return status;
+static VOID freeMenu(MENU *Menu) {
+    UINTN i;
 
-    if (security2_protocol) {
-        es2fa = security2_protocol->FileAuthentication;
-        security2_protocol->FileAuthentication = thunk_security2_policy_authentication;
-        /* check for security policy in write protected memory */
-        if (security2_protocol->FileAuthentication != thunk_security2_policy_authentication)
-            return EFI_ACCESS_DENIED;
+    for (i = 0; i < Menu->Count; i++) {
+        FreePool(Menu->Entries[i].Label);
+        if (Menu->Entries[i].FileName)
+            FreePool(Menu->Entries[i].FileName);
     }
+    if (Menu->Entries)
+        FreePool(Menu->Entries);
+    Menu->Entries = NULL;
+    Menu->Count = Menu->Capacity = 0;
+}
 
-    esfas = security_protocol->FileAuthenticationState;
-    security_protocol->FileAuthenticationState = thunk_security_policy_authentication;
-    /* check for security policy in write protected memory */
-    if (security_protocol->FileAuthenticationState != thunk_security_policy_authentication)
-        return EFI_ACCESS_DENIED;
+/* length of a tool file name without its .efi or .efi.lz4 suffix */
+static UINTN baseNameLength(CHAR16 *FileName) {
+    UINTN len = StrLen(FileName);
 
-    return EFI_SUCCESS;
+    if (lz4IsCompressed(FileName))
+        len -= StrLen(LZ4_SUFFIX);
+    return len > 4 ? len - 4 : 0;
 }
 
-EFI_STATUS security_policy_uninstall(void) {
-    EFI_STATUS status;
+static BOOLEAN isEfiFile(EFI_FILE_INFO *Info) {
+    UINTN len = StrLen(Info->FileName);
+    CHAR16 suffix[5];
+
+    if (lz4IsCompressed(Info->FileName))
+        len -= StrLen(LZ4_SUFFIX);
+    if ((Info->Attribute & EFI_FILE_DIRECTORY) != 0 || len <= 4)
+        return FALSE;
+    CopyMem(suffix, Info->FileName + len - 4, 4 * sizeof(CHAR16));
+    suffix[4] = L'\0';
+    return StriCmp(suffix, L".efi") == 0;
+}
 
-    if (esfas) {
-        EFI_SECURITY_PROTOCOL *security_protocol;
+/* TRUE if Name, compressed or not, is the uncompressed image name Other */
+static BOOLEAN sameTool(CHAR16 *Name, CHAR16 *Other) {
+    UINTN len = StrLen(Name);
+    CHAR16 saved;
+    BOOLEAN same;
+
+    if (!lz4IsCompressed(Name))
+        return StriCmp(Name, Other) == 0;
+    len -= StrLen(LZ4_SUFFIX);
+    saved = Name[len];
+    Name[len] = L'\0';
+    same = StriCmp(Name, Other) == 0;
+    Name[len] = saved;
+    return same;
+}
 
-        status = LibLocateProtocol(&SECURITY_PROTOCOL_GUID, (void**) &security_protocol);
+/*
+ * Read the tool directory once instead of opening every candidate file, and
+ * add an entry for each image found. The well-known tools come first, in
+ * their usual order; everything else follows sorted by file name. Disk and
+ * CD images are booted from a RAM disk and keep their suffix in the label.
+ */
+static VOID scanToolDirectory(EFI_FILE_HANDLE Root, MENU *Menu) {
+    EFI_FILE_HANDLE dir;
+    EFI_FILE_INFO *info, **found = NULL;
+    EFI_STATUS status;
+    UINTN bufferSize = SIZE_OF_EFI_FILE_INFO + 256 * sizeof(CHAR16), size;
+    UINTN count = 0, capacity = 0, i, j;
+    CHAR16 *path, *label;
+
+    if (uefi_call_wrapper(Root->Open, 5, Root, &dir, MODBOOT_DIRECTORY, EFI_FILE_MODE_READ, 0) != EFI_SUCCESS)
+        return;
+    info = AllocatePool(bufferSize);
+    while (info != NULL) {
+        size = bufferSize;
+        status = uefi_call_wrapper(dir->Read, 3, dir, &size, info);
+        if (status == EFI_BUFFER_TOO_SMALL) {
+            FreePool(info);
+            bufferSize = size;
+            info = AllocatePool(bufferSize);
+            continue;
+        }
+        if (status != EFI_SUCCESS || size == 0)
+            break;
+        if (!isEfiFile(info) && ((info->Attribute & EFI_FILE_DIRECTORY) != 0 || !ramDiskIsImage(info->FileName)))
+            continue;
+        if (count == capacity) {
+            found = ReallocatePool(found, capacity * sizeof(EFI_FILE_INFO *), (capacity + 16) * sizeof(EFI_FILE_INFO *));
+            if (found == NULL) {
+                count = 0;
+                break;
+            }
+            capacity += 16;
+        }
+        found[count] = AllocatePool(size);
+        if (found[count] == NULL)
+            break;
+        CopyMem(found[count++], info, size);
+    }
+    if (info)
+        FreePool(info);
+    uefi_call_wrapper(dir->Close, 1, dir);
+
+    /* insertion sort, known tools first */
+    for (i = 1; i < count; i++) {
+        info = found[i];
+        for (j = i; j > 0 && StriCmp(found[j-1]->FileName, info->FileName) > 0; j--)
+            found[j] = found[j-1];
+        found[j] = info;
+    }
+    /* a compressed image replaces the uncompressed one of the same tool */
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < count && found[i] != NULL && lz4IsCompressed(found[i]->FileName); j++) {
+            if (found[j] != NULL && !lz4IsCompressed(found[j]->FileName) &&
+                    sameTool(found[i]->FileName, found[j]->FileName)) {
+                FreePool(found[j]);
+                found[j] = NULL;
+            }
+        }
+    }
+    for (i = 0; i < sizeof(knownTools) / sizeof(knownTools[0]); i++) {
+        for (j = 0; j < count; j++) {
+            if (found[j] != NULL && sameTool(found[j]->FileName, knownTools[i].FileName)) {
+                path = PoolPrint(L"%s\\%s", MODBOOT_DIRECTORY, found[j]->FileName);
+                addEntry(Menu, knownTools[i].Label, path, found[j]->FileSize, ACTION_BOOT);
+                FreePool(found[j]);
+                found[j] = NULL;
+            }
+        }
+    }
+    for (j = 0; j < count; j++) {
+        if (found[j] == NULL)
+            continue;
+        path = PoolPrint(L"%s\\%s", MODBOOT_DIRECTORY, found[j]->FileName);
+        label = StrDuplicate(found[j]->FileName);
+        if (label == NULL) {
+            if (path)
+                FreePool(path);
+            FreePool(found[j]);
+            continue;
+        }
+        if (ramDiskIsImage(label)) {
+            addEntry(Menu, label, path, found[j]->FileSize, ACTION_RAMDISK);
+            FreePool(label);
+            FreePool(found[j]);
+            continue;
+        }
+        label[baseNameLength(label)] = L'\0';
+        addEntry(Menu, label, path, found[j]->FileSize, ACTION_BOOT);
+        FreePool(label);
+        FreePool(found[j]);
+    }
+    if (found)
+        FreePool(found);
+}
 
-        if (status != EFI_SUCCESS)
-            return status;
+/*
+ * Everything the loader allocated has been given back by now. Unlike the
+ * protector, the loader does not follow the allocations of the images it
+ * starts, so what they left behind is only reported. If no fresh copy can be
+ * loaded and Exit is not safe, a cold reset is the way out.
+ */
+static EFI_STATUS softRestart(EFI_HANDLE ImageHandle, BOOLEAN MayExit) {
+    EFI_INPUT_KEY key;
+    EFI_STATUS status;
+    BOOLEAN restarted;
 
-        security_protocol->FileAuthenticationState = esfas;
-        esfas = NULL;
-    } else {
-        /* nothing installed */
-        return EFI_NOT_STARTED;
+    uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+    if (!memoryMapCheck(entryPages)) {
+        Print(L"\nMemory map not back to its starting state, press any key to restart anyway\n");
+        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
     }
+    status = restartImage(ImageHandle, MayExit ? NULL : NO_EXIT_OPTION, &restarted);
+    if (restarted)
+        return status;
+    Print(L"Cannot reload loader: %r\n", status);
+    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+    uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+    if (!MayExit)
+        uefi_call_wrapper(RT->ResetSystem, 4, EfiResetCold, EFI_SUCCESS, 0, NULL);
+    return status;
+}
 
-    if (es2fa) {
-        EFI_SECURITY2_PROTOCOL *security2_protocol;
+/* moves Cursor by Step (+1/-1) to the next visible entry, if there is one */
+static UINTN moveCursor(MENU *Menu, UINTN Cursor, INTN Step) {
+    UINTN i = Cursor;
 
-        status = LibLocateProtocol(&SECURITY2_PROTOCOL_GUID, (void**) &security2_protocol);
+    while ((Step < 0 && i > 0) || (Step > 0 && i + 1 < Menu->Count)) {
+        i += Step;
+        if (Menu->Entries[i].Visible)
+            return i;
+    }
+    return Cursor;
+}
 
-        if (status != EFI_SUCCESS)
-            return status;
+/* once a child image ran, the firmware may not expect us to return any more */
+static VOID disableExit(MENU *Menu) {
+    UINTN i;
 
-        security2_protocol->FileAuthentication = es2fa;
-        es2fa = NULL;
+    for (i = 0; i < Menu->Count; i++) {
+        if (Menu->Entries[i].Action == ACTION_EXIT)
+            Menu->Entries[i].Visible = FALSE;
     }
-
-    return EFI_SUCCESS;
 }
 
-static void printColor(UINTN color, CHAR16* string) {
-    uefi_call_wrapper(ST->ConOut->SetAttribute, 2, ST->ConOut, color);
-    Print(string);
-}
+/* what the read cache did for the image that just returned, or why it did not run */
+static VOID showCacheReport(EFI_STATUS Status) {
+    TEXT_LINES lines = { NULL, 0, 0 };
 
-#define MENU_COUNT 8
-#define FILE_COUNT 4
+    if (Status == EFI_SUCCESS)
+        blockCacheReport(&blockCache, &lines);
+    else
+        textLinesAdd(&lines, PoolPrint(L"The read cache did not start: %r", Status));
+    textLinesShow(&lines, L"Read cache");
+    textLinesFree(&lines);
+}
 
-EFI_STATUS EFIAPI efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
+EFI_STATUS efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable) {
     EFI_GUID simpleFSProtocol = SIMPLE_FILE_SYSTEM_PROTOCOL;
     EFI_GUID loadedImageProtocol = LOADED_IMAGE_PROTOCOL;
     EFI_STATUS status;
     EFI_INPUT_KEY key;
     EFI_FILE_IO_INTERFACE *drive;
-    EFI_FILE_HANDLE root, file;
+    EFI_FILE_HANDLE root;
     EFI_LOADED_IMAGE *loadedImage;
     EFI_HANDLE newImage;
     EFI_DEVICE_PATH *dp;
-    UINTN cursor = 0, i, cursorRow;
-    UINT64 value;
-    UINTN dataSize;
-
-    const int EXIT_ENTRY = FILE_COUNT, FWSETUP_ENTRY = EXIT_ENTRY + 1;
-    const int REBOOT_ENTRY = FWSETUP_ENTRY + 1, HALT_ENTRY = REBOOT_ENTRY + 1;
-    // first and last entry always need to be visible!
-    BOOLEAN visible[MENU_COUNT] = {TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE};
-    CHAR16 *menu[MENU_COUNT] = {
-        L" Continue to boot menu ",
-        L" Memtest               ",
-        L" EFI Shell             ",
-        L" UEFI Shell            ",
-        L" Exit to UEFI          ",
-        L" UEFI Firmware Setup   ",
-        L" Reboot                ",
-        L" Halt                  "
-    };
-    CHAR16 *filename[FILE_COUNT] = {
-        L"\\efi\\boot\\grub.efi",
-        L"\\usb-modboot\\memtest.efi",
-        L"\\usb-modboot\\efi-shell.efi",
-        L"\\usb-modboot\\uefi-shell.efi"
-    };
-
+    ARENA arena;
+    PREFETCH prefetch = { EFI_NOT_STARTED };
+    MENU menu = { NULL, 0, 0 };
+    MENU_ENTRY *entry;
+    RAM_DISK ramDisk;
+    CHAR16 **benchFiles;
+    UINTN cursor = 0, i, cursorRow, top = 0, rows, shown, benchCount = 0;
+    SCREEN screen;
+    UINT64 value, waitStart, keyTsc;
+    UINTN dataSize, record;
+    BOOLEAN useWorkPool = FALSE, restart = FALSE, mayExit = TRUE, useBlockCache = FALSE;
+
+    perfInit(L"BootPerfLoader");
+    record = perfBegin(PERF_INITIALIZE_LIB);
     InitializeLib(ImageHandle, SystemTable);
+    perfEnd(record);
+    memoryMapUsage(entryPages);
+    arenaInit(&arena, ARENA_PAGES);
 
+    record = perfBegin(PERF_SECURITY_INSTALL);
     status = security_policy_install();
+    perfEnd(record);
     if (status != EFI_SUCCESS) {
         Print(L"Failed to install override security policy.\n");
     }
     uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &loadedImageProtocol, (void **)&loadedImage);
-    uefi_call_wrapper(ST->ConIn->Reset, 2, ST->ConIn, FALSE);
-    dataSize = 8;
-    status = uefi_call_wrapper(RT->GetVariable, 5, L"OsIndicationsSupported", &EFI_GLOBAL_VARIABLE_GUID, NULL, &dataSize, &value);
-    visible[FWSETUP_ENTRY] = (status == EFI_SUCCESS && (value & EFI_OS_INDICATIONS_BOOT_TO_FW_UI) != 0);
+    if (loadedImage->LoadOptions != NULL && loadedImage->LoadOptionsSize == sizeof(NO_EXIT_OPTION) &&
+            StrCmp(loadedImage->LoadOptions, NO_EXIT_OPTION) == 0)
+        mayExit = FALSE;
     uefi_call_wrapper(BS->HandleProtocol,3,loadedImage->DeviceHandle, &simpleFSProtocol, (VOID**)&drive);
+    record = perfBegin(PERF_OPEN_VOLUME);
     uefi_call_wrapper(drive->OpenVolume, 2, drive, &root);
-    for (i=1; i<FILE_COUNT; i++) {
-        status = uefi_call_wrapper(root->Open, 5, root, &file, filename[i], EFI_FILE_MODE_READ, 0);
-        if (status == EFI_SUCCESS) {
-            uefi_call_wrapper(file->Close, 1, file);
-        } else {
-            visible[i] = FALSE;
-        }
+    perfEnd(record);
+
+    // first and last entry always need to be visible!
+    addEntry(&menu, L"Continue to boot menu",
+        StrDuplicate(fileExists(root, GRUB_PATH LZ4_SUFFIX) ? GRUB_PATH LZ4_SUFFIX : GRUB_PATH), 0, ACTION_BOOT);
+    record = perfBegin(PERF_FILE_PROBE);
+    scanToolDirectory(root, &menu);
+    perfEnd(record);
+    addEntry(&menu, L"Boot timeline", NULL, 0, ACTION_TIMELINE);
+    addEntry(&menu, L"Soft restart", NULL, 0, ACTION_RESTART);
+    addEntry(&menu, L"Exit to UEFI", NULL, 0, ACTION_EXIT);
+    if (!mayExit)
+        disableExit(&menu);
+    dataSize = 8;
+    status = uefi_call_wrapper(RT->GetVariable, 5, L"OsIndicationsSupported", &EFI_GLOBAL_VARIABLE_GUID, NULL, &dataSize, &value);
+    if (status == EFI_SUCCESS && (value & EFI_OS_INDICATIONS_BOOT_TO_FW_UI) != 0)
+        addEntry(&menu, L"UEFI Firmware Setup", NULL, 0, ACTION_FWSETUP);
+    addEntry(&menu, L"Reboot", NULL, 0, ACTION_REBOOT);
+    addEntry(&menu, L"Halt", NULL, 0, ACTION_HALT);
+    if (menu.Count == 0) {
+        Print(L"Out of memory.\n");
+        return EFI_OUT_OF_RESOURCES;
     }
-    uefi_call_wrapper(root->Close, 1, root);
+
+    screenInit(&screen, 80, menu.Count + 5 > 25 ? menu.Count + 5 : 25);
+
+    benchFiles = AllocatePool(menu.Count * sizeof(CHAR16 *));
+    for (i = 0; benchFiles && i < menu.Count; i++) {
+        if (menu.Entries[i].Action == ACTION_BOOT)
+            benchFiles[benchCount++] = menu.Entries[i].FileName;
+    }
+
+    /* the other processors decompress images while the BSP reads them, so they are only needed for .lz4 entries */
+    for (i = 0; i < menu.Count; i++) {
+        if (menu.Entries[i].Action == ACTION_BOOT && lz4IsCompressed(menu.Entries[i].FileName))
+            useWorkPool = TRUE;
+    }
+    if (useWorkPool) {
+        workPoolStart(&workPool, WORK_POOL_MAX_WORKERS);
+        prefetchSetWorkPool(&workPool);
+    }
+    hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+
     while (TRUE) {
-        uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
-        printColor(EFI_LIGHTRED, L"USB-ModBoot UEFI Loader\n");
-        printColor(EFI_LIGHTBLUE, L"(c) 2014, 2017 Michael Schierl\n\n");
-        cursorRow = 3;
-        for (i=0; i < MENU_COUNT; i++) {
-            if (!visible[i])
-                continue;
-            if (i < cursor)
+        arenaReset(&arena);
+        /* the default entry is read while the menu waits for a key */
+        if (prefetch.Status == EFI_NOT_STARTED && menu.Entries[0].FileName != NULL)
+            prefetchStart(&prefetch, root, menu.Entries[0].FileName, menu.Entries[0].FileSize);
+
+        /* three title lines above the entries */
+        rows = screen.Rows > 4 ? screen.Rows - 3 : 1;
+        if (cursor < top)
+            top = cursor;
+        for (i = top, cursorRow = 0; i < cursor; i++) {
+            if (menu.Entries[i].Visible)
                 cursorRow++;
-            printColor(EFI_WHITE, L"    ");
-            printColor ((i == cursor ? EFI_YELLOW : EFI_LIGHTGRAY) | EFI_BACKGROUND_BLUE, menu[i]);
-            printColor(EFI_WHITE, L"\n");
+        }
+        while (cursorRow >= rows) {
+            if (menu.Entries[top++].Visible)
+                cursorRow--;
         }
 
-        uefi_call_wrapper(ST->ConOut->SetCursorPosition, 3, ST->ConOut, 5, cursorRow);
-        WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
-        uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+        screenClear(&screen);
+        screenPrint(&screen, 0, 0, EFI_LIGHTRED, L"USB-ModBoot UEFI Loader");
+        screenPrint(&screen, 0, 1, EFI_LIGHTBLUE, L"(c) 2014, 2017 Michael Schierl");
+        if (useBlockCache)
+            screenPrint(&screen, 0, 2, EFI_DARKGRAY, L"(read cache on)");
+        for (i = top, shown = 0; i < menu.Count && shown < rows; i++) {
+            if (!menu.Entries[i].Visible)
+                continue;
+            screenPrint(&screen, 4, 3 + shown++, (i == cursor ? EFI_YELLOW : EFI_LIGHTGRAY) | EFI_BACKGROUND_BLUE, menu.Entries[i].Label);
+        }
+        screenFlush(&screen, 5, cursorRow + 3);
+
+        waitStart = perfTimestamp();
+        prefetchWaitForKey(&prefetch, hotkeys.Event);
+        perfAccumulate(PERF_MENU_WAIT, waitStart);
+        /* woken by a press that was already acted on */
+        if (hotkeyReadKey(&hotkeys, &key, &keyTsc) != EFI_SUCCESS)
+            continue;
+        screenKeyPressed(&screen, keyTsc);
 
+        entry = &menu.Entries[cursor];
         if (key.ScanCode == SCAN_UP) {
-            if (cursor > 0) {
-                do {
-                    cursor--;
-                } while (!visible[cursor]);
-            }
+            cursor = moveCursor(&menu, cursor, -1);
         } else if (key.ScanCode == SCAN_DOWN) {
-            if (cursor < MENU_COUNT - 1) {
-                do {
-                    cursor++;
-                } while (!visible[cursor]);
-            }
+            cursor = moveCursor(&menu, cursor, 1);
+        } else if (key.UnicodeChar == L'b' || key.UnicodeChar == L'B') {
+            /* hidden: measure read throughput of the boot medium */
+            hotkeyStop(&hotkeys);
+            mediaBenchmark(loadedImage->DeviceHandle, benchFiles, benchCount);
+            hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+            screenInvalidate(&screen);
+        } else if (key.UnicodeChar == L'a' || key.UnicodeChar == L'A') {
+            /* hidden: compare firmware call and callback overhead of both ABI modes */
+            hotkeyStop(&hotkeys);
+            callBenchmark();
+            hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+            screenInvalidate(&screen);
+        } else if (key.UnicodeChar == L'm' || key.UnicodeChar == L'M') {
+            /* hidden: hashing throughput on 1, 2, 4, ... processors */
+            workPoolStop(&workPool);
+            hotkeyStop(&hotkeys);
+            mpBenchmark();
+            hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+            if (useWorkPool)
+                workPoolStart(&workPool, WORK_POOL_MAX_WORKERS);
+            screenInvalidate(&screen);
+        } else if (key.UnicodeChar == L'f' || key.UnicodeChar == L'F') {
+            /* hidden: draw the menu straight into the GOP framebuffer */
+            screenUseGraphics(&screen, screen.FrameBuffer == NULL);
+        } else if (key.UnicodeChar == L'c' || key.UnicodeChar == L'C') {
+            /* hidden: read-ahead cache on the boot disk while a started image runs */
+            useBlockCache = !useBlockCache;
         } else if (key.UnicodeChar == L'\r' || key.UnicodeChar == L' ') {
-            if (cursor < FILE_COUNT) {
-                visible[EXIT_ENTRY] = FALSE;
-                dp = FileDevicePath(loadedImage->DeviceHandle, filename[cursor]);
-                uefi_call_wrapper(BS->LoadImage, 6, FALSE, ImageHandle, dp, NULL, 0, &newImage);
-                FreePool(dp);
-                uefi_call_wrapper(BS->StartImage, 3, newImage, NULL, NULL);
-            } else if (cursor == EXIT_ENTRY) {
+            if (entry->Action == ACTION_BOOT) {
+                mayExit = FALSE;
+                disableExit(&menu);
+                screenInvalidate(&screen);
+                dp = arenaFileDevicePath(&arena, loadedImage->DeviceHandle, entry->FileName);
+                if (cursor != 0) {
+                    prefetchFree(&prefetch);
+                    /* the firmware cannot read compressed images, they always go through a prefetch */
+                    if (lz4IsCompressed(entry->FileName))
+                        prefetchStart(&prefetch, root, entry->FileName, entry->FileSize);
+                }
+                if (loadChildImage(ImageHandle, dp, &prefetch, &newImage) != EFI_SUCCESS)
+                    continue;
+                /* hand the APs back, the child may want to use them */
+                workPoolStop(&workPool);
+                hotkeyStop(&hotkeys);
+                if (useBlockCache)
+                    status = blockCacheStart(&blockCache, loadedImage->DeviceHandle);
+                startChildImage(newImage);
+                blockCacheStop(&blockCache);
+                unloadImage(newImage);
+                if (useBlockCache)
+                    showCacheReport(status);
+                hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+                if (useWorkPool)
+                    workPoolStart(&workPool, WORK_POOL_MAX_WORKERS);
+            } else if (entry->Action == ACTION_RAMDISK) {
+                /* the whole image is read, so let go of the prefetched default entry first */
+                prefetchFree(&prefetch);
+                hotkeyStop(&hotkeys);
+                uefi_call_wrapper(ST->ConOut->ClearScreen, 1, ST->ConOut);
+                status = ramDiskLoad(&ramDisk, root, entry->FileName);
+                if (status == EFI_SUCCESS)
+                    status = loadChildImage(ImageHandle, arenaFileDevicePath(&arena, ramDisk.FileSystem, RAM_DISK_BOOT_FILE),
+                        NULL, &newImage);
+                if (status == EFI_SUCCESS) {
+                    mayExit = FALSE;
+                    disableExit(&menu);
+                    workPoolStop(&workPool);
+                    startChildImage(newImage);
+                    unloadImage(newImage);
+                    if (useWorkPool)
+                        workPoolStart(&workPool, WORK_POOL_MAX_WORKERS);
+                } else if (status != EFI_ABORTED) {
+                    Print(L"Cannot boot %s from a RAM disk: %r\nPress any key to return to the menu\n", entry->FileName, status);
+                    WaitForSingleEvent(ST->ConIn->WaitForKey, 0);
+                    uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+                }
+                ramDiskFree(&ramDisk);
+                hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+                screenInvalidate(&screen);
+            } else if (entry->Action == ACTION_TIMELINE) {
+                hotkeyStop(&hotkeys);
+                timelineScreen(root);
+                hotkeyStart(&hotkeys, menuKeys, sizeof(menuKeys) / sizeof(menuKeys[0]));
+                screenInvalidate(&screen);
+            } else if (entry->Action == ACTION_RESTART) {
+                restart = TRUE;
+                break;
+            } else if (entry->Action == ACTION_EXIT) {
+                perfPublish();
                 break;
-            } else if (cursor == FWSETUP_ENTRY) {
+            } else if (entry->Action == ACTION_FWSETUP) {
                 value = EFI_OS_INDICATIONS_BOOT_TO_FW_UI;
                 uefi_call_wrapper(RT->SetVariable, 5, L"OsIndications", &EFI_GLOBAL_VARIABLE_GUID,
                     EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_NON_VOLATILE, 8, &value);
                 uefi_call_wrapper(RT->ResetSystem, 4, EfiResetCold, EFI_SUCCESS, 0, NULL);
-            } else if (cursor == REBOOT_ENTRY || cursor == HALT_ENTRY) {
-                uefi_call_wrapper(RT->ResetSystem, 4, cursor == REBOOT_ENTRY ? EfiResetCold : EfiResetShutdown, EFI_SUCCESS, 0, NULL);
+            } else {
+                uefi_call_wrapper(RT->ResetSystem, 4, entry->Action == ACTION_REBOOT ? EfiResetCold : EfiResetShutdown, EFI_SUCCESS, 0, NULL);
             }
         }
     }
 
-    status = security_policy_uninstall();
-    if (status != EFI_SUCCESS)
+    hotkeyStop(&hotkeys);
+    prefetchFree(&prefetch);
+    workPoolStop(&workPool);
+    screenFree(&screen);
+    arenaFree(&arena);
+    uefi_call_wrapper(root->Close, 1, root);
+    if (benchFiles)
+        FreePool(benchFiles);
+    freeMenu(&menu);
+
+    /*
+     * The fresh copy is loaded while our policy is still in place, which
+     * Secure Boot would otherwise refuse, and it installs its own on top of
+     * ours and takes that down again before it returns.
+     */
+    if (restart)
+        status = softRestart(ImageHandle, mayExit);
+    if (security_policy_uninstall() != EFI_SUCCESS)
         Print(L"Failed to uninstall override security policy.\n");
-
-    return EFI_SUCCESS;
+    return restart ? status : EFI_SUCCESS;
 }
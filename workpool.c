@@ -0,0 +1,244 @@
+/*
+ * grml-plus UEFI tools - work queue on the application processors
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "bootperf.h"
+#include "workpool.h"
+
+#ifdef NEED_THUNKS
+static VOID thunk_workerLoop(VOID *Buffer)
+__attribute__((unused));
+#endif
+
+static VOID lockPool(WORK_POOL *Pool) {
+    while (__sync_lock_test_and_set(&Pool->Lock, 1)) {
+        while (Pool->Lock)
+            __builtin_ia32_pause();
+    }
+}
+
+static VOID unlockPool(WORK_POOL *Pool) {
+    __sync_lock_release(&Pool->Lock);
+}
+
+/* the oldest queued item, or NULL; call with the lock held */
+static WORK_ITEM *takeItem(WORK_POOL *Pool) {
+    WORK_ITEM *item = Pool->Head;
+
+    if (item) {
+        Pool->Head = item->Next;
+        if (Pool->Head == NULL)
+            Pool->Tail = NULL;
+        item->State = WORK_RUNNING;
+    }
+    return item;
+}
+
+static VOID runItem(WORK_ITEM *Item) {
+    Item->Function(Item->Context);
+    /* the results have to be visible before the state says so */
+    __sync_synchronize();
+    Item->State = WORK_DONE;
+}
+
+/* runs on the APs, see workpool.h for what it may do */
+static __attribute__((used)) VOID EFI_CALLBACK workerLoop(VOID *Buffer) {
+    WORKER *worker = Buffer;
+    WORK_POOL *pool = worker->Pool;
+    UINT64 idleSince = perfTimestamp();
+    WORK_ITEM *item;
+
+    while (TRUE) {
+        if (pool->Head == NULL && !pool->Stop && perfTimestamp() - idleSince < pool->IdleTicks) {
+            __builtin_ia32_pause();
+            continue;
+        }
+        lockPool(pool);
+        item = takeItem(pool);
+        if (item == NULL && (pool->Stop || perfTimestamp() - idleSince >= pool->IdleTicks)) {
+            /* under the lock, so no item can be queued for a worker that is leaving */
+            worker->Running = FALSE;
+            unlockPool(pool);
+            return;
+        }
+        unlockPool(pool);
+        if (item) {
+            runItem(item);
+            idleSince = perfTimestamp();
+        }
+    }
+}
+
+#ifdef NEED_THUNKS
+THUNK4(workerLoop)
+#endif
+
+/* (re)starts every worker whose AP the firmware has back */
+static VOID wakeWorkers(WORK_POOL *Pool) {
+    WORKER *worker;
+    UINTN i;
+
+    for (i = 0; i < Pool->WorkerCount; i++) {
+        worker = &Pool->Workers[i];
+        if (worker->Running)
+            continue;
+        if (worker->Started) {
+            if (uefi_call_wrapper(BS->CheckEvent, 1, worker->Event) != EFI_SUCCESS)
+                continue;
+            worker->Started = FALSE;
+        }
+        worker->Running = TRUE;
+        if (uefi_call_wrapper(Pool->Mp->StartupThisAP, 7, Pool->Mp, (EFI_AP_PROCEDURE) CALLBACK_ENTRY(workerLoop),
+                worker->Processor, worker->Event, 0, worker, NULL) == EFI_SUCCESS)
+            worker->Started = TRUE;
+        else
+            worker->Running = FALSE;
+    }
+}
+
+EFI_STATUS workPoolStart(WORK_POOL *Pool, UINTN MaxWorkers) {
+    EFI_GUID mpServicesProtocol = EFI_MP_SERVICES_PROTOCOL_GUID;
+    EFI_PROCESSOR_INFORMATION info;
+    EFI_STATUS status;
+    UINTN processors, enabled, i;
+    WORKER *worker;
+
+    ZeroMem(Pool, sizeof(WORK_POOL));
+    status = LibLocateProtocol(&mpServicesProtocol, (VOID **) &Pool->Mp);
+    if (status != EFI_SUCCESS) {
+        Pool->Mp = NULL;
+        return status;
+    }
+    status = uefi_call_wrapper(Pool->Mp->GetNumberOfProcessors, 3, Pool->Mp, &processors, &enabled);
+    if (status != EFI_SUCCESS)
+        return status;
+    Pool->IdleTicks = perfFrequency() / 1000 * WORK_POOL_IDLE_MS;
+
+    for (i = 0; i < processors && Pool->WorkerCount < MaxWorkers && Pool->WorkerCount < WORK_POOL_MAX_WORKERS; i++) {
+        if (uefi_call_wrapper(Pool->Mp->GetProcessorInfo, 3, Pool->Mp, i, &info) != EFI_SUCCESS)
+            continue;
+        if ((info.StatusFlag & PROCESSOR_AS_BSP_BIT) != 0 || (info.StatusFlag & PROCESSOR_ENABLED_BIT) == 0 ||
+                (info.StatusFlag & PROCESSOR_HEALTH_STATUS_BIT) == 0)
+            continue;
+        worker = &Pool->Workers[Pool->WorkerCount];
+        if (uefi_call_wrapper(BS->CreateEvent, 5, 0, 0, NULL, NULL, &worker->Event) != EFI_SUCCESS)
+            break;
+        worker->Pool = Pool;
+        worker->Processor = i;
+        Pool->WorkerCount++;
+    }
+    wakeWorkers(Pool);
+    return Pool->WorkerCount ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+VOID workPoolSubmit(WORK_POOL *Pool, WORK_ITEM *Item, WORK_FUNCTION Function, VOID *Context) {
+    Item->Function = Function;
+    Item->Context = Context;
+    Item->Next = NULL;
+    if (Pool == NULL || Pool->WorkerCount == 0) {
+        Item->State = WORK_RUNNING;
+        runItem(Item);
+        return;
+    }
+    Item->State = WORK_QUEUED;
+    lockPool(Pool);
+    if (Pool->Tail)
+        Pool->Tail->Next = Item;
+    else
+        Pool->Head = Item;
+    Pool->Tail = Item;
+    unlockPool(Pool);
+    wakeWorkers(Pool);
+}
+
+/* runs the oldest queued item on the BSP; FALSE if there was none */
+static BOOLEAN helpOut(WORK_POOL *Pool) {
+    WORK_ITEM *item;
+
+    lockPool(Pool);
+    item = takeItem(Pool);
+    unlockPool(Pool);
+    if (item)
+        runItem(item);
+    return item != NULL;
+}
+
+static BOOLEAN workersRunning(WORK_POOL *Pool) {
+    UINTN i;
+
+    for (i = 0; i < Pool->WorkerCount; i++) {
+        if (Pool->Workers[i].Running)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+BOOLEAN workPoolDone(WORK_POOL *Pool, WORK_ITEM *Item) {
+    if (Item->State == WORK_QUEUED) {
+        wakeWorkers(Pool);
+        /* nobody to take it until the firmware hands an AP back */
+        while (Item->State == WORK_QUEUED && !workersRunning(Pool) && helpOut(Pool))
+            ;
+    }
+    if (Item->State != WORK_DONE)
+        return FALSE;
+    __sync_synchronize();
+    return TRUE;
+}
+
+VOID workPoolWait(WORK_POOL *Pool, WORK_ITEM *Item) {
+    while (!workPoolDone(Pool, Item)) {
+        /* help out rather than spin */
+        if (!helpOut(Pool))
+            __builtin_ia32_pause();
+    }
+}
+
+VOID workPoolStop(WORK_POOL *Pool) {
+    UINTN i;
+
+    if (Pool->WorkerCount == 0)
+        return;
+    Pool->Stop = TRUE;
+    while (helpOut(Pool))
+        ;
+    for (i = 0; i < Pool->WorkerCount; i++) {
+        while (Pool->Workers[i].Running)
+            __builtin_ia32_pause();
+        if (Pool->Workers[i].Started)
+            WaitForSingleEvent(Pool->Workers[i].Event, 0);
+        uefi_call_wrapper(BS->CloseEvent, 1, Pool->Workers[i].Event);
+    }
+    Pool->WorkerCount = 0;
+    Pool->Stop = FALSE;
+}
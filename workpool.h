@@ -0,0 +1,157 @@
+/*
+ * grml-plus UEFI tools - work queue on the application processors
+ *
+ * Copyright 2026 Michael Schierl <schierlm@gmx.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include "efiabi.h"
+
+/*
+ * See the UEFI Platform Initialization manual (Vol2: DXE) for this
+ */
+#define EFI_MP_SERVICES_PROTOCOL_GUID { 0x3fdda605, 0xa76e, 0x4f46, { 0xad, 0x29, 0x12, 0xf4, 0x53, 0x1b, 0x3d, 0x08 } }
+
+#define PROCESSOR_AS_BSP_BIT 0x00000001
+#define PROCESSOR_ENABLED_BIT 0x00000002
+#define PROCESSOR_HEALTH_STATUS_BIT 0x00000004
+
+struct _EFI_MP_SERVICES_PROTOCOL;
+typedef struct _EFI_MP_SERVICES_PROTOCOL EFI_MP_SERVICES_PROTOCOL;
+
+typedef struct {
+    UINT32 Package;
+    UINT32 Core;
+    UINT32 Thread;
+} EFI_CPU_PHYSICAL_LOCATION;
+
+typedef struct {
+    UINT64 ProcessorId;
+    UINT32 StatusFlag;
+    EFI_CPU_PHYSICAL_LOCATION Location;
+    /* PI 1.7 extended topology, only filled in on request */
+    UINT32 ExtendedInformation[6];
+} EFI_PROCESSOR_INFORMATION;
+
+typedef VOID (EFIAPI *EFI_AP_PROCEDURE) (VOID *ProcedureArgument);
+
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_GET_NUMBER_OF_PROCESSORS) (EFI_MP_SERVICES_PROTOCOL *This,
+        UINTN *NumberOfProcessors, UINTN *NumberOfEnabledProcessors);
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_GET_PROCESSOR_INFO) (EFI_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        EFI_PROCESSOR_INFORMATION *ProcessorInfoBuffer);
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_STARTUP_ALL_APS) (EFI_MP_SERVICES_PROTOCOL *This, EFI_AP_PROCEDURE Procedure,
+        BOOLEAN SingleThread, EFI_EVENT WaitEvent, UINTN TimeoutInMicroSeconds, VOID *ProcedureArgument,
+        UINTN **FailedCpuList);
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_STARTUP_THIS_AP) (EFI_MP_SERVICES_PROTOCOL *This, EFI_AP_PROCEDURE Procedure,
+        UINTN ProcessorNumber, EFI_EVENT WaitEvent, UINTN TimeoutInMicroseconds, VOID *ProcedureArgument,
+        BOOLEAN *Finished);
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_SWITCH_BSP) (EFI_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        BOOLEAN EnableOldBSP);
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_ENABLEDISABLEAP) (EFI_MP_SERVICES_PROTOCOL *This, UINTN ProcessorNumber,
+        BOOLEAN EnableAP, UINT32 *HealthFlag);
+typedef EFI_STATUS (EFIAPI *EFI_MP_SERVICES_WHOAMI) (EFI_MP_SERVICES_PROTOCOL *This, UINTN *ProcessorNumber);
+
+struct _EFI_MP_SERVICES_PROTOCOL {
+    EFI_MP_SERVICES_GET_NUMBER_OF_PROCESSORS GetNumberOfProcessors;
+    EFI_MP_SERVICES_GET_PROCESSOR_INFO GetProcessorInfo;
+    EFI_MP_SERVICES_STARTUP_ALL_APS StartupAllAPs;
+    EFI_MP_SERVICES_STARTUP_THIS_AP StartupThisAP;
+    EFI_MP_SERVICES_SWITCH_BSP SwitchBSP;
+    EFI_MP_SERVICES_ENABLEDISABLEAP EnableDisableAP;
+    EFI_MP_SERVICES_WHOAMI WhoAmI;
+};
+
+/*
+ * A work queue served by the application processors (APs).
+ *
+ * workPoolStart starts a worker loop on each enabled AP with a non-blocking
+ * StartupThisAP. The workers take items from a FIFO protected by a spinlock
+ * and run them; a worker that finds the queue empty for WORK_POOL_IDLE_MS
+ * returns to the firmware, and workPoolSubmit starts it again once the MP
+ * driver has noticed (edk2 polls its APs every 100 ms, so a worker cannot be
+ * restarted right after it returned). Whatever the workers cannot take is
+ * run by the BSP in workPoolWait.
+ *
+ * Without MP services, or on a single processor, WorkerCount is 0 and
+ * workPoolSubmit runs the item right away on the BSP.
+ *
+ * Work functions run on an AP and must not call any UEFI service, nor
+ * anything that does (Print, AllocatePool, perfTally, ...); reading the TSC
+ * and plain memory work are fine. An item's results are valid once
+ * workPoolDone returns TRUE for it.
+ */
+
+#define WORK_POOL_MAX_WORKERS 64
+#define WORK_POOL_IDLE_MS 50
+
+#define WORK_IDLE 0
+#define WORK_QUEUED 1
+#define WORK_RUNNING 2
+#define WORK_DONE 3
+
+typedef VOID (*WORK_FUNCTION)(VOID *Context);
+
+typedef struct _WORK_ITEM {
+    WORK_FUNCTION Function;
+    VOID *Context;
+    struct _WORK_ITEM *Next;
+    volatile UINT32 State;
+} WORK_ITEM;
+
+struct _WORK_POOL;
+
+typedef struct {
+    struct _WORK_POOL *Pool;
+    UINTN Processor;
+    EFI_EVENT Event;
+    BOOLEAN Started;            /* the MP driver considers the AP busy */
+    volatile BOOLEAN Running;   /* the worker loop has not returned yet */
+} WORKER;
+
+typedef struct _WORK_POOL {
+    EFI_MP_SERVICES_PROTOCOL *Mp;
+    UINTN WorkerCount;
+    WORKER Workers[WORK_POOL_MAX_WORKERS];
+    UINT64 IdleTicks;
+    volatile UINT32 Lock;
+    volatile BOOLEAN Stop;
+    WORK_ITEM * volatile Head;
+    WORK_ITEM * volatile Tail;
+} WORK_POOL;
+
+/* uses at most MaxWorkers APs; returns an error (and runs everything on the BSP) without MP services */
+EFI_STATUS workPoolStart(WORK_POOL *Pool, UINTN MaxWorkers);
+VOID workPoolSubmit(WORK_POOL *Pool, WORK_ITEM *Item, WORK_FUNCTION Function, VOID *Context);
+BOOLEAN workPoolDone(WORK_POOL *Pool, WORK_ITEM *Item);
+VOID workPoolWait(WORK_POOL *Pool, WORK_ITEM *Item);
+/* runs what is left in the queue and waits until the firmware has all APs back */
+VOID workPoolStop(WORK_POOL *Pool);
+
+#endif